@@ -0,0 +1,62 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Making .ana files in the background, see analog_extract.h.
+
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QThread>
+#include <memory>
+#include "analog_extract.h"
+#include "analog_io.h"
+
+using namespace std;
+
+AnalogExtractor::AnalogExtractor(QObject *parent) : QObject(parent), generation(0)
+{
+   pool.setMaxThreadCount(1);
+}
+
+AnalogExtractor::~AnalogExtractor()
+{
+   stop();
+   pool.waitForDone();
+}
+
+// Not being able to make it is not worth a warning, the traces are only
+// left out of the raster.
+void AnalogExtractor::start(const QString &path, const GdtInfo &info)
+{
+   int gen = ++generation;
+
+   if (info.analogs.empty())
+      return;
+   auto watch = new QFutureWatcher<bool>(this);
+   connect(watch,&QFutureWatcher<bool>::finished,this,[=]() {
+      watch->deleteLater();
+      if (gen == generation && watch->result())
+         emit extracted(path,info);
+   });
+   watch->setFuture(QtConcurrent::run(&pool,[=]() {
+      QThread::currentThread()->setPriority(QThread::IdlePriority);
+      IoProgress going = [this,gen](qint64,qint64) { return gen == generation; };
+      QString err;
+      return extractAnalog(path,info,err,going);
+   }));
+}
@@ -0,0 +1,51 @@
+#ifndef ANALOG_EXTRACT_H
+#define ANALOG_EXTRACT_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Makes the .ana file of each .gdt file that is loaded, on an idle
+// priority thread, so the analog traces are there for the raster window
+// and anything else that wants them without any of them reading the
+// .gdt file. Loading another file drops the one still going.
+
+#include <QObject>
+#include <QThreadPool>
+#include <atomic>
+#include "gdt_io.h"
+
+class AnalogExtractor : public QObject
+{
+   Q_OBJECT
+
+   public:
+      explicit AnalogExtractor(QObject *parent = nullptr);
+      ~AnalogExtractor();
+      void start(const QString &path, const GdtInfo &info);
+      void stop() { ++generation; }
+
+   signals:
+      void extracted(const QString &path, const GdtInfo &info);   // its .ana file is ready
+
+   private:
+      QThreadPool pool;
+      std::atomic<int> generation;  // bumped to drop the one going
+};
+
+#endif
@@ -0,0 +1,187 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <string.h>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+#include "analog_io.h"
+
+using namespace std;
+
+static const char ANALOG_MAGIC[8] = {'G','D','T','A','N','A','L','G'};
+static const quint32 ANALOG_ORDER = 0x01020304;
+static const quint32 ANALOG_VERSION = 2;
+
+struct AnalogHeader
+{
+   char magic[8];
+   quint32 order;
+   quint32 version;
+   qint64 endOffset;
+   quint64 headHash;
+   quint32 numTraces;
+   quint32 pad;
+};
+static_assert(sizeof(AnalogHeader) == 40, "analog header must not change size");
+
+struct TraceHeader
+{
+   qint32 chan;
+   qint32 pad;
+   double interval;
+   qint64 numSegments;
+};
+static_assert(sizeof(TraceHeader) == 24, "trace header must not change size");
+
+struct SegmentHeader
+{
+   qint64 startTime;
+   qint64 count;
+};
+static_assert(sizeof(SegmentHeader) == 16, "segment header must not change size");
+
+// False if there is no cache, or it is not for this version of the file.
+// With no head hash we can't tell, so there is never one.
+bool readAnalogCache(const QString &cacheName, const GdtInfo &info, vector<AnalogTrace> &traces)
+{
+   QFile file(cacheName);
+   AnalogHeader head;
+
+   if (!info.headHash || !file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(head)))
+      return false;
+   const char *data = reinterpret_cast<const char *>(file.map(0,file.size()));
+   if (!data)
+      return false;
+   const char *end = data + file.size();
+   memcpy(&head,data,sizeof(head));
+   bool valid = memcmp(head.magic,ANALOG_MAGIC,sizeof(head.magic)) == 0 && head.order == ANALOG_ORDER
+             && head.version == ANALOG_VERSION
+             && head.endOffset == info.endOffset && head.headHash == info.headHash;
+   const char *pos = data + sizeof(head);
+   auto take = [&](void *to, qint64 len) {
+      if (!valid || end - pos < len)
+         return valid = false;
+      memcpy(to,pos,len);
+      pos += len;
+      return true;
+   };
+   vector<AnalogTrace> found(valid ? head.numTraces : 0);
+   for (AnalogTrace &trace : found)
+   {
+      TraceHeader trace_head;
+      if (!take(&trace_head,sizeof(trace_head)))
+         break;
+      // each segment takes at least its header
+      if (trace_head.numSegments < 0 || (end - pos) / qint64(sizeof(SegmentHeader)) < trace_head.numSegments)
+      {
+         valid = false;
+         break;
+      }
+      trace.chan = trace_head.chan;
+      trace.interval = trace_head.interval;
+      trace.segments.resize(trace_head.numSegments);
+      for (AnalogSegment &segment : trace.segments)
+      {
+         SegmentHeader seg_head;
+         if (!take(&seg_head,sizeof(seg_head)))
+            break;
+         if (seg_head.count < 0 || (end - pos) / qint64(sizeof(float)) < seg_head.count)
+         {
+            valid = false;
+            break;
+         }
+         segment.startTime = seg_head.startTime;
+         segment.samples.resize(seg_head.count);
+         if (seg_head.count)
+            take(segment.samples.data(),seg_head.count * sizeof(float));
+      }
+      if (!valid)
+         break;
+      trace.rebuild();
+   }
+   file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(data)));
+   if (valid && pos == end)
+   {
+      traces = move(found);
+      return true;
+   }
+   return false;
+}
+
+// Written to a temp file and renamed, so a reader never sees half of one.
+bool writeAnalogCache(const QString &cacheName, const GdtInfo &info, const vector<AnalogTrace> &traces)
+{
+   QSaveFile file(cacheName);
+   AnalogHeader head;
+
+   if (!info.headHash)
+      return false;
+   memset(&head,0,sizeof(head));
+   memcpy(head.magic,ANALOG_MAGIC,sizeof(head.magic));
+   head.order = ANALOG_ORDER;
+   head.version = ANALOG_VERSION;
+   head.endOffset = info.endOffset;
+   head.headHash = info.headHash;
+   head.numTraces = traces.size();
+   if (!file.open(QIODevice::WriteOnly))
+      return false;
+   file.write(reinterpret_cast<const char *>(&head),sizeof(head));
+   for (const AnalogTrace &trace : traces)
+   {
+      TraceHeader trace_head;
+      memset(&trace_head,0,sizeof(trace_head));
+      trace_head.chan = trace.chan;
+      trace_head.interval = trace.interval;
+      trace_head.numSegments = trace.segments.size();
+      file.write(reinterpret_cast<const char *>(&trace_head),sizeof(trace_head));
+      for (const AnalogSegment &segment : trace.segments)
+      {
+         SegmentHeader seg_head;
+         seg_head.startTime = segment.startTime;
+         seg_head.count = segment.samples.size();
+         file.write(reinterpret_cast<const char *>(&seg_head),sizeof(seg_head));
+         file.write(reinterpret_cast<const char *>(segment.samples.data()),segment.samples.size() * sizeof(float));
+      }
+   }
+   return file.commit();
+}
+
+// Make the .ana file for a .gdt file, unless there is one for this version
+// of it. With no head hash there can't be one. Not being able to write it
+// is an error here, it is all this is for.
+bool extractAnalog(const QString &fName, const GdtInfo &info, QString &err, const IoProgress &progress)
+{
+   QString cacheName = fName + ANALOG_CACHE_SUFFIX;
+   AnalogCollector analog;
+   vector<AnalogTrace> traces;
+
+   if (info.analogs.empty() || !info.headHash || readAnalogCache(cacheName,info,traces))
+      return true;
+   if (!analogGdtFile(fName,info,analog,err,progress))
+      return false;
+   analog.finish(traces);
+   if (!writeAnalogCache(cacheName,info,traces))
+   {
+      QTextStream(&err) << QObject::tr("Error writing file ") << cacheName << endl;
+      return false;
+   }
+   return true;
+}
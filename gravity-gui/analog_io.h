@@ -0,0 +1,51 @@
+#ifndef ANALOG_IO_H
+#define ANALOG_IO_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Pulls the analog channels between the start and end marks of a .gdt
+// file into AnalogTraces, once, when the file is loaded. They are kept
+// next to the file in name.ana, and whatever wants them after that, the
+// raster window or another program, reads them from there. It is good
+// for as long as the file has the same contents up to its end mark,
+// going by the head hash of its index. The .ana file is simple so other
+// programs can read it instead of the .gdt file, all in the byte order
+// of the machine that wrote it:
+//   header   8 bytes "GDTANALG", uint32 0x01020304, uint32 version,
+//            int64 offset of the end mark, uint64 hash of the bytes
+//            before it, uint32 # traces, uint32 0
+//   traces   int32 chan, int32 0, double ticks per sample,
+//            int64 # segments, then for each segment
+//   segments int64 ticks of the first sample, int64 # samples, then
+//            that many floats. Nothing is missing in a segment, the
+//            gaps are between them.
+
+#include <QString>
+#include <vector>
+#include "gdt_io.h"
+#include "analog_trace.h"
+
+const char ANALOG_CACHE_SUFFIX[] = ".ana";
+
+bool readAnalogCache(const QString &cacheName, const GdtInfo &info, std::vector<AnalogTrace> &traces);
+bool writeAnalogCache(const QString &cacheName, const GdtInfo &info, const std::vector<AnalogTrace> &traces);
+bool extractAnalog(const QString &fName, const GdtInfo &info, QString &err, const IoProgress &progress = IoProgress());
+
+#endif
@@ -0,0 +1,208 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <math.h>
+#include <algorithm>
+#include "analog_trace.h"
+#include "chan_stats.h"
+
+using namespace std;
+
+// Both NaN for a run of nothing but missing samples.
+static inline void widen(float value, float &lo, float &hi)
+{
+   if (value < lo || isnan(lo))
+      lo = value;
+   if (value > hi || isnan(hi))
+      hi = value;
+}
+
+void MinMaxPyramid::build(const vector<float> &samples)
+{
+   lows.clear();
+   highs.clear();
+   size_t bins = (samples.size() + ANALOG_BASE - 1) / ANALOG_BASE;
+   if (!bins)
+      return;
+   lows.emplace_back(bins,NAN);
+   highs.emplace_back(bins,NAN);
+   for (size_t sample = 0; sample < samples.size(); ++sample)
+      if (!isnan(samples[sample]))
+         widen(samples[sample],lows[0][sample / ANALOG_BASE],highs[0][sample / ANALOG_BASE]);
+   while (lows.back().size() > 1)
+   {
+      const vector<float> &lo = lows.back();
+      const vector<float> &hi = highs.back();
+      vector<float> next_lo((lo.size() + 1) / 2,NAN);
+      vector<float> next_hi((lo.size() + 1) / 2,NAN);
+      for (size_t bin = 0; bin < lo.size(); ++bin)
+         if (!isnan(lo[bin]))
+         {
+            widen(lo[bin],next_lo[bin/2],next_hi[bin/2]);
+            widen(hi[bin],next_lo[bin/2],next_hi[bin/2]);
+         }
+      lows.push_back(move(next_lo));
+      highs.push_back(move(next_hi));
+   }
+}
+
+// The low and high of samples from up to but not including to. Whole bins
+// are taken from the coarsest level they fit, only the ragged ends are
+// looked at a sample or a bin at a time.
+void MinMaxPyramid::range(const vector<float> &samples, int64_t from, int64_t to, float &lo, float &hi) const
+{
+   lo = hi = NAN;
+   from = max<int64_t>(from,0);
+   to = min<int64_t>(to,samples.size());
+   if (from >= to)
+      return;
+
+   auto scan = [&](int level, int64_t begin, int64_t end) {   // in samples, on bins of level
+      if (level < 0)
+      {
+         for (int64_t sample = begin; sample < end; ++sample)
+            if (!isnan(samples[sample]))
+               widen(samples[sample],lo,hi);
+         return;
+      }
+      int64_t size = binSamples(level);
+      for (int64_t bin = begin / size; bin < end / size; ++bin)
+         if (!isnan(lows[level][bin]))
+         {
+            widen(lows[level][bin],lo,hi);
+            widen(highs[level][bin],lo,hi);
+         }
+   };
+   int level = 0;
+   for (; level < static_cast<int>(lows.size()); ++level)
+   {
+      int64_t size = binSamples(level);
+      int64_t first = (from + size - 1) / size * size;
+      int64_t last = to / size * size;
+      if (first >= last)
+         break;
+      scan(level-1,from,first);
+      scan(level-1,last,to);
+      from = first;
+      to = last;
+   }
+   scan(level-1,from,to);
+}
+
+double AnalogTrace::rate() const
+{
+   return TICKS_PER_SEC / interval;
+}
+
+// The low and high of the samples from time from up to to, in ticks, NaN
+// if there are none. The sample at or before from is taken too, so a
+// pixel column narrower than a sample still gets something.
+void AnalogTrace::range(double from, double to, float &lo, float &hi) const
+{
+   lo = hi = NAN;
+   auto seg = upper_bound(segments.begin(),segments.end(),from,
+                          [](double time, const AnalogSegment &segment) { return time < segment.startTime; });
+   if (seg != segments.begin())
+      --seg;
+   for (; seg != segments.end() && seg->startTime < to; ++seg)
+   {
+      int64_t first = static_cast<int64_t>(floor((from - seg->startTime) / interval));
+      int64_t last = static_cast<int64_t>(ceil((to - seg->startTime) / interval));
+      float seg_lo, seg_hi;
+      seg->pyramid.range(seg->samples,first,last,seg_lo,seg_hi);
+      if (!isnan(seg_lo))
+      {
+         widen(seg_lo,lo,hi);
+         widen(seg_hi,lo,hi);
+      }
+   }
+}
+
+void AnalogTrace::rebuild()
+{
+   for (AnalogSegment &segment : segments)
+      segment.pyramid.build(segment.samples);
+}
+
+// The records from first to last, which have no gap between them, on the
+// sample interval from the time of the first.
+void AnalogCollector::fill(const Raw &from, size_t first, size_t last, double interval, AnalogSegment &segment)
+{
+   segment.startTime = from.times[first];
+   size_t samples = static_cast<size_t>((from.times[last] - from.times[first]) / interval) + 1;
+   segment.samples.resize(samples);
+   size_t rec = first;
+   for (size_t sample = 0; sample < samples; ++sample)
+   {
+      double time = segment.startTime + sample * interval;
+      while (rec < last && from.times[rec+1] <= time)
+         ++rec;
+      if (rec == last || from.times[rec] == time)
+         segment.samples[sample] = from.values[rec];
+      else
+      {
+         double frac = (time - from.times[rec]) / (from.times[rec+1] - from.times[rec]);
+         segment.samples[sample] = from.values[rec] + frac * (from.values[rec+1] - from.values[rec]);
+      }
+   }
+}
+
+// The interval is the median of the gaps between records. A gap of more
+// than ANALOG_GAP intervals, or a step back in time, starts a new segment.
+void AnalogCollector::resample(const Raw &from, AnalogTrace &trace)
+{
+   size_t count = from.times.size();
+   vector<int32_t> steps;
+
+   for (size_t rec = 1; rec < count; ++rec)
+      if (from.times[rec] > from.times[rec-1])
+         steps.push_back(from.times[rec] - from.times[rec-1]);
+   if (steps.size())
+   {
+      nth_element(steps.begin(),steps.begin() + steps.size()/2,steps.end());
+      trace.interval = steps[steps.size()/2];
+   }
+   trace.segments.clear();
+   size_t first = 0;
+   while (first < count)
+   {
+      size_t last = first;
+      while (last + 1 < count && from.times[last+1] >= from.times[last]
+             && from.times[last+1] - from.times[last] <= ANALOG_GAP * trace.interval)
+         ++last;
+      trace.segments.emplace_back();
+      fill(from,first,last,trace.interval,trace.segments.back());
+      first = last + 1;
+   }
+}
+
+void AnalogCollector::finish(vector<AnalogTrace> &traces) const
+{
+   traces.clear();
+   traces.resize(raw.size());
+   size_t at = 0;
+   for (auto &chan : raw)
+   {
+      AnalogTrace &trace = traces[at++];
+      trace.chan = chan.first;
+      resample(chan.second,trace);
+      trace.rebuild();
+   }
+}
@@ -0,0 +1,102 @@
+#ifndef ANALOG_TRACE_H
+#define ANALOG_TRACE_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// The analog channels of a spike file as evenly spaced samples. An analog
+// record's id is the channel times 4096 plus the A/D value, at whatever
+// times the recording system wrote them. AnalogCollector gathers them a
+// record at a time, then each channel is put on a fixed sample interval,
+// the median one in its records, by straight line interpolation. Where
+// samples are missing for a while the trace is cut, it is a list of
+// segments with gaps between them, so a long gap costs nothing. Each
+// segment has a min/max pyramid so any stretch of it can be drawn in one
+// pass over the pixels. No Qt in here.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <vector>
+
+const int ANALOG_ID = 4096;           // analog record id = chan * this + value
+const int ANALOG_GAP = 4;             // intervals with no samples to call it a gap
+const int ANALOG_BASE = 8;            // samples per bin at pyramid level 0
+
+// The smallest and largest samples of a trace over runs of 8, 16, 32...
+// samples, for drawing long traces. The samples are passed back in to
+// range(), they have to be the ones it was built from.
+class MinMaxPyramid
+{
+   public:
+      void build(const std::vector<float> &samples);
+      void range(const std::vector<float> &samples, int64_t from, int64_t to, float &lo, float &hi) const;
+
+   private:
+      int64_t binSamples(int level) const { return int64_t(ANALOG_BASE) << level; }
+
+      std::vector<std::vector<float>> lows;    // per level, per bin
+      std::vector<std::vector<float>> highs;
+};
+
+// A run of samples with none missing.
+struct AnalogSegment
+{
+   int64_t startTime = 0;     // ticks of sample 0
+   std::vector<float> samples;
+   MinMaxPyramid pyramid;
+};
+
+struct AnalogTrace
+{
+   int chan = 0;
+   double interval = 1;       // ticks from one sample to the next
+   std::vector<AnalogSegment> segments;   // in time order
+
+   double rate() const;       // samples per second
+   void range(double from, double to, float &lo, float &hi) const;
+   void rebuild();
+};
+
+// The analog records of a file, in file order.
+class AnalogCollector
+{
+   public:
+      void add(int id, int time)
+      {
+         Raw &chan = raw[id / ANALOG_ID];
+         chan.times.push_back(time);
+         chan.values.push_back(static_cast<uint16_t>(id % ANALOG_ID));
+      }
+      bool empty() const { return raw.empty(); }
+      void finish(std::vector<AnalogTrace> &traces) const;
+
+   private:
+      struct Raw
+      {
+         std::vector<int32_t> times;
+         std::vector<uint16_t> values;
+      };
+      static void resample(const Raw &from, AnalogTrace &trace);
+      static void fill(const Raw &from, size_t first, size_t last, double interval, AnalogSegment &segment);
+
+      std::map<int,Raw> raw;     // by analog chan
+};
+
+#endif
@@ -0,0 +1,225 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+//   gravity_gui --make-gdt [-j N] [-o dir] [--range from-to] [--chans list]
+//               [--no-bdt] files or dirs...
+// Makes a .gdt file from each .adt, .bdt, or .edt file, gzip or zstd
+// compressed or not, the same way the Create GDT File menu item does. Each
+// file is a task on a pool of its own, biggest first, so the big ones get
+// going early and the small ones fill in around them on the other threads.
+// The conversions put their chunks on the global pool, and a file task
+// waits for them, so the file tasks can't be on that pool too. If they
+// were, a full pool of them could all be waiting on chunks with no thread
+// left to run them.
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <set>
+#include "batch_convert.h"
+#include "gdt_io.h"
+#include "gdt_update.h"
+#include "spike_input.h"
+
+using namespace std;
+
+struct BatchFile
+{
+   QString src;
+   QString dst;
+   QString bdt;      // side .bdt for an .edt file, if wanted
+   FTYPE ftype;
+   qint64 size;
+};
+
+static bool spikeFileType(const QString &suffix, FTYPE &ftype)
+{
+   if (suffix == "adt")
+      ftype = FTYPE::ADT;
+   else if (suffix == "bdt")
+      ftype = FTYPE::BDT;
+   else if (suffix == "edt")
+      ftype = FTYPE::EDT;
+   else
+      return false;
+   return true;
+}
+
+// gbatch can't use long names. Cut them down, and if that makes two
+// names the same, end the later one with a number.
+static QString shortName(const QString &base, set<QString> &used)
+{
+   QString name = base.left(GBATCH_MAX_FNAME);
+   for (int num = 2; used.count(name); ++num)
+   {
+      QString tag = QString("_%1").arg(num);
+      name = base.left(GBATCH_MAX_FNAME - tag.length()) + tag;
+   }
+   used.insert(name);
+   return name;
+}
+
+// One line per file, and the channels that are over the limit.
+static QString summary(const BatchFile &job, const GdtMade &made, GdtUpdate how)
+{
+   QString msg;
+   QTextStream str(&msg);
+   long spikes = 0;
+
+   for (auto &chan : made.counts)
+      spikes += chan.second;
+   str << QFileInfo(job.src).fileName() << " -> " << QFileInfo(job.dst).fileName() << ": "
+       << made.counts.size() << QObject::tr(" channels, ") << spikes << QObject::tr(" spikes")
+       << (how == GdtUpdate::UNCHANGED ? QObject::tr(", up to date") : how == GdtUpdate::APPENDED ? QObject::tr(", added to") : "") << endl;
+   bool over = false;
+   for (auto &chan : made.counts)
+      if (chan.second > MAX_SPIKES)
+      {
+         over = true;
+         str << QObject::tr("   Channel ") << chan.first << QObject::tr(" has ") << chan.second << QObject::tr(" spikes, over ") << MAX_SPIKES << endl;
+      }
+   for (auto &chan : made.stats)
+      if (chan.second.refractory)
+         str << QObject::tr("   Channel ") << chan.first << QObject::tr(" has ") << chan.second.refractory << QObject::tr(" spikes less than 1 ms after the one before") << endl;
+   int from, to;
+   if (over && made.bins.widestRange(MAX_SPIKES,from,to))
+      str << QObject::tr("   Longest time range under the limit: ") << from << "-" << to << endl;
+   return msg;
+}
+
+int makeGdtBatch(const QStringList &args)
+{
+   QCommandLineParser parser;
+   QTextStream out(stdout);
+   QTextStream errs(stderr);
+   QString err;
+
+   parser.setApplicationDescription(QObject::tr("Make .gdt files from .adt, .bdt, and .edt files."));
+   parser.addHelpOption();
+   parser.addOption({MAKE_GDT_OPT+2,QObject::tr("Make .gdt files, no gui.")});
+   parser.addOption({"j",QObject::tr("Use this many threads, default is one per core."),"N"});
+   parser.addOption({"o",QObject::tr("Put the .gdt files in this directory, default is the current one."),"dir"});
+   parser.addOption({"range",QObject::tr("Only keep records in this time range."),"from-to"});
+   parser.addOption({"chans",QObject::tr("Only keep these neuron channels, e.g. 1-10,15."),"list"});
+   parser.addOption({"no-bdt",QObject::tr("Don't make a .bdt file from each .edt file.")});
+   parser.addPositionalArgument("files",QObject::tr(".adt, .bdt, or .edt files, or directories of them."),"files...");
+   parser.process(args);
+
+   GdtSlice slice;
+   if (!parseGdtSlice(parser.value("range"),parser.value("chans"),slice,err))
+   {
+      errs << err;
+      return 1;
+   }
+   QThreadPool filePool;
+   if (parser.isSet("j"))
+   {
+      bool ok;
+      int threads = parser.value("j").toInt(&ok);
+      if (!ok || threads < 1)
+      {
+         errs << QObject::tr("-j needs a number of threads, 1 or more.") << endl;
+         return 1;
+      }
+      QThreadPool::globalInstance()->setMaxThreadCount(threads);
+      filePool.setMaxThreadCount(threads);
+   }
+   QDir outDir(parser.isSet("o") ? parser.value("o") : QDir::currentPath());
+   if (!outDir.exists())
+   {
+      errs << QObject::tr("No such directory ") << outDir.path() << endl;
+      return 1;
+   }
+
+   QFileInfoList inputs;
+   for (const QString &arg : parser.positionalArguments())
+   {
+      QFileInfo info(arg);
+      if (info.isDir())
+         inputs += QDir(arg).entryInfoList({"*.adt","*.bdt","*.edt","*.adt.gz","*.bdt.gz","*.edt.gz",
+                                            "*.adt.zst","*.bdt.zst","*.edt.zst"},QDir::Files,QDir::Name);
+      else
+         inputs += info;
+   }
+   if (inputs.isEmpty())
+   {
+      errs << QObject::tr("No files to convert.") << endl;
+      parser.showHelp(1);
+   }
+
+   QList<BatchFile> jobs;
+   set<QString> used;
+   int failed = 0;
+   for (const QFileInfo &info : inputs)
+   {
+      BatchFile job;
+      QFileInfo plain(uncompressedName(info.fileName()));
+      if (!info.exists() || !spikeFileType(plain.suffix(),job.ftype))
+      {
+         errs << info.filePath() << QObject::tr(": not an .adt, .bdt, or .edt file, skipped.") << endl;
+         ++failed;
+         continue;
+      }
+      QString base = plain.completeBaseName();
+      QString name = shortName(base,used);
+      if (name != base)
+         out << info.fileName() << QObject::tr(" is too long for gbatch or the name is taken, it will be ") << name << ".gdt" << endl;
+      job.src = info.absoluteFilePath();
+      job.dst = outDir.absoluteFilePath(name + ".gdt");
+      if (job.ftype == FTYPE::EDT && !parser.isSet("no-bdt"))
+         job.bdt = outDir.absoluteFilePath(name + ".bdt");
+      job.size = info.size();
+      jobs.append(job);
+   }
+   sort(jobs.begin(),jobs.end(),[](const BatchFile &a, const BatchFile &b) { return a.size > b.size; });
+
+   QMutex outLock;
+   auto convert = [&](const BatchFile &job) {
+      GdtMade made;
+      GdtUpdate how;
+      QString jobErr;
+      bool ok = updateGdtFile(job.src,job.dst,job.bdt,job.ftype,slice,made,how,jobErr);
+        // the programs find the analog channels in the .adt or .bdt
+      if (ok && job.ftype != FTYPE::EDT && compressionOf(job.src) == Compression::NONE)
+         QFile::link(job.src,outDir.absoluteFilePath(QFileInfo(job.src).fileName()));
+      QMutexLocker lock(&outLock);
+      if (ok)
+         out << summary(job,made,how) << flush;
+      else
+      {
+         errs << QFileInfo(job.src).fileName() << ": " << jobErr << flush;
+         ++failed;
+      }
+   };
+
+   QList<QFuture<void>> running;
+   for (const BatchFile &job : jobs)
+      running.append(QtConcurrent::run(&filePool,[&convert,job]() { convert(job); }));
+   for (QFuture<void> &job : running)
+      job.waitForFinished();
+
+   out << inputs.size() - failed << QObject::tr(" of ") << inputs.size() << QObject::tr(" files converted.") << endl;
+   return failed ? 1 : 0;
+}
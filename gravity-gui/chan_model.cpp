@@ -0,0 +1,185 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <QMouseEvent>
+#include <QFontInfo>
+#include <QTextStream>
+#include <algorithm>
+#include "chan_model.h"
+
+using namespace std;
+
+// The short version goes after the channel name, the rest in a tool tip.
+static QString chanStatsLabel(const ChanStats &stats)
+{
+   QString text;
+   QTextStream str(&text);
+
+   str << qSetRealNumberPrecision(3) << "   " << stats.rate() << "/s  CV " << stats.cv();
+   if (stats.refractory)
+      str << "  (" << stats.refractory << " < 1 ms)";
+   return text;
+}
+
+static QString chanStatsTip(int chan, const ChanStats &stats)
+{
+   QString text;
+   QTextStream str(&text);
+
+   str << qSetRealNumberPrecision(4);
+   str << QObject::tr("Channel ") << chan << ": " << stats.spikes << QObject::tr(" spikes") << endl
+       << QObject::tr("First spike ") << stats.firstTime / TICKS_PER_SEC << QObject::tr(" s, last ")
+       << stats.lastTime / TICKS_PER_SEC << " s" << endl
+       << QObject::tr("Mean rate ") << stats.rate() << QObject::tr(" spikes/s") << endl
+       << QObject::tr("Mean ISI ") << stats.isiMean * 1000.0 / TICKS_PER_SEC << QObject::tr(" ms, CV ") << stats.cv() << endl
+       << QObject::tr("ISIs under 1 ms: ") << stats.refractory << endl
+       << QObject::tr("ISI histogram:");
+   for (int bin = 0; bin < ISI_BINS; ++bin)
+   {
+      if (!stats.isiHist[bin])
+         continue;
+      double from = bin ? (1 << bin) * 1000.0 / TICKS_PER_SEC : 0;
+      str << endl << "   " << from << " - " << (2 << bin) * 1000.0 / TICKS_PER_SEC << " ms: " << stats.isiHist[bin];
+   }
+   return text;
+}
+
+ChanListModel::ChanListModel(const QString &name, QObject *parent) : QAbstractListModel(parent), label(name)
+{
+}
+
+void ChanListModel::setChans(const vector<int> &chans, const map<int,ChanStats> &stats)
+{
+   beginResetModel();
+   rows.clear();
+   all.clear();
+   rows.reserve(chans.size());
+   for (int chan : chans)
+   {
+      auto found = stats.find(chan);
+      bool have = found != stats.end();
+      rows.push_back({chan,have,have ? found->second : ChanStats()});
+      all.insert(chan);
+   }
+   sort(rows.begin(),rows.end(),[](const Row &a, const Row &b) { return a.chan < b.chan; });
+   endResetModel();
+}
+
+void ChanListModel::clear()
+{
+   beginResetModel();
+   rows.clear();
+   all.clear();
+   endResetModel();
+}
+
+int ChanListModel::rowOf(int chan) const
+{
+   auto found = lower_bound(rows.begin(),rows.end(),chan,[](const Row &row, int val) { return row.chan < val; });
+   return found != rows.end() && found->chan == chan ? found - rows.begin() : -1;
+}
+
+// The view only asks again for the rows it is showing.
+void ChanListModel::refresh()
+{
+   if (!rows.empty())
+      emit dataChanged(index(0),index(rows.size()-1),{Qt::CheckStateRole});
+}
+
+int ChanListModel::rowCount(const QModelIndex &parent) const
+{
+   return parent.isValid() ? 0 : rows.size();
+}
+
+QVariant ChanListModel::data(const QModelIndex &index, int role) const
+{
+   if (!index.isValid() || index.row() >= static_cast<int>(rows.size()))
+      return QVariant();
+   const Row &row = rows[index.row()];
+   switch (role)
+   {
+      case Qt::DisplayRole:
+         return label + " " + QString::number(row.chan) + (row.hasStats ? chanStatsLabel(row.stats) : QString());
+      case Qt::ToolTipRole:
+         return row.hasStats ? chanStatsTip(row.chan,row.stats) : QVariant();
+      case Qt::CheckStateRole:
+         return selection->has(row.chan) ? Qt::Checked : Qt::Unchecked;
+      case ChanRole:
+         return row.chan;
+      default:
+         return QVariant();
+   }
+}
+
+bool ChanListModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+   if (role != Qt::CheckStateRole || !index.isValid() || index.row() >= static_cast<int>(rows.size()))
+      return false;
+   int chan = rows[index.row()].chan;
+   bool on = value.toInt() == Qt::Checked;
+   if (selection->has(chan) != on)
+   {
+      if (on)
+         selection->insert(chan);
+      else
+         selection->erase(chan);
+      emit dataChanged(index,index,{Qt::CheckStateRole});
+      emit chanChecked(chan,on);
+   }
+   return true;
+}
+
+Qt::ItemFlags ChanListModel::flags(const QModelIndex &index) const
+{
+   if (!index.isValid())
+      return Qt::NoItemFlags;
+   return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+}
+
+bool ChanItemDelegate::editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                                   const QModelIndex &index)
+{
+   Qt::ItemFlags want = Qt::ItemIsEnabled | Qt::ItemIsUserCheckable;
+   if (event->type() == QEvent::MouseButtonRelease && (index.flags() & want) == want)
+   {
+      QMouseEvent *mouse = static_cast<QMouseEvent*>(event);
+      if (mouse->button() == Qt::LeftButton && option.rect.contains(mouse->pos()))
+      {
+         bool on = index.data(Qt::CheckStateRole).toInt() == Qt::Checked;
+         return model->setData(index,on ? Qt::Unchecked : Qt::Checked,Qt::CheckStateRole);
+      }
+   }
+   return QStyledItemDelegate::editorEvent(event,model,option,index);
+}
+
+// The check boxes get bigger with the font. This goes on the list view,
+// not on each row.
+QString chanListStyle(const QFont &font)
+{
+   QFontInfo finfo(font);
+   int box;
+   if (finfo.pixelSize() < 11)
+      box = finfo.pixelSize();
+   else
+      box = finfo.pixelSize()+2;
+   QString style;
+   QTextStream(&style) << "QListView::item { padding: 4px; } QListView::indicator { width: " << box << "px; height: " << box << "px;}";
+   return style;
+}
@@ -0,0 +1,103 @@
+#ifndef CHAN_MODEL_H
+#define CHAN_MODEL_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// The neuron and analog channel lists. A row is only a channel number and
+// maybe the channel's stats, a row is checked if its channel is in the
+// selection the model is given. The view draws the rows that
+// are on the screen from that, so thousands of channels cost about what a
+// few dozen do, and a font change is one call on the view.
+
+#include <QAbstractListModel>
+#include <QStyledItemDelegate>
+#include <QFont>
+#include <vector>
+#include <map>
+#include "chan_stats.h"
+#include "chan_select.h"
+
+class ChanListModel : public QAbstractListModel
+{
+   Q_OBJECT
+
+   public:
+      enum {ChanRole = Qt::UserRole};
+
+      explicit ChanListModel(const QString &name, QObject *parent = nullptr);
+      void setChans(const std::vector<int> &chans, const std::map<int,ChanStats> &stats = std::map<int,ChanStats>());
+      void setSelection(ChanSelection *sel) { selection = sel; refresh(); }
+      void refresh();                  // after the selection was changed
+      void clear();
+      int chanAt(int row) const { return rows[row].chan; }
+      int rowOf(int chan) const;       // -1 if it is not in the list
+      const ChanSelection &chans() const { return all; }
+
+        // the channels in the list for which fn(chan, stats) is true, only
+        // looking at the ones that have stats if withStats is set
+      template <class Fn>
+      ChanSelection chansWhere(Fn fn, bool withStats = false) const
+      {
+         ChanSelection picked;
+         for (const Row &row : rows)
+            if ((row.hasStats || !withStats) && fn(row.chan,row.stats))
+               picked.insert(row.chan);
+         return picked;
+      }
+
+      int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+      QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+      bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+      Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+   signals:
+      void chanChecked(int chan, bool on);    // the user changed the selection
+
+   private:
+      struct Row
+      {
+         int chan;
+         bool hasStats;
+         ChanStats stats;
+      };
+      QString label;
+      std::vector<Row> rows;     // in channel order
+      ChanSelection all;         // of the rows
+      ChanSelection own;         // if we weren't given one
+      ChanSelection *selection = &own;
+};
+
+// A click anywhere on a row flips its check mark, the way a click on the
+// text of a QCheckBox does.
+class ChanItemDelegate : public QStyledItemDelegate
+{
+   Q_OBJECT
+
+   public:
+      using QStyledItemDelegate::QStyledItemDelegate;
+
+   protected:
+      bool editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                       const QModelIndex &index) override;
+};
+
+QString chanListStyle(const QFont &font);
+
+#endif
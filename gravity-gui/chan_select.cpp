@@ -0,0 +1,62 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "chan_select.h"
+
+using namespace std;
+
+vector<int> ChanSelection::list() const
+{
+   vector<int> chans;
+
+   chans.reserve(size());
+   auto other = others.begin();
+   for ( ; other != others.end() && *other < 0; ++other)
+      chans.push_back(*other);
+   if (bits.any())
+      for (int chan = 0; chan < MAX_NEURON_CHANS; ++chan)
+         if (bits[chan])
+            chans.push_back(chan);
+   chans.insert(chans.end(),other,others.end());
+   return chans;
+}
+
+ChanSelection &ChanSelection::operator|=(const ChanSelection &other)
+{
+   bits |= other.bits;
+   others.insert(other.others.begin(),other.others.end());
+   return *this;
+}
+
+ChanSelection &ChanSelection::operator&=(const ChanSelection &other)
+{
+   bits &= other.bits;
+   for (auto chan = others.begin(); chan != others.end(); )
+      chan = other.others.count(*chan) ? next(chan) : others.erase(chan);
+   return *this;
+}
+
+ChanSelection &ChanSelection::operator-=(const ChanSelection &other)
+{
+   bits &= ~other.bits;
+   for (int chan : other.others)
+      others.erase(chan);
+   return *this;
+}
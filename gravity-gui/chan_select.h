@@ -0,0 +1,69 @@
+#ifndef CHAN_SELECT_H
+#define CHAN_SELECT_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// The neuron channels picked for gravity. The neuron channels are bits,
+// so a lookup is O(1) and a whole set is changed a word at a time. Other
+// numbers, which only turn up in a param file for some other .gdt file,
+// are kept on the side until the .gdt file is checked, which warns about
+// them and drops them, the same as for any channel not in the file.
+// No Qt in here.
+
+#include <bitset>
+#include <set>
+#include <vector>
+#include "chan_stats.h"
+
+class ChanSelection
+{
+   public:
+      bool has(int chan) const { return inRange(chan) ? bits[chan] : others.count(chan) != 0; }
+      void insert(int chan)
+      {
+         if (inRange(chan))
+            bits.set(chan);
+         else
+            others.insert(chan);
+      }
+      void erase(int chan)
+      {
+         if (inRange(chan))
+            bits.reset(chan);
+         else
+            others.erase(chan);
+      }
+      void clear() { bits.reset(); others.clear(); }
+      int size() const { return bits.count() + others.size(); }
+      bool empty() const { return bits.none() && others.empty(); }
+      std::vector<int> list() const;      // lowest first
+
+      ChanSelection &operator|=(const ChanSelection &other);
+      ChanSelection &operator&=(const ChanSelection &other);
+      ChanSelection &operator-=(const ChanSelection &other);
+
+   private:
+      static bool inRange(int chan) { return static_cast<unsigned>(chan) < static_cast<unsigned>(MAX_NEURON_CHANS); }
+
+      std::bitset<MAX_NEURON_CHANS> bits;
+      std::set<int> others;
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <math.h>
+#include <algorithm>
+#include "chan_stats.h"
+
+int isiBin(int isi)
+{
+   int bin = 0;
+   while (isi > 1 && bin < ISI_BINS-1)
+   {
+      isi >>= 1;
+      ++bin;
+   }
+   return bin;
+}
+
+void ChanStats::addIsi(int isi)
+{
+   int64_t count = spikes - 1;     // including this one
+   double delta = isi - isiMean;
+
+   isiMean += delta / count;
+   isiM2 += delta * (isi - isiMean);
+   if (isi < REFRACTORY_TICKS)
+      ++refractory;
+   ++isiHist[isiBin(isi)];
+}
+
+// Add the stats for the spikes right after ours. The isi across the join
+// is counted too, so this comes out the same as one pass over all of them.
+void ChanStats::merge(const ChanStats &later)
+{
+   if (later.spikes == 0)
+      return;
+   if (spikes == 0)
+   {
+      *this = later;
+      return;
+   }
+   add(later.firstTime);    // the isi across the join
+   int64_t count_a = isis();
+   int64_t count_b = later.isis();
+   if (count_b)            // Chan et al. for the two sets of isis
+   {
+      int64_t count = count_a + count_b;
+      double delta = later.isiMean - isiMean;
+      isiMean += delta * count_b / count;
+      isiM2 += later.isiM2 + delta * delta * double(count_a) * count_b / count;
+   }
+   spikes += later.spikes - 1;
+   refractory += later.refractory;
+   for (int bin = 0; bin < ISI_BINS; ++bin)
+      isiHist[bin] += later.isiHist[bin];
+   lastTime = later.lastTime;
+}
+
+double ChanStats::rate() const
+{
+   if (spikes < 2 || lastTime <= firstTime)
+      return 0;
+   return isis() * TICKS_PER_SEC / (lastTime - firstTime);
+}
+
+double ChanStats::cv() const
+{
+   if (isis() < 2 || isiMean <= 0)
+      return 0;
+   return sqrt(isiM2 / (isis() - 1)) / isiMean;
+}
+
+int ChanSlots::find(int chan) const
+{
+   if (static_cast<unsigned>(chan) < static_cast<unsigned>(MAX_NEURON_CHANS))
+      return table[chan];
+   auto found = others.find(chan);
+   return found == others.end() ? -1 : found->second;
+}
+
+int ChanSlots::otherSlot(int chan)
+{
+   auto found = others.emplace(chan,chans.size());
+   if (found.second)
+      chans.push_back(chan);
+   return found.first->second;
+}
+
+std::vector<int> ChanSlots::inOrder() const
+{
+   std::vector<int> order(chans.size());
+
+   for (size_t at = 0; at < order.size(); ++at)
+      order[at] = at;
+   std::sort(order.begin(),order.end(),[this](int a, int b) { return chans[a] < chans[b]; });
+   return order;
+}
+
+void ChanSlots::clear()
+{
+   for (int chan : chans)
+      if (static_cast<unsigned>(chan) < static_cast<unsigned>(MAX_NEURON_CHANS))
+         table[chan] = -1;
+   others.clear();
+   chans.clear();
+}
+
+void ChanTally::set(int chan, const ChanStats &chanStats)
+{
+   size_t at = slots.slot(chan);
+   if (at == stats.size())
+      stats.emplace_back();
+   stats[at] = chanStats;
+}
+
+void ChanTally::merge(const ChanTally &later)
+{
+   for (int from = 0; from < later.slots.size(); ++from)
+   {
+      size_t at = slots.slot(later.slots.chan(from));
+      if (at == stats.size())
+         stats.emplace_back();
+      stats[at].merge(later.stats[from]);
+   }
+}
+
+void ChanTally::clear()
+{
+   slots.clear();
+   stats.clear();
+}
@@ -0,0 +1,133 @@
+#ifndef CHAN_STATS_H
+#define CHAN_STATS_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Spike train statistics for the neuron channels, kept up one spike at a
+// time as the records go by, so nothing is kept per spike. ChanStats has
+// a fixed layout so it can go into the .gdt index as is. No Qt in here.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <map>
+#include <vector>
+
+const int ISI_BINS = 24;            // bin b has 2^b <= isi < 2^(b+1) ticks, 0 goes in bin 0
+const int REFRACTORY_TICKS = 2;     // an isi less than this is a violation, 1 ms
+const double TICKS_PER_SEC = 2000.0;
+const int MAX_NEURON_CHANS = 4096;
+
+struct ChanStats
+{
+   int64_t spikes = 0;
+   int32_t firstTime = 0;
+   int32_t lastTime = 0;
+   double isiMean = 0;        // Welford's running mean and sum of squares
+   double isiM2 = 0;          // of the isis, in ticks
+   uint32_t refractory = 0;   // # isis under REFRACTORY_TICKS
+   uint32_t pad = 0;
+   uint32_t isiHist[ISI_BINS] = {};
+
+   void add(int time)
+   {
+      if (spikes++ == 0)
+         firstTime = time;
+      else
+         addIsi(time - lastTime);
+      lastTime = time;
+   }
+   void merge(const ChanStats &later);
+   int64_t isis() const { return spikes > 1 ? spikes - 1 : 0; }
+   double rate() const;       // spikes/sec from the first to the last spike
+   double cv() const;         // of the isis
+
+   private:
+      void addIsi(int isi);
+};
+static_assert(sizeof(ChanStats) == 40 + ISI_BINS * 4, "ChanStats is written to the index as is");
+
+int isiBin(int isi);
+
+// Channel number to a dense slot number, in the order the channels turn
+// up. Neuron channels go through a flat table, so a spike costs one array
+// lookup. Anything else, which only a bad record would have, goes through
+// a map.
+class ChanSlots
+{
+   public:
+      ChanSlots() { table.fill(-1); }
+      int slot(int chan)      // adds the chan if it is new
+      {
+         if (static_cast<unsigned>(chan) >= static_cast<unsigned>(MAX_NEURON_CHANS))
+            return otherSlot(chan);
+         int &at = table[chan];
+         if (at < 0)
+         {
+            at = chans.size();
+            chans.push_back(chan);
+         }
+         return at;
+      }
+      int find(int chan) const;   // -1 if we haven't seen it
+      int size() const { return chans.size(); }
+      int chan(int slot) const { return chans[slot]; }
+      std::vector<int> inOrder() const;   // the slots, by channel number
+      void clear();
+
+   private:
+      int otherSlot(int chan);
+
+      std::array<int,MAX_NEURON_CHANS> table;
+      std::map<int,int> others;
+      std::vector<int> chans;     // of each slot
+};
+
+// The stats for each channel in a run of records. Each thread keeps its
+// own for its part of a file and they are merged in file order at the end.
+class ChanTally
+{
+   public:
+      void add(int chan, int time)
+      {
+         size_t at = slots.slot(chan);
+         if (at == stats.size())
+            stats.emplace_back();
+         stats[at].add(time);
+      }
+      void set(int chan, const ChanStats &chanStats);
+      void merge(const ChanTally &later);
+      bool empty() const { return stats.empty(); }
+      void clear();
+
+        // fn(chan, stats) for each channel, lowest channel first
+      template <class Fn>
+      void forEach(Fn fn) const
+      {
+         for (int at : slots.inOrder())
+            fn(slots.chan(at),stats[at]);
+      }
+
+   private:
+      ChanSlots slots;
+      std::vector<ChanStats> stats;   // by slot
+};
+
+#endif
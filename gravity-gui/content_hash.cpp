@@ -0,0 +1,154 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+// The XXH64 algorithm from https://github.com/Cyan4973/xxHash, written out
+// here so we don't need another library. Little endian only, as are all of
+// the machines this runs on.
+
+#include <string.h>
+#include "content_hash.h"
+
+static const uint64_t PRIME1 = 11400714785074694791ULL;
+static const uint64_t PRIME2 = 14029467366897019727ULL;
+static const uint64_t PRIME3 = 1609587929392839161ULL;
+static const uint64_t PRIME4 = 9650029242287828579ULL;
+static const uint64_t PRIME5 = 2870177450012600261ULL;
+
+static inline uint64_t rotl(uint64_t val, int bits)
+{
+   return (val << bits) | (val >> (64 - bits));
+}
+
+static inline uint64_t read64(const unsigned char *ptr)
+{
+   uint64_t val;
+   memcpy(&val,ptr,sizeof(val));
+   return val;
+}
+
+static inline uint32_t read32(const unsigned char *ptr)
+{
+   uint32_t val;
+   memcpy(&val,ptr,sizeof(val));
+   return val;
+}
+
+static inline uint64_t xxRound(uint64_t acc, uint64_t input)
+{
+   acc += input * PRIME2;
+   acc = rotl(acc,31);
+   return acc * PRIME1;
+}
+
+static inline uint64_t mergeRound(uint64_t acc, uint64_t val)
+{
+   acc ^= xxRound(0,val);
+   return acc * PRIME1 + PRIME4;
+}
+
+static inline void stripe(uint64_t *acc, const unsigned char *ptr)
+{
+   acc[0] = xxRound(acc[0],read64(ptr));
+   acc[1] = xxRound(acc[1],read64(ptr+8));
+   acc[2] = xxRound(acc[2],read64(ptr+16));
+   acc[3] = xxRound(acc[3],read64(ptr+24));
+}
+
+ContentHash::ContentHash(uint64_t seedVal) : seed(seedVal)
+{
+   acc[0] = seed + PRIME1 + PRIME2;
+   acc[1] = seed + PRIME2;
+   acc[2] = seed;
+   acc[3] = seed - PRIME1;
+}
+
+void ContentHash::update(const void *data, size_t len)
+{
+   const unsigned char *ptr = static_cast<const unsigned char *>(data);
+   const unsigned char *end = ptr + len;
+
+   total += len;
+   if (tailLen + len < sizeof(tail))
+   {
+      memcpy(tail+tailLen,ptr,len);
+      tailLen += len;
+      return;
+   }
+   if (tailLen)
+   {
+      size_t fill = sizeof(tail) - tailLen;
+      memcpy(tail+tailLen,ptr,fill);
+      stripe(acc,tail);
+      ptr += fill;
+      tailLen = 0;
+   }
+   for ( ; end - ptr >= 32; ptr += 32)
+      stripe(acc,ptr);
+   tailLen = end - ptr;
+   memcpy(tail,ptr,tailLen);
+}
+
+uint64_t ContentHash::digest() const
+{
+   uint64_t hash;
+   const unsigned char *ptr = tail;
+   const unsigned char *end = tail + tailLen;
+
+   if (total >= 32)
+   {
+      hash = rotl(acc[0],1) + rotl(acc[1],7) + rotl(acc[2],12) + rotl(acc[3],18);
+      for (int lane = 0; lane < 4; ++lane)
+         hash = mergeRound(hash,acc[lane]);
+   }
+   else
+      hash = seed + PRIME5;
+   hash += total;
+
+   for ( ; end - ptr >= 8; ptr += 8)
+   {
+      hash ^= xxRound(0,read64(ptr));
+      hash = rotl(hash,27) * PRIME1 + PRIME4;
+   }
+   if (end - ptr >= 4)
+   {
+      hash ^= read32(ptr) * PRIME1;
+      hash = rotl(hash,23) * PRIME2 + PRIME3;
+      ptr += 4;
+   }
+   for ( ; ptr < end; ++ptr)
+   {
+      hash ^= *ptr * PRIME5;
+      hash = rotl(hash,11) * PRIME1;
+   }
+
+   hash ^= hash >> 33;
+   hash *= PRIME2;
+   hash ^= hash >> 29;
+   hash *= PRIME3;
+   hash ^= hash >> 32;
+   return hash;
+}
+
+uint64_t contentHash(const void *data, size_t len, uint64_t seed)
+{
+   ContentHash hash(seed);
+   hash.update(data,len);
+   return hash.digest();
+}
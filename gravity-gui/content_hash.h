@@ -0,0 +1,47 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// XXH64 of a file's contents, fed a block at a time. This is only to tell
+// if a file has changed, it is not for anything that needs to be secure.
+// No Qt in here.
+
+#include <stdint.h>
+#include <stddef.h>
+
+class ContentHash
+{
+   public:
+      explicit ContentHash(uint64_t seed = 0);
+      void update(const void *data, size_t len);
+      uint64_t digest() const;
+
+   private:
+      uint64_t acc[4];
+      unsigned char tail[32];   // bytes not yet part of a 32 byte stripe
+      size_t tailLen = 0;
+      uint64_t total = 0;
+      uint64_t seed;
+};
+
+uint64_t contentHash(const void *data, size_t len, uint64_t seed = 0);
+
+#endif
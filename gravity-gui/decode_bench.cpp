@@ -0,0 +1,157 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+// Time the record decoder and writer against the Qt code they replaced.
+// Not installed, build it with "make decode_bench".
+//   decode_bench [# records]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QTextStream>
+#include "spike_decode.h"
+#include "spike_format.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Fake spike file, one record per line, times going up.
+template <class Fmt>
+static string makeRecords(long count)
+{
+   string data;
+   char rec[64];
+   long time = 0;
+
+   srand(1);
+   data.reserve(count * (Fmt::REC_W+1));
+   for (long rec_num = 0; rec_num < count; ++rec_num)
+   {
+      time += rand() % 40;
+      snprintf(rec,sizeof(rec),"%*d%*ld\n",Fmt::CHAN_W,rand() % 100 + 1,Fmt::TIME_W,time);
+      data += rec;
+   }
+   return data;
+}
+
+static void report(const char *name, long count, long long check, steady_clock::time_point start)
+{
+   double secs = duration<double>(steady_clock::now() - start).count();
+   printf("  %-22s %8.1f M records/sec   (check %lld)\n", name, count / secs / 1e6, check);
+}
+
+// The way makeGDT and makeChanList used to do it.
+template <class Fmt>
+static void oldPath(const string &data, long count)
+{
+   long long check = 0;
+   auto start = steady_clock::now();
+   QString all = QString::fromLatin1(data.data(),data.size());
+   QStringList rows = all.split('\n',QString::SkipEmptyParts);
+   for (const QString &line : rows)
+   {
+      check += line.midRef(0,Fmt::CHAN_W).toInt();
+      check += line.mid(Fmt::CHAN_W,-1).toInt();
+   }
+   report("QString midRef/toInt",count,check,start);
+}
+
+template <class Fmt>
+static void newPath(const string &data, long count, DecodeLevel level, const char *name)
+{
+   long long check = 0;
+   string padded = data + string(DECODE_PAD,' ');
+   const char *begin = padded.data();
+   const char *end = begin + data.size();
+   vector<int> chans, times;
+
+   chans.reserve(count);
+   times.reserve(count);
+   auto start = steady_clock::now();
+   decodeRecords<Fmt>(begin,end,end+DECODE_PAD,chans,times,level);
+   for (size_t rec = 0; rec < chans.size(); ++rec)
+      check += chans[rec] + times[rec];
+   report(name,count,check,start);
+}
+
+template <class Fmt>
+static void runFormat(const char *title, long count)
+{
+   string data = makeRecords<Fmt>(count);
+
+   printf("%s (I%d I%d), %ld records\n",title,Fmt::CHAN_W,Fmt::TIME_W,count);
+   oldPath<Fmt>(data,count);
+   newPath<Fmt>(data,count,DECODE_SCALAR,"scalar");
+   if (decodeLevel() >= DECODE_SSE41)
+      newPath<Fmt>(data,count,DECODE_SSE41,"SSE4.1");
+   if (decodeLevel() >= DECODE_AVX2)
+      newPath<Fmt>(data,count,DECODE_AVX2,"AVX2");
+}
+
+// Writing .bdt records, the QTextStream way edt2bdt used to and with
+// formatRecord. The check is the output size, they should match.
+static void runWrite(long count)
+{
+   vector<int> chans(count), times(count);
+   int time = 0;
+
+   srand(1);
+   for (long rec = 0; rec < count; ++rec)
+   {
+      time += rand() % 40;
+      chans[rec] = rand() % 100 + 1;
+      times[rec] = time;
+   }
+   printf("writing .bdt (I5 I8), %ld records\n",count);
+
+   auto start = steady_clock::now();
+   QByteArray old_out;
+   QTextStream str(&old_out);
+   str.setFieldAlignment(QTextStream::AlignRight);
+   for (long rec = 0; rec < count; ++rec)
+      str << qSetFieldWidth(5) << chans[rec] << qSetFieldWidth(8) << times[rec] << qSetFieldWidth(0) << endl;
+   report("QTextStream",count,old_out.size(),start);
+
+   start = steady_clock::now();
+   string new_out(count * MAX_RECORD_TEXT,' ');
+   char *pos = &new_out[0];
+   for (long rec = 0; rec < count; ++rec)
+      pos = formatRecord(pos,chans[rec],5,times[rec],8);
+   new_out.resize(pos - new_out.data());
+   report("formatRecord",count,new_out.size(),start);
+   if (new_out != string(old_out.constData(),old_out.size()))
+      printf("  output is not the same!\n");
+}
+
+int main(int argc, char *argv[])
+{
+   long count = argc > 1 ? atol(argv[1]) : 10000000;
+
+   runFormat<AdtFormat>(".adt",count);
+   runFormat<BdtFormat>(".bdt",count);
+   runFormat<EdtFormat>(".edt",count);
+   runWrite(count);
+   return 0;
+}
@@ -53,21 +53,109 @@ This file is part of the USF Gravity Gui software suite.
 #include <QDate>
 #include <QTime>
 #include <QDesktopWidget>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QStatusBar>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMenu>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QInputDialog>
+#include <QThread>
+#include <QVBoxLayout>
 #include <curses.h>
 #include <term.h>
 #include "g_prog.h"
+#include "gdt_io.h"
+#include "gdt_index.h"
+#include "chan_model.h"
+#include "gdt_cache.h"
+#include "gdt_prefetch.h"
+#include "gdt_watch.h"
+#include "analog_extract.h"
+#include "raster_view.h"
+#include "gdt_update.h"
+#include "gdt_worker.h"
+#include "gravity_params.h"
+#include "job_queue.h"
+#include "job_view.h"
+#include "spike_input.h"
 #include "helpbox.h"
 
 using namespace std;
 
 void GravityGui::setupImpl()
 {
-   neuroMapper = new QSignalMapper(this);
-   connect(neuroMapper,SIGNAL(mapped(int)),this,SLOT(neuroClicked(int)));
-   analogMapper = new QSignalMapper(this);
-   connect(analogMapper,SIGNAL(mapped(int)),this,SLOT(analogClicked(int)));
+   neuroModel = new ChanListModel(tr("Neuron Chan"),this);
+   analogModel = new ChanListModel(tr("Analog Chan"),this);
+   ui->neuroChans->setModel(neuroModel);
+   ui->analogChans->setModel(analogModel);
+   ui->neuroChans->setItemDelegate(new ChanItemDelegate(ui->neuroChans));
+   ui->analogChans->setItemDelegate(new ChanItemDelegate(ui->analogChans));
+   ui->neuroChans->setUniformItemSizes(true);
+   ui->analogChans->setUniformItemSizes(true);
+   neuroModel->setSelection(&selectedChans);
+   connect(neuroModel,&ChanListModel::chanChecked,this,&GravityGui::neuroClicked);
+   ui->neuroChans->setContextMenuPolicy(Qt::CustomContextMenu);
+   connect(ui->neuroChans,&QWidget::customContextMenuRequested,this,&GravityGui::neuroMenu);
+   connect(analogModel,&ChanListModel::chanChecked,this,&GravityGui::analogClicked);
+
+     // making and loading .gdt files runs in the background, this shows
+     // how far along it is and lets the user give up on it.
+   gdtWorker = new GdtWorker(this);
+   ioProgress = new QProgressBar(this);
+   ioProgress->setRange(0,100);
+   ioProgress->setMaximumWidth(250);
+   ioProgress->hide();
+   ioCancel = new QPushButton(tr("Cancel"),this);
+   ioCancel->hide();
+   statusBar()->addPermanentWidget(ioProgress);
+   statusBar()->addPermanentWidget(ioCancel);
+   connect(gdtWorker,&GdtWorker::progress,ioProgress,&QProgressBar::setValue);
+   connect(gdtWorker,&GdtWorker::running,this,[this](bool on) {
+      ioProgress->setValue(0);
+      ioProgress->setVisible(on);
+      ioCancel->setVisible(on);
+   });
+   connect(ioCancel,&QPushButton::clicked,gdtWorker,&GdtWorker::cancel);
+
+     // .gdt files loaded lately, and how well that is working
+   gdtCache = make_unique<GdtCache>();
+   gdtCacheMB = GDT_CACHE_MB;
+   cacheStatus = new QLabel(this);
+   statusBar()->addPermanentWidget(cacheStatus);
+   gdtPrefetch = make_unique<GdtPrefetcher>(*gdtCache);
+   connect(gdtWorker,&GdtWorker::running,gdtPrefetch.get(),&GdtPrefetcher::pause);
+   connect(gdtPrefetch.get(),&GdtPrefetcher::fetched,this,[this](int files) {
+      showCacheCounts();
+      if (files)
+         statusBar()->showMessage(tr("Read ahead %1 .gdt files").arg(files),5000);
+   });
+   gdtWatch = new GdtWatcher(this);
+   connect(gdtWatch,&GdtWatcher::changed,this,&GravityGui::gdtFileChanged);
+   analogExtract = make_unique<AnalogExtractor>();
+   connect(analogExtract.get(),&AnalogExtractor::extracted,this,[this](const QString &path, const GdtInfo &info) {
+      if (raster)
+         raster->analogReady(path,info);
+   });
+   maxJobs = QThread::idealThreadCount();
 
    loadSettings();
+   gdtCache->setBudget(qint64(gdtCacheMB) << 20);
+   showCacheCounts();
+
+     // the programs run from the queue, as many at once as we are allowed
+   jobs = make_unique<JobQueue>(this,maxJobs);
+   jobStatus = new QLabel(this);
+   statusBar()->addPermanentWidget(jobStatus);
+   connect(jobs.get(),&JobQueue::changed,this,&GravityGui::showJobs);
+   showJobs();
+   if (ui->currentSession->text().length())
+      gdtPrefetch->start(ui->currentSession->text());
    initParams();
    paramsClean();
    rebuildRecents();
@@ -92,6 +180,8 @@ void GravityGui::loadSettings()
       font.fromString(settings.value("inputfont").toString());
       setInputFont(font);
       ui->surrSeed->setText(settings.value("seedvalue").toString());
+      gdtCacheMB = settings.value("gdtcachemb",GDT_CACHE_MB).toInt();
+      maxJobs = settings.value("maxjobs",QThread::idealThreadCount()).toInt();
       recentProjs = settings.value("recentProjs").toStringList();
       sessionDir = settings.value("currentsession").toString();
       for (int entry = 0; entry < MAX_RECENTS; ++entry) // recent projects in file menu
@@ -122,6 +212,8 @@ void GravityGui::saveSettings()
       settings.setValue("otherbuttonfont",ui->paramLoadFile->font().toString());
       settings.setValue("inputfont",ui->currentSession->font().toString());
       settings.setValue("seedvalue",ui->surrSeed->text());
+      settings.setValue("gdtcachemb",gdtCacheMB);
+      settings.setValue("maxjobs",maxJobs);
       settings.setValue("currentsession",ui->currentSession->text());
       settings.setValue("recentProjs",recentProjs);
    }
@@ -182,6 +274,7 @@ void GravityGui::OpenRecentProj()
       {
          ui->currentSession->setText(session.absolutePath());
          QDir::setCurrent(session.absolutePath());
+         gdtPrefetch->start(session.absolutePath());
       }
       else
       {
@@ -201,6 +294,9 @@ void GravityGui::OpenRecentProj()
 
 void GravityGui::actionQuit()
 {
+   gdtWorker->cancel();
+   gdtPrefetch->stop();
+   analogExtract->stop();
    checkDirty();
    saveSettings();
    close();
@@ -369,38 +465,11 @@ void GravityGui::setInputFont(const QFont& font)
    ui->backwardTau->setFont(font);
    ui->timeSpan->setFont(font);
 
+   QString style = chanListStyle(font);
    ui->neuroChans->setFont(font);
-   QFontInfo finfo(font);
-   int box;
-   if (finfo.pixelSize() < 11)
-      box = finfo.pixelSize();
-   else
-      box = finfo.pixelSize()+2;
-   QString style;
-   QTextStream(&style) << "QCheckBox::indicator { width: " << box << "px; height: " << box << "px;}";
-   for (int row = 0 ; row < ui->neuroChans->count(); ++row)
-   {
-      QListWidgetItem *item = ui->neuroChans->item(row);
-      QObject *obj = ui->neuroChans->itemWidget(item);
-      QCheckBox *cb = dynamic_cast<QCheckBox*>(obj);
-      if (cb)
-      {
-         cb->setFont(font);
-         cb->setStyleSheet(style);
-      }
-   }
+   ui->neuroChans->setStyleSheet(style);
    ui->analogChans->setFont(font);
-   for (int row = 0 ; row < ui->analogChans->count(); ++row)
-   {
-      QListWidgetItem *item = ui->analogChans->item(row);
-      QObject *obj = ui->analogChans->itemWidget(item);
-      QCheckBox *cb = dynamic_cast<QCheckBox*>(obj);
-      if (cb)
-      {
-         cb->setFont(font);
-         cb->setStyleSheet(style);
-      }
-   }
+   ui->analogChans->setStyleSheet(style);
 }
 
 // pick/create a working directory
@@ -417,6 +486,7 @@ void GravityGui::doSession()
       ui->currentSession->setText(session.absolutePath());
       QDir::setCurrent(session.absolutePath()); // make this the cwd
       updateRecents();
+      gdtPrefetch->start(session.absolutePath());
    }
 }
 
@@ -425,22 +495,11 @@ void GravityGui::doSession()
 void GravityGui::makeGDT()
 {
    QString msg;
-   QString line;
-   int chan,time;
-   chanList bdtList;
-   chanListPair cl_pair;
-   int t_wid = 8;      // adt is I2 I8, bdt is I5 I8, edt is I5 I10
-   int chan_len = 5;   // we turn edt into bdt, so t_wid is same for both adt & bdt
-   QString all;
-
-   auto addChan = [&bdtList](int chan) {
-      chanListPair cl_pair; if (chan < 4096) { 
-         cl_pair = bdtList.emplace(chan,0); 
-         ++(cl_pair.first->second);
-      } 
-   };
+   QString bdtName;
 
    gbatchSwitch();  // bring our terminal to foreground.
+   if (ioBusy())
+      return;
    if (ui->currentSession->text().length() == 0)
    {
       QMessageBox msgBox(this);
@@ -452,11 +511,12 @@ void GravityGui::makeGDT()
    }
 
    QString fName = QFileDialog::getOpenFileName(this,
-                      tr("Select .adt .bdt or edt file."), "./", ".adt .bdt .edt Files (*.adt *.bdt *.edt)");
+                      tr("Select .adt .bdt or edt file."), "./",
+                      ".adt .bdt .edt Files (*.adt *.bdt *.edt *.adt.gz *.bdt.gz *.edt.gz *.adt.zst *.bdt.zst *.edt.zst)");
    if (!fName.length())
       return;
 
-   QFileInfo readInfo(fName);
+   QFileInfo readInfo(uncompressedName(fName));   // gz, zst are read as is
    QString justName =readInfo.completeBaseName();
    QString outname = justName + ".gdt";
    QString suff = readInfo.suffix();
@@ -464,7 +524,6 @@ void GravityGui::makeGDT()
    if (suff == "adt")
    {
       ftype = FTYPE::ADT;
-      chan_len = 2;
    }
    else if (suff == "bdt")
    {
@@ -473,21 +532,20 @@ void GravityGui::makeGDT()
    else if (suff == "edt")
    {
       QMessageBox msgBox(this);
-      msgBox.setText("You have selected a .edt file.\nGravity can only process .adt and .bdt files."); 
-      msgBox.setInformativeText("Do you want to create a new .bdt file in the current session directory file from the .edt file?");
-      msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+      msgBox.setText("You have selected a .edt file.\nThe .gdt file will be made directly from it."); 
+      msgBox.setInformativeText("Do you also want a .bdt file in the current session directory? Programs such as fireworks and 3djmp use it for the analog channels.");
+      msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+      msgBox.setDefaultButton(QMessageBox::Yes);
       msgBox.setIcon(QMessageBox::Question);
       int resp = msgBox.exec();
-      if (resp == QMessageBox::No)
+      if (resp == QMessageBox::Cancel)
       {
          ui->gbatchTerm->printWarn("Creating a .gdt file cancelled.\n");
          return;
       }
-      QString bdtName = QDir::currentPath() + "/" + justName + ".bdt";
-      if (!edt2bdt(fName,bdtName))
-         return;
-      ftype = FTYPE::BDT;
-      fName = bdtName;
+      if (resp == QMessageBox::Yes)
+         bdtName = QDir::currentPath() + "/" + justName + ".bdt";
+      ftype = FTYPE::EDT;
    }
    else
    {
@@ -508,93 +566,81 @@ void GravityGui::makeGDT()
          break;
    }
 
-   QFile file(fName);
-   if (!file.open(QIODevice::ReadOnly))
-   {
-      QTextStream(&msg) << tr("Error opening file ") << fName << endl << tr("Error is:               ") << file.errorString() << endl;
-      ui->gbatchTerm->printWarn(msg);
-      return;
-   }
-   QFile outfile(outname);
-   if (!outfile.open(QIODevice::WriteOnly))
-   {
-      QTextStream(&msg) << tr("Error opening file ") << outname << endl << tr("Error is:               ") << file.errorString() << endl;
-      ui->gbatchTerm->printWarn(msg);
-      return;
-   }
-    // Finally! read file
-   QTextStream stream(&outfile);
-   QTextStream(&msg) << tr("Loading ") << fName << endl;
-   ui->gbatchTerm->append(msg);
-   ui->gbatchTerm->repaint();
-   msg.clear();
-   try
-   {
-      all = file.readAll();
-   }
-   catch (std::bad_alloc) // QStrings can only hold so much
-   {
-      QTextStream(&msg) << tr("This file is too large.") << endl << tr("Use scope or another program to create a file with a subset of this file.") << endl;
-      ui->gbatchTerm->printWarn(msg);
+   GdtSlice slice;
+   if (!askGdtSlice(slice))
       return;
-   }
-   QStringList rows = all.split('\n',QString::SkipEmptyParts);
-   QStringList::const_iterator iter = rows.begin();
-   if (ftype == FTYPE::BDT && *(iter) != "   11 1111111" && *(iter+1) != "   11 1111111")
-   {
-      QTextStream(&msg) << tr("This not a valid .bdt file ") << fName << endl;
-      ui->gbatchTerm->printWarn(msg);
-      msg.clear();
-      file.close();
-      return;
-   }
-
-   if (ftype == FTYPE::BDT) // pick up 1st time
-   {
-      iter += 2;     // skip header
-      line = *iter;
-   }
-   else // adt
-      line = *iter;
 
-   chan = line.midRef(0,chan_len).toInt();
-   time = line.mid(chan_len,-1).toInt();
-   if (time - 1 > 0)                // insert gdt start mark at earliest time
-      --time;
-   else
-      time = 0;
-   QTextStream(&msg) << tr("Saving ") << outname << endl;
+   QTextStream(&msg) << tr("Loading ") << fName << endl << tr("Saving ") << outname << endl;
+   if (!slice.whole())
+      QTextStream(&msg) << tr("Using times ") << gdtSliceRange << tr(" channels ") << gdtSliceChans << endl;
    ui->gbatchTerm->append(msg);
-   QApplication::setOverrideCursor(Qt::WaitCursor);
-   ui->gbatchTerm->repaint();
-   msg.clear();
-   if (ftype == FTYPE::BDT)
-   {
-      stream << "   11 1111111" << endl; // write header
-      stream << "   11 1111111" << endl;
-   }
-   stream.setFieldAlignment(QTextStream::AlignRight);
-   stream << qSetFieldWidth(chan_len) << GDT_START << qSetFieldWidth(t_wid) << time << qSetFieldWidth(0) << endl;
-   stream.setFieldWidth(0);
-   stream << line << endl;
-   ++iter;
-
-   addChan(chan);
+   auto made = make_shared<GdtMade>();
+   auto how = make_shared<GdtUpdate>();
+   auto err = make_shared<QString>();
+   gdtWorker->start([=](const IoProgress &progress) {
+         return updateGdtFile(fName,outname,bdtName,ftype,slice,*made,*how,*err,progress);
+      },
+      [=](bool ok) {
+         if (!ok)
+         {
+            ui->gbatchTerm->printWarn(*err);
+            return;
+         }
+         QString note;
+         if (*how == GdtUpdate::UNCHANGED)
+            QTextStream(&note) << outname << tr(" is already up to date.") << endl;
+         else if (*how == GdtUpdate::APPENDED)
+            QTextStream(&note) << tr("Added the new records in ") << fName << tr(" to ") << outname << endl;
+         if (note.length())
+            ui->gbatchTerm->append(note);
+         makeGDTDone(fName,bdtName,ftype,*made);
+      });
+}
 
-   for (; iter != rows.end(); ++iter)
+// Ask for the part of the file to put in the .gdt file. The answers are
+// kept for next time. False if the user cancels.
+bool GravityGui::askGdtSlice(GdtSlice &slice)
+{
+   QDialog dlg(this);
+   QFormLayout *form = new QFormLayout(&dlg);
+   QLineEdit *range = new QLineEdit(gdtSliceRange,&dlg);
+   QLineEdit *chans = new QLineEdit(gdtSliceChans,&dlg);
+   QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel,&dlg);
+
+   dlg.setWindowTitle(tr("Records To Use"));
+   range->setPlaceholderText(tr("all, or from-to, e.g. 20000-900000"));
+   chans->setPlaceholderText(tr("all, or e.g. 1-12,15,20"));
+   form->addRow(new QLabel(tr("Leave these empty to use the whole file.\nAnalog channels are always kept."),&dlg));
+   form->addRow(tr("Time range (ticks):"),range);
+   form->addRow(tr("Neuron channels:"),chans);
+   form->addRow(buttons);
+   connect(buttons,&QDialogButtonBox::accepted,&dlg,&QDialog::accept);
+   connect(buttons,&QDialogButtonBox::rejected,&dlg,&QDialog::reject);
+   while (dlg.exec() == QDialog::Accepted)
    {
-      line = *iter;
-      stream << line << endl;
-      chan = line.midRef(0,chan_len).toInt();
-      time = line.mid(chan_len,-1).toInt();
-      addChan(chan);
+      QString err;
+      if (parseGdtSlice(range->text(),chans->text(),slice,err))
+      {
+         gdtSliceRange = range->text().trimmed();
+         gdtSliceChans = chans->text().trimmed();
+         return true;
+      }
+      QMessageBox::warning(&dlg,tr("Records To Use"),err);
    }
-   stream << qSetFieldWidth(chan_len) << GDT_END << qSetFieldWidth(t_wid) << ++time << qSetFieldWidth(0) <<endl;
+   ui->gbatchTerm->printWarn("Creating a .gdt file cancelled.\n");
+   return false;
+}
 
-   setBaseMod(justName);
+// The .gdt file has been made, finish up.
+void GravityGui::makeGDTDone(const QString &fName, const QString &bdtName, FTYPE ftype, const GdtMade &made)
+{
+   QString msg;
+   QFileInfo readInfo(uncompressedName(fName));
+
+   setBaseMod(readInfo.completeBaseName());
 
    bool maxSpikes = false;
-   for (auto &chan : bdtList)
+   for (auto &chan : made.counts)
    {
       if (chan.second > MAX_SPIKES)
       {
@@ -606,18 +652,59 @@ void GravityGui::makeGDT()
    }
    if (maxSpikes)
    {
-      QTextStream(&msg) << tr("Warning: Some of the gravity programs limit the maximum number of spikes to ") << MAX_SPIKES << "." << endl << tr("Some programs may hang or crash if you use this .gdt file") << endl << tr("Use scope or other programs to create a shorter .edt, .bdt or .adt file and make a new .gdt file.") << endl;
+      msg.clear();
+      QTextStream(&msg) << tr("Warning: Some of the gravity programs limit the maximum number of spikes to ") << MAX_SPIKES << "." << endl << tr("Some programs may hang or crash if you use this .gdt file") << endl << tr("Make a new .gdt file with a shorter time range or fewer channels.") << endl;
       ui->gbatchTerm->printWarn(msg);
       msg.clear();
+      int from, to;
+      if (made.bins.widestRange(MAX_SPIKES,from,to))
+      {
+         gdtSliceRange = QString("%1-%2").arg(from).arg(to);
+         QTextStream(&msg) << tr("The longest time range that keeps every channel under the limit is ") << gdtSliceRange << endl << tr("That will be filled in for you the next time you create a .gdt file.") << endl;
+         ui->gbatchTerm->append(msg);
+         msg.clear();
+      }
+   }
+
+   int refractory = 0;
+   for (auto &chan : made.stats)
+   {
+      if (chan.second.refractory)
+      {
+         ++refractory;
+         msg.clear();
+         QTextStream(&msg) << tr("Channel ") << chan.first << tr(" has ") << chan.second.refractory << tr(" spikes less than 1 ms after the one before.") << endl;
+         ui->gbatchTerm->append(msg);
+      }
+   }
+   if (refractory)
+   {
+      msg.clear();
+      QTextStream(&msg) << tr("Warning: ") << refractory << tr(" channels have refractory period violations, check the spike sorting.") << endl;
+      ui->gbatchTerm->printWarn(msg);
    }
 
      // to pick up analog channels, create a symbolic link to adt, .bdt file. 
-     // If we created a local .bdt from a .edt file, the link call will
-     // fail, but we don't care.
-   QFile::link(fName,readInfo.fileName());
+     // If the file is already here, the link call will fail, but we don't
+     // care. An .edt is no use to the programs, they get the .bdt we made.
+     // Nor is a compressed file.
+   if (ftype != FTYPE::EDT && compressionOf(fName) != Compression::NONE)
+   {
+      msg.clear();
+      QTextStream(&msg) << tr("Note: programs that use the analog channels need ") << readInfo.fileName() << tr(" uncompressed in the session directory.") << endl;
+      ui->gbatchTerm->printWarn(msg);
+   }
+   else if (ftype != FTYPE::EDT)
+      QFile::link(fName,readInfo.fileName());
+   else if (bdtName.length())
+   {
+      msg.clear();
+      QTextStream(&msg) << tr("Created ") << bdtName << endl;
+      ui->gbatchTerm->append(msg);
+   }
+   msg.clear();
    QTextStream(&msg) << tr("Done.") << endl;
    ui->gbatchTerm->append(msg);
-   QApplication::restoreOverrideCursor();
 }
 
 // Load gdt file button clicked. If we are loading this directly, it may be a
@@ -629,6 +716,8 @@ void GravityGui::gdtFileOpen()
    QString msg;
 
    gbatchSwitch();
+   if (ioBusy())
+      return;
    checkDirty();
 
    QString fName = QFileDialog::getOpenFileName(this,
@@ -639,34 +728,30 @@ void GravityGui::gdtFileOpen()
       warnTooLong(readInfo.completeBaseName());
       return;
    }
-   gdtFileLoad(fName);
-   selectedChans.clear();
-   validateGDT();
-   for (int row = 0 ; row < ui->neuroChans->count(); ++row)
-   {
-      QListWidgetItem *item = ui->neuroChans->item(row);
-      QObject *obj = ui->neuroChans->itemWidget(item);
-      QCheckBox *cb = dynamic_cast<QCheckBox*>(obj);
-      if (cb)
-         cb->setCheckState(Qt::Unchecked);
-   }
-   paramsDirty();
+   gdtFileLoad(fName,[this]() {
+      selectedChans.clear();
+      validateGDT();
+      neuroModel->refresh();
+      paramsDirty();
+   });
 }
 
 // Two ways to get here, via button click or from loading a param file.
 // The .gdt file, if it exists, sets the basename for other filenames we
 // create or pass on to other programs.
-void GravityGui::gdtFileLoad(QString fName)
+// The file is read in the background. After that, or right away if there
+// is nothing to read, whenLoaded is called. It is not called if the user
+// cancels the load. The file name is only taken once it has loaded.
+void GravityGui::gdtFileLoad(QString fName, function<void()> whenLoaded)
 {
    QString msg;
 
    if (fName.length())
    {
+      if (ioBusy())
+         return;
       QFileInfo readInfo(fName);
       QString justName =readInfo.completeBaseName();
-      gdtSelFName = readInfo.fileName();
-      ui->gdtFullName->setText(gdtSelFName);
-      setBaseMod(justName);
       QFile file(fName);
       if (!file.open(QIODevice::ReadOnly))
       {
@@ -675,36 +760,236 @@ void GravityGui::gdtFileLoad(QString fName)
       }
       else
       {
-         QApplication::setOverrideCursor(Qt::WaitCursor);
-         ui->gbatchTerm->repaint();
+         file.close();
          QTextStream(&msg) << tr("Loading ") << fName << endl;
          ui->gbatchTerm->append(msg);
          QDir::setCurrent(readInfo.canonicalPath()); // make src the cwd
-         QString all = file.readAll();
-         if (!makeChanList(all))
+         QString path = readInfo.canonicalFilePath();
+         auto info = make_shared<GdtInfo>();
+         auto err = make_shared<QString>();
+         auto loaded = [=](bool valid, const GdtStamp &stamp) {
+            if (!valid && gdtWorker->wasCancelled())
+            {
+               ui->gbatchTerm->printWarn(*err);
+               return;
+            }
+            if (!makeChanList(*info) || !valid)
+            {
+               ui->gbatchTerm->printWarn(*err);
+               gdtSelFName.clear();     // the lists are not the old file's now
+               ui->gdtFullName->clear();
+               gdtWatch->stop();
+               analogExtract->stop();
+               loadRaster();
+            }
+            else
+            {
+               gdtSelFName = readInfo.fileName();
+               ui->gdtFullName->setText(gdtSelFName);
+               setBaseMod(justName);
+               haveGDT=true;
+               ui->gBatch->setEnabled(true);
+               gdtWatch->watch(path,stamp,*info);
+               analogExtract->start(path,*info);
+               loadRaster();
+            }
+            if (whenLoaded)
+               whenLoaded();
+         };
+         bool cached = gdtCache->find(path,*info);
+         showCacheCounts();
+         if (cached)
          {
-            QString msg;
-            QTextStream(&msg) << tr("This not a valid .gdt file ") << fName << endl;
-            ui->gbatchTerm->printWarn(msg);
-            file.close();
+            loaded(true,gdtStamp(path));
             return;
          }
-         file.close();
-         haveGDT=true;
-         ui->gBatch->setEnabled(true);
-         QApplication::restoreOverrideCursor();
+         GdtStamp stamp = gdtStamp(path);     // before, in case it changes while we read it
+         gdtWorker->start([=](const IoProgress &progress) {
+               if (!loadGdtInfo(path,*info,*err,progress))
+                  return false;
+               gdtCache->insert(path,stamp,*info);
+               return true;
+            },
+            [=](bool valid) {
+               showCacheCounts();
+               loaded(valid,stamp);
+            });
+         return;
       }
    }
+   if (whenLoaded)
+      whenLoaded();
+}
+
+// The .gdt file that is loaded was changed by something else. If records
+// were only added, just those are read. The channel list and time span
+// are put up again, and the channels the user picked stay picked, unless
+// they are not in the file any more. If it has no end mark, it is likely
+// still being written, so the picks are left alone until it is done.
+void GravityGui::gdtFileChanged(const QString &path)
+{
+   QString msg;
+
+   if (gdtWorker->isBusy())     // ours, say making this file, try after
+   {
+      gdtWatch->retry();
+      return;
+   }
+   auto before = make_shared<GdtInfo>(gdtWatch->info());
+   auto info = make_shared<GdtInfo>();
+   auto appended = make_shared<bool>(false);
+   auto err = make_shared<QString>();
+   GdtStamp stamp = gdtStamp(path);
+   QTextStream(&msg) << path << tr(" has changed, loading it again.") << endl;
+   ui->gbatchTerm->append(msg);
+   gdtWorker->start([=](const IoProgress &progress) {
+         if (!reloadGdtInfo(path,*before,*info,*appended,*err,progress))
+            return false;
+         gdtCache->insert(path,stamp,*info);
+         return true;
+      },
+      [=](bool valid) {
+         QString note;
+
+         showCacheCounts();
+         if (gdtWatch->path() != path)     // another file was loaded since
+            return;
+         if (!valid)
+         {
+            ui->gbatchTerm->printWarn(*err);
+            gdtWatch->watch(path,stamp,*before);   // try again on the next change
+            return;
+         }
+         if (*appended)
+         {
+            QTextStream(&note) << tr("Read only the records added to ") << path << endl;
+            ui->gbatchTerm->append(note);
+         }
+         gdtWatch->watch(path,stamp,*info);
+         analogExtract->start(path,*info);
+         if (!makeChanList(*info))
+         {
+            note.clear();
+            QTextStream(&note) << tr("This not a valid .gdt file ") << path << endl;
+            ui->gbatchTerm->printWarn(note);
+            return;
+         }
+         if (info->endMark)
+            validateGDT();
+         else
+            ui->selParticles->setText(QString::number(selectedChans.size()));
+         neuroModel->refresh();
+         loadRaster();
+      });
+}
+
+// The raster of the .gdt file that is loaded, in a window of its own that
+// is made the first time. Clicking a row picks the channel the same as
+// clicking it in the list.
+void GravityGui::showRaster()
+{
+   if (!rasterWin)
+   {
+      rasterWin = new QDialog(this);
+      rasterWin->setWindowTitle(tr("Spike Raster"));
+      rasterWin->resize(900,600);
+      raster = new RasterView(rasterWin);
+      raster->setSelection(&selectedChans);
+      QVBoxLayout *layout = new QVBoxLayout(rasterWin);
+      layout->addWidget(raster);
+      connect(raster,&RasterView::chanClicked,this,[this](int chan) {
+         int row = neuroModel->rowOf(chan);
+         if (row >= 0)
+            neuroModel->setData(neuroModel->index(row),selectedChans.has(chan) ? Qt::Unchecked : Qt::Checked,
+                                Qt::CheckStateRole);
+      });
+      connect(neuroModel,&QAbstractItemModel::dataChanged,raster,[this]() { raster->update(); });
+   }
+   rasterWin->show();
+   rasterWin->raise();
+   rasterWin->activateWindow();
+   loadRaster();
+}
+
+// Only while the window is up, it is read again when it is shown. The
+// analog traces are not pulled here, only read from the .ana file.
+void GravityGui::loadRaster()
+{
+   if (!raster || !rasterWin->isVisible())
+      return;
+   if (gdtWatch->path().isEmpty())
+      raster->clear();
+   else
+      raster->load(gdtWatch->path(),gdtWatch->info());
+}
+
+void GravityGui::showCacheCounts()
+{
+   GdtCache::Counts counts = gdtCache->counts();
+   QString text;
+
+   QTextStream(&text) << tr(".gdt cache: ") << counts.hits << tr(" hits, ") << counts.misses << tr(" misses, ")
+                      << counts.files << tr(" files, ") << qSetRealNumberPrecision(2) << fixed
+                      << counts.bytes / 1048576.0 << tr(" of ") << (counts.budget >> 20) << " MB";
+   cacheStatus->setText(text);
+}
+
+void GravityGui::setCacheSize()
+{
+   bool ok;
+   int size = QInputDialog::getInt(this,tr(".gdt File Cache"),tr("Memory for recently loaded .gdt files, in MB.\n0 turns the cache off."),
+                                   gdtCacheMB,0,1 << 16,1,&ok);
+   if (!ok)
+      return;
+   gdtCacheMB = size;
+   gdtCache->setBudget(qint64(gdtCacheMB) << 20);
+   showCacheCounts();
+   if (ui->currentSession->text().length())
+      gdtPrefetch->start(ui->currentSession->text());
+   saveSettings();
+}
+
+// The tab of each program that is running in its terminal is marked, and
+// the status bar has how many are running and waiting.
+void GravityGui::showJobs()
+{
+   for (int tab = TABS::GBATCH; tab < TABS::SAVE; ++tab)
+      ui->termTab->tabBar()->setTabTextColor(tab,jobs->inUse(tabTerm(tab)) ? tabRunning : tabBlack);
+   QString text;
+   QTextStream(&text) << tr("Jobs: ") << jobs->count(JobQueue::RUNNING) << tr(" running, ")
+                      << jobs->count(JobQueue::QUEUED) << tr(" queued");
+   jobStatus->setText(text);
+}
+
+void GravityGui::showJobQueue()
+{
+   if (!jobWin)
+      jobWin = new JobQueueDialog(jobs.get(),this);
+   jobWin->show();
+   jobWin->raise();
+   jobWin->activateWindow();
+}
+
+void GravityGui::setMaxJobs()
+{
+   bool ok;
+   int count = QInputDialog::getInt(this,tr("Jobs at Once"),tr("How many programs can run at the same time.\nOthers wait in the queue."),
+                                    maxJobs,1,256,1,&ok);
+   if (!ok)
+      return;
+   maxJobs = count;
+   jobs->setMaxRunning(maxJobs);
+   saveSettings();
 }
 
 // Load param button click
 void GravityGui::paramLoad()
 {
-   int int_val;
-   int num_particles;
    QString msg;
 
    gbatchSwitch();
+   if (ioBusy())
+      return;
    checkDirty();
 
    QString fName = QFileDialog::getOpenFileName(this,
@@ -714,99 +999,73 @@ void GravityGui::paramLoad()
       paramFName = fName;
       QFileInfo readInfo(fName);
       QString justName =readInfo.fileName();
-      QFile file(fName);
-      if (!file.open(QIODevice::ReadOnly))
+      GravityParams params;
+      QString err;
+      if (!params.load(fName,err))
       {
-         QTextStream(&msg) << tr("Error opening file ") << fName << endl << tr("Error is:               ") << file.errorString();
-         ui->gbatchTerm->printWarn(msg);
+         ui->gbatchTerm->printWarn(err);
+         return;
       }
-      else
-      {
-         selectedChans.clear();
-         QDir::setCurrent(readInfo.canonicalPath()); // make src the cwd
-         ui->paramFullName->setText(justName);
-         QTextStream(&msg) << tr("Loading ") << justName << endl;
-         ui->gbatchTerm->append(msg);
-         QString all = file.readAll();
-           // ignore blank lines or lines with just ws
-         QStringList rows = all.split(QRegularExpression("\\s+"),QString::SkipEmptyParts);
-         QStringList::const_iterator iter = rows.begin();
-         QString t1=*iter;
-         QString t2=*(iter+1);
-         if (rows.size() < PARAM_LINES || !(*iter).contains("100") || !(*(iter+1)).contains(".gout"))
-         {
-            QString msg;
-            QTextStream(&msg) << tr("FATAL: This does not seem to be a valid parameter file.") << endl;
-            ui->gbatchTerm->printWarn(msg);
-            file.close();
-            return;
-         }
-
-          // pick up info from each line of text
-         int_val = ui->shiftValues->findText(*(iter+SHIFT));
-         ui->shiftValues->setCurrentIndex(int_val);
-         num_particles = (*(iter+PARTICLES)).toInt();
-         ui->timeStep->setValue((*(iter+TIMESTEP)).toDouble());
-         ui->slideValue->setText(*(iter+SLIDE));
-         ui->normFactor->setValue((*(iter+NORM)).toInt());
-         int_val = ui->acceptorValues->findData((*(iter+ACCEPTOR)).toInt());
-         ui->acceptorValues->setCurrentIndex(int_val);
-         int_val = ui->effectorValues->findData((*(iter+EFFECTOR)).toInt());
-         ui->effectorValues->setCurrentIndex(int_val);
-         int_val = ui->forceSign->findData((*(iter+FORCE)).toDouble());
-         ui->forceSign->setCurrentIndex(int_val);
-         ui->forwardTau->setValue((*(iter+FWD_TAU)).toDouble());
-         ui->backwardTau->setValue((*(iter+BCK_TAU)).toDouble());
-         ui->forwardInc->setValue((*(iter+FWD_CHG)).toDouble());
-         ui->backCharge->setValue((*(iter+BCK_CHG)).toDouble());
-         ui->wellDiam->setValue((*(iter+WELL_DIAM)).toDouble());
-         int_val = ui->gravityOpts->findText(*(iter+OPTIONS));
-         ui->gravityOpts->setCurrentIndex(int_val);
-         for (int chans = 0; chans < num_particles; ++chans)
-            selectedChans.insert((*(iter+P1_END+chans)).toInt());
-         ui->timeSpan->setValue((*(iter+P1_END+num_particles+TIMESPAN)).toDouble());
-         gdtParamFName = *(iter + P1_END+num_particles+INFILE);
-         gdtFileLoad(gdtParamFName);
-          // the user can just load a .gdt file, in which case, basename and mod
-          // come from that filename. If using a param file, use it as the source
-          // of these items. Over-write what gdtFileLoad did.
-         setBaseMod(readInfo.completeBaseName());
+      selectedChans.clear();
+      QDir::setCurrent(readInfo.canonicalPath()); // make src the cwd
+      ui->paramFullName->setText(justName);
+      QTextStream(&msg) << tr("Loading ") << justName << endl;
+      ui->gbatchTerm->append(msg);
+
+       // pick up info from each line of text
+      ui->shiftValues->setCurrentIndex(ui->shiftValues->findText(params.shift));
+      ui->timeStep->setValue(params.timeStep.toDouble());
+      ui->slideValue->setText(params.slide);
+      ui->normFactor->setValue(params.norm.toInt());
+      ui->acceptorValues->setCurrentIndex(ui->acceptorValues->findData(params.acceptor.toInt()));
+      ui->effectorValues->setCurrentIndex(ui->effectorValues->findData(params.effector.toInt()));
+      ui->forceSign->setCurrentIndex(ui->forceSign->findData(params.force.toDouble()));
+      ui->forwardTau->setValue(params.fwdTau.toDouble());
+      ui->backwardTau->setValue(params.bckTau.toDouble());
+      ui->forwardInc->setValue(params.fwdChg.toDouble());
+      ui->backCharge->setValue(params.bckChg.toDouble());
+      ui->wellDiam->setValue(params.wellDiam.toDouble());
+      ui->gravityOpts->setCurrentIndex(ui->gravityOpts->findText(params.options));
+      for (int chan : params.chans)
+         selectedChans.insert(chan);
+      ui->timeSpan->setValue(params.timeSpan.toDouble());
+      gdtParamFName = params.gdtFile;
+       // the user can just load a .gdt file, in which case, basename and mod
+       // come from that filename. If using a param file, use it as the source
+       // of these items. Over-write what gdtFileLoad did.
+      QString paramBase = readInfo.completeBaseName();
+      gdtFileLoad(gdtParamFName,[this,paramBase]() {
+         setBaseMod(paramBase);
          checkSelected();
-         file.close();
          paramsClean();
-      }
+      });
    }
 }
 
+// Only one .gdt file job at a time.
+bool GravityGui::ioBusy()
+{
+   if (gdtWorker->isBusy())
+   {
+      gbatchSwitch();
+      ui->gbatchTerm->printWarn(tr("A .gdt file is still being made or loaded. Wait for it to finish or cancel it.\n"));
+      return true;
+   }
+   return false;
+}
+
 // We loaded a param file. If it has chans and they are in our checkbox
 // list, check them.
 void GravityGui::checkSelected()
 {
    if (selectedChans.size() == 0)
       return;
-   if (ui->neuroChans->count() == 0)
+   if (neuroModel->rowCount() == 0)
       return;
 
-   validateGDT();
      // check the ones that are in the gdt file and also the param file
-   for (int row = 0 ; row < ui->neuroChans->count(); ++row)
-   {
-      QListWidgetItem *item = ui->neuroChans->item(row);
-      QObject *obj = ui->neuroChans->itemWidget(item);
-      QCheckBox *cb = dynamic_cast<QCheckBox*>(obj);
-      if (cb)
-      {
-         QVariant curr = cb->property("channum");
-         for (auto &val: selectedChans)
-         {
-            if (val == curr)
-            {
-               cb->setCheckState(Qt::Checked);
-               break;
-            }
-         }
-      }
-   }
+   validateGDT();
+   neuroModel->refresh();
 }
 
 
@@ -819,40 +1078,18 @@ void GravityGui::checkSelected()
 void GravityGui::validateGDT()
 {
    QString msg;
-   bool have_val;
-   int sel_chans = 0;
 
    // validate the list. If there are chans in the selected
    // list that are not in the .gdt file, warn the user and remove from selected list
-   for (selChanListIter iter = selectedChans.begin(); iter != selectedChans.end() ; ) 
+   ChanSelection missing = selectedChans;
+   missing -= neuroModel->chans();
+   for (int chan : missing.list())
    {
-      have_val = false;
-      for (int row = 0 ; row < ui->neuroChans->count(); ++row)
-      {
-         QListWidgetItem *item = ui->neuroChans->item(row);
-         QObject *obj = ui->neuroChans->itemWidget(item);
-         QCheckBox *cb = dynamic_cast<QCheckBox*>(obj);
-         if (cb)
-         {
-            QVariant curr = cb->property("channum");
-            if (*iter == curr)
-            {
-               have_val = true;
-               ++sel_chans;
-               break;
-            }
-         }
-      }
-      if (!have_val)
-      {
-         msg.clear();
-         QTextStream(&msg) << tr("Warning: Channel ") << *iter << tr(" is not in the .gdt file.") << endl;
-         ui->gbatchTerm->printWarn(msg);
-         iter = selectedChans.erase(iter);
-      }
-      else
-         ++iter;
+      msg.clear();
+      QTextStream(&msg) << tr("Warning: Channel ") << chan << tr(" is not in the .gdt file.") << endl;
+      ui->gbatchTerm->printWarn(msg);
    }
+   selectedChans -= missing;
    ui->selParticles->setText(QString::number(selectedChans.size()));
    bool maxSpikes = false;
    for (auto &chan : currChans)
@@ -867,7 +1104,7 @@ void GravityGui::validateGDT()
    } 
    if (maxSpikes)
    {
-      QTextStream(&msg) << tr("Warning: Some of the gravity programs limit the maximum number of spikes to ") << MAX_SPIKES << "." << endl << tr("Some programs may hang or crash if you use this .gdt file") << endl << tr("Use scope or other programs to create a shorter .bdt or .adt file and make a new .gdt file.") << endl;
+      QTextStream(&msg) << tr("Warning: Some of the gravity programs limit the maximum number of spikes to ") << MAX_SPIKES << "." << endl << tr("Some programs may hang or crash if you use this .gdt file") << endl << tr("Create a new .gdt file with a shorter time range or fewer channels.") << endl;
       ui->gbatchTerm->printWarn(msg);
    }
 }
@@ -1023,7 +1260,7 @@ void GravityGui::paramSave()
 
    if (fName.length())
    {
-      QString params = buildParams();
+      QString params = buildParams().text();
       QFileInfo readInfo(fName);
       QString justName =readInfo.fileName();
       ui->paramFullName->setText(justName);
@@ -1045,157 +1282,58 @@ void GravityGui::paramSave()
    }
 }
 
-// Collect the contents of various vars and controls and return text
-// that has to same format as a param file.
-QString GravityGui::buildParams()
+// Collect the contents of various vars and controls, in what a param
+// file has.
+GravityParams GravityGui::buildParams()
 {
-   int int_val;
-   QString text;
-   QString params;
-   QTextStream stream(&params);
-   QString basename = ui->baseName->text();
-   QString modstr = ui->fnameMod->text();
-
-   int_val = ui->shiftValues->currentIndex();
-   text = ui->shiftValues->itemText(int_val);
-   stream << text << endl;
-   stream << basename + modstr + ".gout" << endl;
-   stream << selectedChans.size() << endl;
-   stream << ui->timeStep->textFromValue(ui->timeStep->value()) << endl;
-   stream << ui->slideValue->text() << endl;
-   stream << ui->normFactor->text() << endl;
-   stream << (ui->acceptorValues->currentData()).toString() << endl;
-   stream << (ui->effectorValues->currentData()).toString() << endl;
-   stream << (ui->forceSign->currentData()).toString() << endl;
-   stream << "3" << endl;   // rate norm is constant
-   stream << ui->forwardTau->textFromValue(ui->forwardTau->value()) << endl;
-   stream << ui->backwardTau->textFromValue(ui->backwardTau->value()) << endl;
-   stream << ui->forwardInc->textFromValue(ui->forwardInc->value()) << endl;
-   stream << ui->backCharge->textFromValue(ui->backCharge->value()) << endl;
-   stream << ui->wellDiam->textFromValue(ui->wellDiam->value()) << endl;
-   int_val = ui->gravityOpts->currentIndex();
-   text = ui->gravityOpts->itemText(int_val);
-   stream << text << endl;
-   for (auto &chan : selectedChans)
-      stream << chan << endl;
-   stream << "y" << endl;     // "yes" to a prompt
-   stream << gdtSelFName << endl;
-   stream << ui->timeSpan->textFromValue(ui->timeSpan->value()) << endl;
-   for (auto &line : secondPart)  // always same, but has to be there
-      stream << line << endl;
-   stream << basename + modstr + ".pos" << endl;
-   stream << basename + modstr + ".dir" << endl;
-   stream << "e" << endl << endl;
-
+   GravityParams params;
+
+   params.shift = ui->shiftValues->itemText(ui->shiftValues->currentIndex());
+   params.setBase(ui->baseName->text() + ui->fnameMod->text());
+   params.timeStep = ui->timeStep->textFromValue(ui->timeStep->value());
+   params.slide = ui->slideValue->text();
+   params.norm = ui->normFactor->text();
+   params.acceptor = (ui->acceptorValues->currentData()).toString();
+   params.effector = (ui->effectorValues->currentData()).toString();
+   params.force = (ui->forceSign->currentData()).toString();
+   params.fwdTau = ui->forwardTau->textFromValue(ui->forwardTau->value());
+   params.bckTau = ui->backwardTau->textFromValue(ui->backwardTau->value());
+   params.fwdChg = ui->forwardInc->textFromValue(ui->forwardInc->value());
+   params.bckChg = ui->backCharge->textFromValue(ui->backCharge->value());
+   params.wellDiam = ui->wellDiam->textFromValue(ui->wellDiam->value());
+   params.options = ui->gravityOpts->itemText(ui->gravityOpts->currentIndex());
+   params.chans = selectedChans.list();
+   params.gdtFile = gdtSelFName;
+   params.timeSpan = ui->timeSpan->textFromValue(ui->timeSpan->value());
    return params;
 }
 
-// Read the current gdt file we have in memory and build a list of the chans
-bool GravityGui::makeChanList(QString gdt)
+// Build the channel lists from what we found in the current gdt file
+bool GravityGui::makeChanList(const GdtInfo &info)
 {
-   bool start_mark = false;
-   bool end_mark = false;
-   long startTime = 0;
-   long endTime = 0;
-   QString line;
-   int chan, chan_len;
-   chanListPair cl_pair;
-
    currChans.clear();
    analogList.clear();
-   ui->neuroChans->clear();
-   ui->analogChans->clear();
+   neuroModel->clear();
+   analogModel->clear();
    ui->selParticles->setText("0");
 
-   QStringList rows = gdt.split('\n',QString::SkipEmptyParts);
-   QStringList::const_iterator iter = rows.begin();
-   if (*(iter) == "   11 1111111" && *(iter+1) == "   11 1111111")
-   {
-      iter += 2;
-      chan_len = 5;
-   }
-   else
-      chan_len = 2; // if no header, assume a .adt file
-
-    // find first start mark
-   for ( ; iter != rows.end(); ++iter)
-   {
-      line = *iter;
-      chan = line.midRef(0,chan_len).toInt(); // 1st number in string is chan
-      if (chan == GDT_START)
-      {
-         start_mark = true;
-         ++iter;
-         line = *iter;
-         startTime = line.mid(chan_len,-1).toInt();
-         break;
-      }
-   }
-   if (!start_mark)
+   if (!info.startMark)
       return false;
+   currChans = info.chans;
+   analogList = info.analogs;
 
-   for ( ; iter != rows.end(); ++iter)
-   {
-      line = *iter;
-      chan = line.mid(0,chan_len).toInt(); // 1st number in string is chan
-      if (chan == GDT_END && start_mark)
-      {
-         end_mark = true;
-         break;
-      }
-      else
-         endTime = line.mid(chan_len,-1).toInt();
-
-      if (chan < 4096)    // neuron channels
-      {
-         cl_pair = currChans.emplace(chan,0);
-         ++(cl_pair.first->second);  // # spikes
-      }
-      else
-      {
-         chan /= 4096;
-         analogList.insert(chan);
-      }
-   }
-   double elapsed = (endTime - startTime) * (0.5/1000.0);  // seconds
+   double elapsed = (info.endTime - info.startTime) * (0.5/1000.0);  // seconds
    ui->timeSpan->setValue(elapsed);
 
-   QFont font(ui->neuroChans->font());
-   QFontInfo finfo(font);
-   int box;
-   if (finfo.pixelSize() < 11)
-      box = finfo.pixelSize();
-   else
-      box = finfo.pixelSize()+2;
-   QString style;
-   QTextStream(&style) << "QCheckBox::indicator { width: " << box << "px; height: " << box << "px;}";
+   vector<int> chans;
+   chans.reserve(currChans.size());
    for (auto &val : currChans)
-   {
-      QListWidgetItem *item = new QListWidgetItem("",ui->neuroChans);
-      QCheckBox *cb = new QCheckBox("Neuron Chan " + QString::number(val.first));
-      cb->setChecked(false);
-      cb->setProperty("channum",val.first);
-      cb->setFont(font);
-      cb->setStyleSheet(style);
-      ui->neuroChans->setItemWidget(item,cb);
-      neuroMapper->setMapping(cb,val.first);
-      connect(cb,SIGNAL(clicked()),neuroMapper,SLOT(map()));
-   }
-   for (auto &val : analogList)
-   {
-      QListWidgetItem *item = new QListWidgetItem("",ui->analogChans);
-      QCheckBox *cb = new QCheckBox("Analog Chan " + QString::number(val));
-      cb->setChecked(false);
-      cb->setProperty("channum",val);
-      cb->setFont(font);
-      cb->setStyleSheet(style);
-      ui->analogChans->setItemWidget(item,cb);
-      analogMapper->setMapping(cb,val);
-      connect(cb,SIGNAL(clicked()),analogMapper,SLOT(map()));
-   }
+      chans.push_back(val.first);
+   neuroModel->setChans(chans,info.stats);
+   analogModel->setChans(vector<int>(analogList.begin(),analogList.end()));
 
    QString msg;
-   if (!end_mark)
+   if (!info.endMark)
    {
       QTextStream(&msg) << "Warning: No end marker in file" << endl;
       ui->gbatchTerm->printWarn(msg);
@@ -1208,28 +1346,175 @@ bool GravityGui::makeChanList(QString gdt)
 }
 
 
-void GravityGui::neuroClicked(int chan)
+// Right click on the neuron channels, to pick a lot of them at once.
+void GravityGui::neuroMenu(const QPoint &pos)
 {
-   QObject *obj = neuroMapper->mapping(chan);
-   QCheckBox *cb = dynamic_cast<QCheckBox*>(obj);
-   if (cb != nullptr)
+   if (neuroModel->rowCount() == 0)
+      return;
+
+   QMenu menu(this);
+   QAction *all = menu.addAction(tr("Select All"));
+   QAction *none = menu.addAction(tr("Select None"));
+   QAction *invert = menu.addAction(tr("Invert Selection"));
+   menu.addSeparator();
+   QAction *bySpikes = menu.addAction(tr("Select By Spike Count..."));
+   QAction *byRate = menu.addAction(tr("Select By Rate..."));
+   QAction *byNumber = menu.addAction(tr("Select By Channel Number..."));
+   menu.addSeparator();
+   QAction *byParam = menu.addAction(tr("Keep Only Channels In A Param File..."));
+
+   QAction *picked = menu.exec(ui->neuroChans->viewport()->mapToGlobal(pos));
+   const ChanSelection &inList = neuroModel->chans();
+   SelectMode mode = SEL_REPLACE;
+   if (!picked)
+      return;
+   else if (picked == all)
+      applySelection(inList,SEL_REPLACE);
+   else if (picked == none)
+      applySelection(ChanSelection(),SEL_REPLACE);
+   else if (picked == invert)
+   {
+      ChanSelection flip = inList;
+      flip -= selectedChans;
+      applySelection(flip,SEL_REPLACE);
+   }
+   else if (picked == bySpikes)
+   {
+      double lo = 0, hi = MAX_SPIKES;
+      if (askSelectRange(tr("Select By Spike Count"),tr("Spikes"),0,lo,hi,mode))
+         applySelection(neuroModel->chansWhere([lo,hi](int, const ChanStats &stats) {
+            return stats.spikes >= lo && stats.spikes <= hi;
+         },true),mode);
+   }
+   else if (picked == byRate)
    {
-            // todo: limit to 64 max
-      if (cb->checkState() == Qt::Checked)
+      double lo = 0, hi = 1000;
+      if (askSelectRange(tr("Select By Rate"),tr("Spikes/s"),2,lo,hi,mode))
+         applySelection(neuroModel->chansWhere([lo,hi](int, const ChanStats &stats) {
+            return stats.rate() >= lo && stats.rate() <= hi;
+         },true),mode);
+   }
+   else if (picked == byNumber)
+   {
+      QString pattern;
+      if (askSelectPattern(pattern,mode))
       {
-         selectedChans.insert(chan);
-         ui->selParticles->setText(QString::number(selectedChans.size()));
+         QRegularExpression match("\\A(?:" + pattern + ")\\z");     // the whole number
+         applySelection(neuroModel->chansWhere([&match](int chan, const ChanStats &) {
+            return match.match(QString::number(chan)).hasMatch();
+         }),mode);
       }
-      else
+   }
+   else if (picked == byParam)
+   {
+      QString fName = QFileDialog::getOpenFileName(this,tr("Select Parameter File."),"./",tr("Parameter Files (param* *.prm)"));
+      GravityParams params;
+      QString err;
+      if (fName.isEmpty())
+         return;
+      if (!params.load(fName,err))
       {
-         selectedChans.erase(chan);
-         ui->selParticles->setText(QString::number(selectedChans.size()));
+         ui->gbatchTerm->printWarn(err);
+         return;
       }
-      paramsDirty();
+      ChanSelection chans;
+      for (int chan : params.chans)
+         chans.insert(chan);
+      applySelection(chans,SEL_KEEP);
    }
 }
 
-void GravityGui::analogClicked(int /* chan */)
+static QComboBox *selectModeBox(QWidget *parent)
+{
+   QComboBox *box = new QComboBox(parent);
+   box->addItem(QObject::tr("Select only these"),SEL_REPLACE);
+   box->addItem(QObject::tr("Add these to the selection"),SEL_ADD);
+   box->addItem(QObject::tr("Keep only these in the selection"),SEL_KEEP);
+   return box;
+}
+
+bool GravityGui::askSelectRange(const QString &title, const QString &what, int decimals, double &lo, double &hi, SelectMode &mode)
+{
+   QDialog dlg(this);
+   QFormLayout *form = new QFormLayout(&dlg);
+   QDoubleSpinBox *from = new QDoubleSpinBox(&dlg);
+   QDoubleSpinBox *to = new QDoubleSpinBox(&dlg);
+   QComboBox *how = selectModeBox(&dlg);
+   QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel,&dlg);
+
+   dlg.setWindowTitle(title);
+   for (QDoubleSpinBox *box : {from,to})
+   {
+      box->setDecimals(decimals);
+      box->setRange(0,1e9);
+   }
+   from->setValue(lo);
+   to->setValue(hi);
+   form->addRow(what + tr(" from:"),from);
+   form->addRow(tr("to:"),to);
+   form->addRow(how);
+   form->addRow(buttons);
+   connect(buttons,&QDialogButtonBox::accepted,&dlg,&QDialog::accept);
+   connect(buttons,&QDialogButtonBox::rejected,&dlg,&QDialog::reject);
+   if (dlg.exec() != QDialog::Accepted)
+      return false;
+   lo = from->value();
+   hi = to->value();
+   mode = static_cast<SelectMode>(how->currentData().toInt());
+   return true;
+}
+
+bool GravityGui::askSelectPattern(QString &pattern, SelectMode &mode)
+{
+   QDialog dlg(this);
+   QFormLayout *form = new QFormLayout(&dlg);
+   QLineEdit *text = new QLineEdit(&dlg);
+   QComboBox *how = selectModeBox(&dlg);
+   QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel,&dlg);
+
+   dlg.setWindowTitle(tr("Select By Channel Number"));
+   text->setPlaceholderText(tr("a regular expression, e.g. 1[0-9] or 2.*"));
+   form->addRow(tr("Channel numbers:"),text);
+   form->addRow(how);
+   form->addRow(buttons);
+   connect(buttons,&QDialogButtonBox::accepted,&dlg,&QDialog::accept);
+   connect(buttons,&QDialogButtonBox::rejected,&dlg,&QDialog::reject);
+   while (dlg.exec() == QDialog::Accepted)
+   {
+      QRegularExpression check(text->text());
+      if (check.isValid())
+      {
+         pattern = text->text();
+         mode = static_cast<SelectMode>(how->currentData().toInt());
+         return true;
+      }
+      QMessageBox::warning(&dlg,dlg.windowTitle(),tr("That is not a valid regular expression: ") + check.errorString());
+   }
+   return false;
+}
+
+void GravityGui::applySelection(const ChanSelection &picked, SelectMode mode)
+{
+   if (mode == SEL_REPLACE)
+      selectedChans = picked;
+   else if (mode == SEL_ADD)
+      selectedChans |= picked;
+   else
+      selectedChans &= picked;
+   neuroModel->refresh();
+   ui->selParticles->setText(QString::number(selectedChans.size()));
+   paramsDirty();
+}
+
+// The model has already put the channel in selectedChans or taken it out.
+void GravityGui::neuroClicked(int /* chan */, bool /* checked */)
+{
+         // todo: limit to 64 max
+   ui->selParticles->setText(QString::number(selectedChans.size()));
+   paramsDirty();
+}
+
+void GravityGui::analogClicked(int /* chan */, bool /* checked */)
 {
 
 }
@@ -1297,7 +1582,6 @@ void GravityGui::setBaseMod(const QString& name)
 bool GravityGui::setSurrogatesArgs(QStringList& args)
 {
    QString infile;
-   QString tmp;
    QString msg;
 
    // prepare argument list for invocation
@@ -1318,120 +1602,35 @@ bool GravityGui::setSurrogatesArgs(QStringList& args)
          return false;
       }
    }
-   args << infile;
-
-   tmp = ui->shiftValues->currentText();
-   args << "count" << tmp;
-
-   tmp=ui->surrSeed->text();
-   if (tmp.length() != 0)
-      args << "seed" << tmp;
-
-   args << "exclude";
-   analogSetIter a_iter;
-   for (a_iter = analogList.begin(); a_iter != analogList.end(); ++a_iter)
-      args << QString::number(*a_iter+1000);
+   args << surrogateArgs(infile,ui->shiftValues->currentText(),ui->surrSeed->text(),analogList);
    return true; 
 }
 
 
+// Stop the program that has the terminal on the current tab. The ones
+// running without their terminal are stopped from the queue window.
 void GravityGui::quitCurrentProg()
 {
-   int curr = ui->termTab->currentIndex();
-   switch (curr)
-   {
-      case TABS::GBATCH:
-        if (progGbatch && progGbatch->progIsRunning() != QProcess::NotRunning)
-           progGbatch.get()->terminateProg(); 
-        break;
-      case TABS::XTRYDIS:
-        if (progTrydis && progTrydis->progIsRunning() != QProcess::NotRunning)
-           progTrydis.get()->terminateProg(); 
-        break;
-      case TABS::XPROJTM:
-        if (progXprojtm && progXprojtm->progIsRunning() != QProcess::NotRunning)
-           progXprojtm.get()->terminateProg(); 
-        break;
-      case TABS::SURROGATES:
-        if (progSurrogates && progSurrogates->progIsRunning() != QProcess::NotRunning)
-           progSurrogates.get()->terminateProg(); 
-        if (progGsig && progGsig->progIsRunning() != QProcess::NotRunning)
-           progGsig.get()->terminateProg(); 
-        break;
-      case TABS::XSLOPE:
-        if (progXslope && progXslope->progIsRunning() != QProcess::NotRunning)
-           progXslope.get()->terminateProg(); 
-        break;
-      case TABS::SPKPAT:
-        if (progSpkPat && progSpkPat->progIsRunning() != QProcess::NotRunning)
-           progSpkPat.get()->terminateProg(); 
-        break;
-      case TABS::FIREWORKS:
-        if (progFireworks && progFireworks->progIsRunning() != QProcess::NotRunning)
-           progFireworks.get()->terminateProg(); 
-        break;
-      case TABS::THREEDJMP:
-        if (prog3DJmp && prog3DJmp->progIsRunning() != QProcess::NotRunning)
-           prog3DJmp.get()->terminateProg(); 
-        break;
-      case TABS::DIRECT3D:
-        if (prog3d && prog3d->progIsRunning() != QProcess::NotRunning)
-           prog3d.get()->terminateProg(); 
-        break;
-      default:
-        break;
-   }
+   ReplWidget *term = tabTerm(ui->termTab->currentIndex());
+   if (term)
+      jobs->stopIn(term);
 }
 
-// Create bdt from edt. This is from edt2bdt.f
-bool GravityGui::edt2bdt(QString& edt, QString& bdt)
+ReplWidget *GravityGui::tabTerm(int tab)
 {
-   int chan_len = 5;
-   int bdt_t_wid = 8;
-   int time, chan;
-   QFile e_file(edt);
-   QFile b_file(bdt);
-   QString line;
-   QString msg;
-
-   if (!e_file.open(QIODevice::ReadOnly))
+   switch (tab)
    {
-      QTextStream(&msg) << tr("Error opening file ") << edt << endl << tr("Error is: ") << e_file.errorString() << endl;
-      ui->gbatchTerm->printWarn(msg);
-      ui->gbatchTerm->show();
-      return false;
+      case TABS::GBATCH:     return ui->gbatchTerm;
+      case TABS::XTRYDIS:    return ui->xtrydisTerm;
+      case TABS::XPROJTM:    return ui->xprojtmTerm;
+      case TABS::SURROGATES: return ui->surrogatesTerm;
+      case TABS::XSLOPE:     return ui->xslopeTerm;
+      case TABS::SPKPAT:     return ui->spkPatTerm;
+      case TABS::FIREWORKS:  return ui->fireworksTerm;
+      case TABS::THREEDJMP:  return ui->threeDJmpTerm;
+      case TABS::DIRECT3D:   return ui->direct3dTerm;
+      default:               return nullptr;
    }
-
-   if (!b_file.open(QIODevice::WriteOnly))
-   {
-      QTextStream(&msg) << tr("Error opening file ") << bdt << endl << tr("Error is: ") << b_file.errorString() << endl;
-      ui->gbatchTerm->printWarn(msg);
-      return false;
-   }
-
-   e_file.readLine(); // skip header
-   e_file.readLine();
-
-   QTextStream stream(&b_file);
-
-   stream << "   11 1111111" << endl; // write header
-   stream << "   11 1111111" << endl;
-   QApplication::setOverrideCursor(Qt::WaitCursor);
-   ui->gbatchTerm->printWarn("Creating .bdt file. This could take a while. . .\n");
-   ui->gbatchTerm->repaint();
-   while (!e_file.atEnd())
-   {
-      line = e_file.readLine();
-      chan = line.midRef(0,chan_len).toInt();
-      time = line.mid(chan_len,-1).toInt();
-      time /= 5;  // .1 ms to .5 ms res
-      stream.setFieldAlignment(QTextStream::AlignRight);
-      stream << qSetFieldWidth(chan_len) << chan << qSetFieldWidth(bdt_t_wid) << time << qSetFieldWidth(0) << endl;
-   }
-   ui->gbatchTerm->append("Done.\n");
-   QApplication::restoreOverrideCursor();
-   ui->gbatchTerm->repaint();
-   return true;
 }
 
 void GravityGui::warnTooLong(const QString& fname)
@@ -30,12 +30,14 @@ This file is part of the USF Gravity Gui software suite.
 #include "g_prog.h"
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 
 using namespace std;
 
 GravityProg::GravityProg(GravityGui* parent,ReplWidget* term, QString progName):par(parent),terminal(term),program(progName)
 {
    process = make_unique<QProcess>(new QProcess(parent));
+   expect = new PromptEngine(QFileInfo(progName).fileName(),this);
 
    if (qEnvironmentVariableIsEmpty("TERM")) // running from a shortcut?
    {
@@ -47,7 +49,12 @@ GravityProg::GravityProg(GravityGui* parent,ReplWidget* term, QString progName):
       setupterm(0,1,0);          // current term
    clearStr = tigetstr("clear"); // clear screen ESC code for selected terminal
 
-   connect(terminal, &ReplWidget::command, this, [=](QString input) {stdIn(input);});
+   if (terminal)
+      connect(terminal, &ReplWidget::command, this, [=](QString input) {stdIn(input);});
+     // the prompt table says how long a program can be quiet once some
+     // prompts are answered, past that it is likely stuck on something
+     // we don't know
+   connect(expect, &PromptEngine::timedOut, this, [=](const QString &pending, int ms) {stuck(pending,ms);});
    connect(process.get(), &QProcess::readyReadStandardOutput, this, [=](){stdOut();});
    connect(process.get(), &QProcess::readyReadStandardError, this, [=](){stdErr();});
    connect(process.get(), &QProcess::started, this, [=](){progStarted();});
@@ -79,7 +86,10 @@ bool GravityProg::progInvoke(QStringList args)
       process->setTextModeEnabled(true);
       if (!process->waitForStarted(5000))
       {
-         terminal->printWarn("\nProgram failed to start\n");
+         if (terminal)
+            terminal->printWarn("\nProgram failed to start\n");
+         else
+            log += "\nProgram failed to start\n";
          running = false;
       }
    }
@@ -88,24 +98,47 @@ bool GravityProg::progInvoke(QStringList args)
 
 void GravityProg::progStarted()
 {
-   terminal->clear();
-   terminal->reset();
+   if (terminal)
+   {
+      terminal->clear();
+      terminal->reset();
+   }
 }
 
 void GravityProg::progQuit(int code, QProcess::ExitStatus exit_status)
 {
    QString msg;
    QTextStream outstat(&msg);
+   expect->setTimeout(0);
    outstat << endl << program.toLatin1().data() << " has exited.";
 //   if (code !=0 || exit_status != 0)
 //      outstat << " code: " << code << " exit status: " << exit_status;
    outstat << endl;
-   terminal->append(msg);
-   terminal->reset();
+   if (terminal)
+   {
+      terminal->append(msg);
+      terminal->reset();
+   }
+   else
+      log += msg.toLatin1();
    if (process)
       emit progDone(code,exit_status);
 }
 
+// Only a warning, the user can see what it asked and answer or stop it.
+void GravityProg::stuck(const QString &pending, int ms)
+{
+   QString msg;
+   QTextStream(&msg) << endl << program << tr(" has printed nothing for ") << ms / 1000 << tr(" seconds.") << endl;
+   if (pending.trimmed().length())
+      QTextStream(&msg) << tr("It is at: ") << pending.trimmed() << endl;
+   QTextStream(&msg) << tr("It may be asking something that is not answered for it.") << endl;
+   if (terminal)
+      terminal->printWarn(msg);
+   else
+      log += msg.toLatin1();
+}
+
 // environment var(s) come in as entries in a string list, of form:
 // [n] "name"
 // [n+1] "value"
@@ -133,7 +166,10 @@ void GravityProg::stdErr()
    str = prompts;
    QString msg;
    QTextStream(&msg) << "\ngot error: " << str << endl;
-   terminal->printWarn(msg);
+   if (terminal)
+      terminal->printWarn(msg);
+   else
+      log += msg.toLatin1();
 }
 
 void GravityProg::stdOut()
@@ -143,6 +179,13 @@ void GravityProg::stdOut()
    QString str;
 
    prompts = process->readAllStandardOutput();
+   if (!terminal)
+   {
+      log += prompts.replace(clearStr,"");
+      progStdOutText(prompts);
+      progPrompts(expect->feed(QString::fromLatin1(prompts)));
+      return;
+   }
    int have_clear = prompts.indexOf(clearStr);   // handle clear screen esc code
    if (have_clear >= 0)
    {
@@ -152,6 +195,7 @@ void GravityProg::stdOut()
    str = prompts;
    terminal->result(str,false);
    progStdOutText(prompts);
+   progPrompts(expect->feed(str));
 //cout << "stdout: got from app" << endl;
 //cout << str.toLatin1().data() << endl;
 }
@@ -163,6 +207,7 @@ void GravityProg::stdIn(QString input)
    QByteArray charbytes = input.toLatin1();
    if (process)
       process->write(charbytes.data(),charbytes.length());
+   expect->answered();
 }
 
 void GravityProg::logToFile(const QString& msg)
@@ -29,6 +29,7 @@ This file is part of the USF Gravity Gui software suite.
 #include <memory>
 #include "ReplWidget.h"
 #include "gravity_gui.h"
+#include "prompt_engine.h"
 
 class GravityGui;
 
@@ -43,6 +44,8 @@ class GravityProg : public QObject
       QProcess::ProcessState progIsRunning();
       void terminateProg() { process->terminate();}
       void setEnv(QStringList&);
+      void setWorkDir(const QString &dir) { process->setWorkingDirectory(dir); }
+      const QByteArray &output() const { return log; }
 
    public slots:
       void progStarted();
@@ -55,14 +58,18 @@ class GravityProg : public QObject
    signals:
       void progDone(int, QProcess::ExitStatus);
       void progStdOutText(QByteArray);
+      void progPrompts(const QList<PromptMatch>&);   // for each read, even with none
 
    private:
     unique_ptr<QProcess> process;
     QString clearStr;
     GravityGui *par;
-    ReplWidget *terminal;
+    ReplWidget *terminal;      // null if it has none, output goes to log
+    QByteArray log;
+    PromptEngine *expect;      // finds the prompts in the output
     QString program;
     void logToFile(const QString& msg);
+    void stuck(const QString &pending, int ms);
 };
 
 #endif
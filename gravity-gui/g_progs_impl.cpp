@@ -28,22 +28,68 @@ This file is part of the USF Gravity Gui software suite.
 #include <QFileDialog>
 #include <QFile>
 #include <QDir>
-#include <unistd.h>
+#include <QTimer>
 
 #include "gravity_gui.h"
 #include "ui_gravity_gui.h"
 #include "g_prog.h"
+#include "job_queue.h"
+#include "run_dir.h"
+#include "gravity_params.h"
+#include "prompt_engine.h"
 
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 
+// A job for one of the programs, shown in the terminal on its tab. The
+// prompts found in what the program prints go to gotLine, if it has one.
+JobSpec GravityGui::progJob(const QString &program, ReplWidget *term,
+                            void (GravityGui::*gotLine)(const QList<PromptMatch>&))
+{
+   JobSpec spec;
+   spec.program = program;
+   spec.lane = program;
+   spec.terminal = term;
+   if (gotLine)
+      spec.started = [=](GravityProg *prog, bool) { connect(prog,&GravityProg::progPrompts,this,gotLine); };
+   return spec;
+}
+
+// Give a terminal the keyboard focus, now or after a wait for a program's
+// window to come up and take it. Until then, it is left alone.
+void GravityGui::focusTerm(ReplWidget *term, int delayMs)
+{
+   if (delayMs > 0)
+   {
+      focusWait.insert(term);
+      QTimer::singleShot(delayMs,this,[=]() {
+         focusWait.erase(term);
+         term->activateWindow();
+         term->setFocus();
+      });
+   }
+   else if (!focusWait.count(term))
+   {
+      term->activateWindow();
+      term->setFocus();
+   }
+}
+
+// True if a program said it will be busy a while, so the user can do
+// other things and we do not take the focus.
+static bool longRun(const QList<PromptMatch> &prompts)
+{
+   for (const PromptMatch &prompt : prompts)
+      if (prompt.kind == PromptKind::LONG_RUN)
+         return true;
+   return false;
+}
+
 //  GBATCH
-// button click to invoke program
+// button click to queue the program. It does not ask anything, so it can
+// run without its terminal, and gbatch runs for different base names can
+// run side by side.
 void GravityGui::doGbatch()
 {
-      // just one instance
-   if (progGbatch && progGbatch->progIsRunning() != QProcess::NotRunning)
-      return;
-
    gbatchSwitch();
    if (!haveGDT)
    {
@@ -59,102 +105,102 @@ void GravityGui::doGbatch()
       return;
    }
 
-   progGbatch = make_unique<GravityProg>(this,ui->gbatchTerm,"gbatch");
-   connect(progGbatch.get(), static_cast<void(GravityProg::*)(int,QProcess::ExitStatus)>(&GravityProg::progDone), this, [=](int code,QProcess::ExitStatus exit_status){progGbatchDone(code,exit_status);}); 
-
-    // gbatch crashes if the several files it will create already exist.
-    // Either get permission to delete or or refuse to run gbatch.
    QString base = ui->baseName->text() + ui->fnameMod->text();
-   QString gout = base+".gout";
-   QString pos = base+".pos";
-   QString dir = base+".dir";
-   QFileInfo goutInfo(gout);
-   QFileInfo posInfo(pos);
-   QFileInfo dirInfo(dir);
-   if (goutInfo.exists() || posInfo.exists() || dirInfo.exists())
+   QString gdt = gdtSelFName;
+   int num_sel = selectedChans.size();
+   auto run = make_shared<RunDir>();
+   JobSpec spec = progJob("gbatch",ui->gbatchTerm);
+   spec.lane.clear();
+   spec.interactive = false;
+   spec.priority = JOB_BACKGROUND;
+   spec.input = buildParams().text();
+   spec.ready = [=](JobSpec &job) {
+      QString err;
+      bool ok = run->make(QDir::currentPath(),"gbatch",err) &&
+                (gdt.isEmpty() || !QFileInfo::exists(gdt) || run->linkInput(gdt,err)) &&
+                makeOffsetsGnew(*run,num_sel,err);
+      return runReady(*run,job,ui->gbatchTerm,err,ok);
+   };
+   spec.done = [=](int code, QProcess::ExitStatus status) { runDone(*run,base + "/gbatch",ui->gbatchTerm,code,status); };
+   spec.cancelled = [=]() { run->remove(); };
+   jobs->submit(spec);
+}
+
+// Make a default offsets.gnew file for num_sel selected channels in the
+// run directory, or use the one in the session directory. A new one goes
+// to the results with the rest, so gsig and later runs find it.
+// If using a tuned option, this must exist before gbatch runs.
+bool GravityGui::makeOffsetsGnew(RunDir &run, int num_sel, QString &err)
+{
+   if (num_sel < 2)
+      return true;
+   QFileInfo finfo("offsets.gnew");
+   if (finfo.exists())
    {
       QString msg;
-      QTextStream(&msg) << tr("At least one these files:") << endl << gout << endl << pos << endl << dir << endl << tr("exists. The gbatch program will not run if these files exist.");
+      QTextStream(&msg) << tr("The offsets.gnew file already exists.");
       QMessageBox msgBox(this);
       msgBox.setText(msg);
-      msgBox.setInformativeText(tr("Do you want to delete these files before proceeding?"));
-      msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::Cancel);
+      msgBox.setInformativeText(tr("Do you want a new one for this run? If not, this run uses the one there is."));
+      msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
       msgBox.setDefaultButton(QMessageBox::Yes);
       msgBox.setIcon(QMessageBox::Question);
-      int resp = msgBox.exec();
-      if (resp != QMessageBox::Yes)
-      {
-         ui->gbatchTerm->printWarn("The gbatch program did not run.\n");
-         return;    
-      }
-      else
-      {
-         QFile::remove(gout);
-         QFile::remove(pos);
-         QFile::remove(dir);
-         msg.clear();
-         QTextStream(&msg) << tr("The files ") << gout << " and " << pos << " and " << dir << tr(" hav been deleted.")<<endl;
-         ui->gbatchTerm->append(msg);
-      }
-   }
-   makeOffsetsGnew();  // if using a tuned option, this must exist before gbatch runs
-   if (progGbatch->progInvoke())
-   {
-      ui->gBatch->setEnabled(false);
-      ui->termTab->tabBar()->setTabTextColor(TABS::GBATCH,tabRunning);
-      QString params = buildParams();
-      progGbatch->stdIn(params);
+      if (msgBox.exec() != QMessageBox::Yes)
+         return run.linkInput("offsets.gnew",err);
    }
+
+   return run.writeOffsets(num_sel,err);
 }
 
-void GravityGui::progGbatchDone(int code,QProcess::ExitStatus exit_status)
+// The end of a ready check that set up a run directory. The job runs in
+// it, and what it was given on stdin is kept with its results.
+bool GravityGui::runReady(RunDir &run, JobSpec &job, ReplWidget *term, const QString &err, bool ok)
 {
-   if (ui)
+   if (!ok)
    {
-      ui->termTab->tabBar()->setTabTextColor(TABS::GBATCH,tabBlack);
-      ui->gBatch->setEnabled(true);
-   }
+      QString msg;
+      QTextStream(&msg) << err << tr("The program ") << job.program << tr(" did not run.\n");
+      term->printWarn(msg);
+      run.remove();
+      return false;
+   }
+   job.workDir = run.path();
+   if (!job.input.isEmpty())
+      run.keepRecord(job.program + ".in",job.input.toLatin1());
+   return true;
 }
 
-// Make a defailt offsets.gnew file based on current params
-// Assumes at least 2 neuron channels have been selected.
-void GravityGui::makeOffsetsGnew()
+// A program that ran in a run directory is done. If it got to the end
+// and said it worked, what it made goes to the results, else the run
+// directory is left so what it made can be looked at.
+void GravityGui::runDone(RunDir &run, const QString &result, ReplWidget *term, int code,
+                         QProcess::ExitStatus status)
 {
-   int num_sel = selectedChans.size();
-   if (num_sel > 1)
+   if (!run.isMade() || !ui)
+      return;
+   QString msg, err, version;
+   QStringList files;
+   QDir session;
+   if (status != QProcess::NormalExit)
    {
-      int pair1, pair2;
-      QFileInfo finfo("offsets.gnew");
-      if (finfo.exists())
-      {
-         QString msg;
-         QTextStream(&msg) << tr("The offsets.gnew file already exists.");
-         QMessageBox msgBox(this);
-         msgBox.setText(msg);
-         msgBox.setInformativeText(tr("Do you want to over-write it?"));
-         msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-         msgBox.setDefaultButton(QMessageBox::Yes);
-         msgBox.setIcon(QMessageBox::Question);
-         int resp = msgBox.exec();
-         if (resp != QMessageBox::Yes)
-         return;    
-      }
-
-      QFile file("offsets.gnew");
-      QTextStream text(&file);
-      if (!file.open(QIODevice::WriteOnly))
-      {
-         QString msg;
-         QTextStream(&msg) << tr("Error opening file offsets.gnew ") << endl << tr("Error is:               ") << file.errorString();
-         ui->gbatchTerm->printWarn(msg);
-      }
-      else
-      {
-         for (pair1 = 2; pair1 <= num_sel; ++pair1)
-            for (pair2 = 1; pair2 < pair1; ++pair2)
-               text << pair1 << ", " << pair2 << ", " << "0" << endl;
-         file.close();
-      }
+      QTextStream(&msg) << tr("The program did not finish. What it made is in ") << session.relativeFilePath(run.path()) << endl;
+      term->printWarn(msg);
+   }
+   else if (code != 0)
+   {
+      QTextStream(&msg) << tr("The program failed, exit code ") << code << tr(". What it made is in ")
+                        << session.relativeFilePath(run.path()) << endl;
+      term->printWarn(msg);
+   }
+   else if (!run.promote(result,version,files,err))
+   {
+      QTextStream(&msg) << err << tr("What it made is in ") << session.relativeFilePath(run.path()) << endl;
+      term->printWarn(msg);
+   }
+   else if (files.size())
+   {
+      QTextStream(&msg) << endl << tr("Saved in ") << session.relativeFilePath(version) << ": " << files.join(' ') << endl;
+      term->append(msg);
    }
 }
 
@@ -162,42 +208,26 @@ void GravityGui::makeOffsetsGnew()
 // XTRYDIS
 void GravityGui::doXtrydis()
 {
-   if (progTrydis && progTrydis->progIsRunning() != QProcess::NotRunning)  // just one instance
-      return;
-   progTrydis = make_unique<GravityProg>(this,ui->xtrydisTerm,"xtrydis");
-   connect(progTrydis.get(), static_cast<void(GravityProg::*)(int,QProcess::ExitStatus)>(&GravityProg::progDone), this, [=](int code,QProcess::ExitStatus exit_status){progXtrydisDone(code,exit_status);}); 
-   connect(progTrydis.get(), static_cast<void(GravityProg::*)(QByteArray)>(&GravityProg::progStdOutText), this, [=](QByteArray text){progXtrydisGotLine(text);}); 
-   ui->xtrydisTerm->setPrompt("");
-
+   JobSpec spec = progJob("xtrydis",ui->xtrydisTerm,&GravityGui::progXtrydisPrompts);
+   auto started = spec.started;
+   spec.started = [=](GravityProg *prog, bool shown) {
+      ui->xtrydisTerm->setPrompt("");
+      started(prog,shown);
+   };
    xtrydisSwitch();
-   if (progTrydis->progInvoke())
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::XTRYDIS,tabRunning);
-      ui->xtrydisButton->setEnabled(false);
-   }
-}
-
-void GravityGui::progXtrydisDone(int code,QProcess::ExitStatus exit_status)
-{
-   if (ui)
-   {
-      ui->xtrydisButton->setEnabled(true);
-      ui->termTab->tabBar()->setTabTextColor(TABS::XTRYDIS,tabBlack);
-   }
+   jobs->submit(spec);
 }
 
-void GravityGui::progXtrydisGotLine(QByteArray stuff)
+void GravityGui::progXtrydisPrompts(const QList<PromptMatch> &prompts)
 {
-   QString fName;
-   QByteArray charbytes;
-
-   ui->xtrydisTerm->activateWindow();
-   ui->xtrydisTerm->setFocus();
+   focusTerm(ui->xtrydisTerm);
      // The first prompt from xtrydis is for the .pos file. As a one-time
      // thing, use the current base name and insert the .pos file.
-     // This breaks if the prompt text changes.
-   if (stuff.contains("input file"))
+   for (const PromptMatch &prompt : prompts)
    {
+      if (prompt.kind != PromptKind::POS_FILE)
+         continue;
+      QString fName;
       if (ui->filePrompt->isChecked())
         fName = QFileDialog::getOpenFileName(this,
                       tr("Select .pos file."), "./", ".pos Files (*.pos)");
@@ -207,48 +237,25 @@ void GravityGui::progXtrydisGotLine(QByteArray stuff)
       else
          fName = QFileInfo(fName).fileName();
       
-      charbytes = fName.toLatin1();
-      ui->xtrydisTerm->defaultResponse(charbytes);
+      ui->xtrydisTerm->defaultResponse(fName.toLatin1());
    }
 }
 
 //  XPROJTM
 void GravityGui::doXprojtm()
 {
-   if (progXprojtm && progXprojtm->progIsRunning() != QProcess::NotRunning)
-      return;
-   progXprojtm = make_unique<GravityProg>(this,ui->xprojtmTerm,"xprojtm");
-   connect(progXprojtm.get(), static_cast<void(GravityProg::*)(int,QProcess::ExitStatus)>(&GravityProg::progDone), this, [=](int code,QProcess::ExitStatus exit_status){progXprojtmDone(code,exit_status);}); 
-   connect(progXprojtm.get(), static_cast<void(GravityProg::*)(QByteArray)>(&GravityProg::progStdOutText), this, [=](QByteArray text){progXprojtmGotLine(text);}); 
-
    xprojtmSwitch();
-   if (progXprojtm->progInvoke())
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::XPROJTM,tabRunning);
-      ui->xprojtmButton->setEnabled(false);
-   }
-}
-
-void GravityGui::progXprojtmDone(int code,QProcess::ExitStatus exit_status)
-{
-   if (ui)
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::XPROJTM,tabBlack);
-      ui->xprojtmButton->setEnabled(true);
-   }
+   jobs->submit(progJob("xprojtm",ui->xprojtmTerm,&GravityGui::progXprojtmPrompts));
 }
 
-void GravityGui::progXprojtmGotLine(QByteArray stuff)
+void GravityGui::progXprojtmPrompts(const QList<PromptMatch> &prompts)
 {
-   QString fName;
-   QByteArray charbytes;
-
-   ui->xprojtmTerm->activateWindow();
-   ui->xprojtmTerm->setFocus();
-  
-     // This breaks if the prompt text changes.
-   if (stuff.contains("POSITION FILE NAME"))
+   focusTerm(ui->xprojtmTerm);
+   for (const PromptMatch &prompt : prompts)
    {
+      if (prompt.kind != PromptKind::GOUT_FILE)
+         continue;
+      QString fName;
       if (ui->filePrompt->isChecked())
         fName = QFileDialog::getOpenFileName(this,
                       tr("Select .gout file."), "./", ".gout Files (*.gout)");
@@ -258,39 +265,22 @@ void GravityGui::progXprojtmGotLine(QByteArray stuff)
       else
          fName = QFileInfo(fName).fileName();
 
-      charbytes = fName.toLatin1();
-      ui->xprojtmTerm->defaultResponse(charbytes);
+      ui->xprojtmTerm->defaultResponse(fName.toLatin1());
    }
 }
 
 // EDT_SURROGATES
+// Makes the surrogate spike trains gsig reads, so the two share a lane
+// as well as a terminal, and a gsig queued after this waits for it.
 void GravityGui::doSurrogates()
 {
-   if (progSurrogates && progSurrogates->progIsRunning() != QProcess::NotRunning)  // just one instance
-      return;
-
-   progSurrogates = make_unique<GravityProg>(this,ui->surrogatesTerm,"edt_surrogate");
-   connect(progSurrogates.get(), static_cast<void(GravityProg::*)(int,QProcess::ExitStatus)>(&GravityProg::progDone), this, [=](int code,QProcess::ExitStatus exit_status){progSurrogatesDone(code,exit_status);}); 
-
    surrogatesSwitch();
-   QStringList args;
-   if (setSurrogatesArgs(args))
-      if (progSurrogates->progInvoke(args))
-      {
-         ui->termTab->tabBar()->setTabTextColor(TABS::SURROGATES,tabRunning);
-         ui->surrogatesButton->setEnabled(false);
-         ui->gsigButton->setEnabled(false);
-      }
-}
-
-void GravityGui::progSurrogatesDone(int code,QProcess::ExitStatus exit_status)
-{
-   if (ui)
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::SURROGATES,tabBlack);
-      ui->surrogatesButton->setEnabled(true);
-      ui->gsigButton->setEnabled(true);
-   }
+   JobSpec spec = progJob("edt_surrogate",ui->surrogatesTerm);
+   spec.lane = "surrogates";
+   spec.interactive = false;
+   spec.priority = JOB_BACKGROUND;
+   if (setSurrogatesArgs(spec.args))
+      jobs->submit(spec);
 }
 
 
@@ -298,466 +288,243 @@ void GravityGui::progSurrogatesDone(int code,QProcess::ExitStatus exit_status)
 // shares terminal with SURROGATES
 void GravityGui::doGsig()
 {
-   if (progGsig && progGsig->progIsRunning() != QProcess::NotRunning)
-      return;
-
-      // share terminal with surrogates term
-   progGsig = make_unique<GravityProg>(this,ui->surrogatesTerm,"gsig");
-   connect(progGsig.get(), static_cast<void(GravityProg::*)(int,QProcess::ExitStatus)>(&GravityProg::progDone), this, [=](int code,QProcess::ExitStatus exit_status){progGsigDone(code,exit_status);}); 
-
    gsigSwitch();
-    // gsig (which is gbatch running under a different name)
-    // crashes if it's output file exist from a previous run.
-    // Either get permission to delete or or refuse to run gsig.
-   QDir dir("./");
-   dir.setNameFilters(QStringList() << "sh*.gout" << "sh*.pos" << "sh*.dir");
-   dir.setFilter(QDir::Files);
-   if (!dir.entryList().isEmpty())
-   {
-      QString msg;
-      QTextStream(&msg) << tr("Files from a previous gsig run exist. The gsig program will not run if these files exist.");
-      QMessageBox msgBox(this);
-      msgBox.setText(msg);
-      msgBox.setInformativeText(tr("Do you want to delete these files before proceeding?"));
-      msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::Cancel);
-      msgBox.setDefaultButton(QMessageBox::Yes);
-      msgBox.setIcon(QMessageBox::Question);
-      int resp = msgBox.exec();
-      if (resp != QMessageBox::Yes)
-      {
-         ui->surrogatesTerm->printWarn("The gsig program did not run.\n");
-         return;    
-      }
-      else
-      {
-         foreach(QString dirFile, dir.entryList())
-            dir.remove(dirFile);
-
-         msg.clear();
-         QTextStream(&msg) << tr("The files ") << "sh*.gout, " << "sh*.pos, " << " and sh*.dir " << tr(" have been deleted.")<<endl;
-         ui->surrogatesTerm->append(msg);
-      }
-   }
-
-   if (progGsig->progInvoke())
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::SURROGATES,tabRunning);
-      ui->surrogatesButton->setEnabled(false);
-      ui->gsigButton->setEnabled(false);
-      QString params = buildParams();
-      progGsig->stdIn(params);
-   }
-}
-
-void GravityGui::progGsigDone(int code,QProcess::ExitStatus exit_status)
-{
-   if (ui)
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::SURROGATES,tabBlack);
-      ui->gsigButton->setEnabled(true);
-      ui->surrogatesButton->setEnabled(true);
-   }
+   QString base = ui->baseName->text() + ui->fnameMod->text();
+   QString gdt = gdtSelFName;
+   auto run = make_shared<RunDir>();
+   JobSpec spec = progJob("gsig",ui->surrogatesTerm);
+   spec.lane = "surrogates";
+   spec.shared = true;
+   spec.interactive = false;
+   spec.priority = JOB_BACKGROUND;
+   spec.input = buildParams().text();
+   spec.ready = [=](JobSpec &job) {
+      QString err;
+      bool ok = run->make(QDir::currentPath(),"gsig",err) &&
+                (gdt.isEmpty() || !QFileInfo::exists(gdt) || run->linkInput(gdt,err)) &&
+                run->linkGsigInputs(err);
+      return runReady(*run,job,ui->surrogatesTerm,err,ok);
+   };
+   spec.done = [=](int code, QProcess::ExitStatus status) { runDone(*run,base + "/gsig",ui->surrogatesTerm,code,status); };
+   spec.cancelled = [=]() { run->remove(); };
+   jobs->submit(spec);
 }
 
 
 // XSLOPE
 void GravityGui::doXslope()
 {
-   if (progXslope && progXslope->progIsRunning() != QProcess::NotRunning)  // just one instance
-      return;
-   progXslope = make_unique<GravityProg>(this,ui->xslopeTerm,"xslope");
-   connect(progXslope.get(), static_cast<void(GravityProg::*)(int,QProcess::ExitStatus)>(&GravityProg::progDone), this, [=](int code,QProcess::ExitStatus exit_status){progXslopeDone(code,exit_status);}); 
-   connect(progXslope.get(), static_cast<void(GravityProg::*)(QByteArray)>(&GravityProg::progStdOutText), this, [=](QByteArray text){progXslopeGotLine(text);}); 
-
-
    xslopeSwitch();
-
-   if (progXslope->progInvoke())
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::XSLOPE,tabRunning);
-      ui->xslopeButton->setEnabled(false);
-      waitForWinTime=1;
-   }
-}
-
-void GravityGui::progXslopeDone(int code,QProcess::ExitStatus exit_status)
-{
-   if (ui)
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::XSLOPE,tabBlack);
-      ui->xslopeButton->setEnabled(true);
-   }
+   jobs->submit(progJob("xslope",ui->xslopeTerm,&GravityGui::progXslopePrompts));
 }
 
-void GravityGui::progXslopeGotLine(QByteArray stuff)
+void GravityGui::progXslopePrompts(const QList<PromptMatch> &prompts)
 {
-   QString fName;
-   QByteArray charbytes;
-
-     // This breaks if the prompt text changes.
-   if (stuff.contains("input file"))
-   {
-      if (ui->filePrompt->isChecked())
-        fName = QFileDialog::getOpenFileName(this,
-                      tr("Select .pos file."), "./", ".pos Files (*.pos)");
-      if (!fName.length())
-         fName = ui->baseName->text() + ui->fnameMod->text() + ".pos";
-      else
-         fName = QFileInfo(fName).fileName();
-      charbytes = fName.toLatin1();
-      ui->xslopeTerm->defaultResponse(charbytes);
-   }
-   else if (stuff.contains("CHOOSE DATA"))
+   for (const PromptMatch &prompt : prompts)
    {
-      sleep(waitForWinTime);  // 1st time, let xslope window be drawn and 
-      waitForWinTime=0;       // be given focus, then we'll steal it back
-                              // this works most of the time
-   }
-   else if (stuff.contains("Reading in control"))
-   {
-      return; // This can take a long time, so let user 
-              // do other things, don't steal focus.
+      if (prompt.kind == PromptKind::POS_FILE)
+      {
+         QString fName;
+         if (ui->filePrompt->isChecked())
+           fName = QFileDialog::getOpenFileName(this,
+                         tr("Select .pos file."), "./", ".pos Files (*.pos)");
+         if (!fName.length())
+            fName = ui->baseName->text() + ui->fnameMod->text() + ".pos";
+         else
+            fName = QFileInfo(fName).fileName();
+         ui->xslopeTerm->defaultResponse(fName.toLatin1());
+      }
+      else if (prompt.kind == PromptKind::WINDOW_UP)
+         focusTerm(ui->xslopeTerm,prompt.delayMs);  // 1st time, let the xslope window be
+                                                    // drawn and take focus, then steal it back
    }
-   ui->xslopeTerm->activateWindow();
-   ui->xslopeTerm->setFocus();
+   if (!longRun(prompts))
+      focusTerm(ui->xslopeTerm);
 }
 
 
-// SPK family of functions. Only one of these can run at a time.
-// The button event handler passes the program name.
+// SPK family of functions. They ask things, so only one runs at a time,
+// in the spkpat terminal. The button event handler passes the program name.
 void GravityGui::doSpkPat(QString progname)
 {
-      // just one instance
-   if (progSpkPat && progSpkPat->progIsRunning() != QProcess::NotRunning)
-      return;
-   progSpkPat = make_unique<GravityProg>(this,ui->spkPatTerm,progname);
-   connect(progSpkPat.get(), static_cast<void(GravityProg::*)(int,QProcess::ExitStatus)>(&GravityProg::progDone), this, [=](int code,QProcess::ExitStatus exit_status){progSpkPatDone(code,exit_status);}); 
-   connect(progSpkPat.get(), static_cast<void(GravityProg::*)(QByteArray)>(&GravityProg::progStdOutText), this, [=](QByteArray text){progSpkPatGotLine(text);}); 
-
-   QStringList env({"newsur","1"});
-   progSpkPat.get()->setEnv(env);
-
+   QString base = ui->baseName->text() + ui->fnameMod->text();
+   auto run = make_shared<RunDir>();
+   JobSpec spec = progJob(progname,ui->spkPatTerm,&GravityGui::progSpkPatPrompts);
+   spec.env = QStringList({"newsur","1"});
+   spec.ready = [=](JobSpec &job) {
+      QString err;
+      bool ok = run->make(QDir::currentPath(),progname,err) && run->linkSpkPatInputs(err);
+      return runReady(*run,job,ui->spkPatTerm,err,ok);
+   };
+   spec.done = [=](int code, QProcess::ExitStatus status) {
+      runDone(*run,base.isEmpty() ? progname : base + "/" + progname,ui->spkPatTerm,code,status);
+   };
+   spec.cancelled = [=]() { run->remove(); };
    spkPatSwitch();
-
-    // The spkpat programs crashes if their output files exist from a previous
-    // run.  Either get permission to delete or or refuse to run.
-   QDir dir("./");
-   dir.setNameFilters(QStringList() << "*.spk" << "*.txt" << "*.fwk");
-   dir.setFilter(QDir::Files);
-   if (!dir.entryList().isEmpty())
-   {
-      QString msg;
-      QTextStream(&msg) << tr("Files from a previous run of one of the spkpat programs exist. This  program will not run if these files exist.");
-      QMessageBox msgBox(this);
-      msgBox.setText(msg);
-      msgBox.setInformativeText(tr("Do you want to delete these files before proceeding?"));
-      msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::Cancel);
-      msgBox.setDefaultButton(QMessageBox::Yes);
-      msgBox.setIcon(QMessageBox::Question);
-      int resp = msgBox.exec();
-      if (resp != QMessageBox::Yes)
-      {
-         msg.clear();
-         QTextStream(&msg) << tr("The program ") << progname << tr(" did not run.\n"); 
-         ui->spkPatTerm->printWarn(msg);
-         return;    
-      }
-      else
-      {
-         foreach(QString dirFile, dir.entryList())
-            dir.remove(dirFile);
-
-         msg.clear();
-         QTextStream(&msg) << tr("The files ") << "*.spk, " << "*.txt, " << " and *.fwk" << tr(" have been deleted.")<<endl;
-         ui->spkPatTerm->append(msg);
-      }
-   }
-
-   if (progSpkPat->progInvoke())
-   {
-      // disable all of the buttons.
-      ui->termTab->tabBar()->setTabTextColor(TABS::SPKPAT,tabRunning);
-      ui->spkpat6bg->setEnabled(false);
-      ui->spkpat6bgr->setEnabled(false);
-      ui->spkpat6kbg->setEnabled(false);
-      ui->spkpatdist->setEnabled(false);
-      ui->spkpatwip->setEnabled(false);
-   }
+   jobs->submit(spec);
 }
 
 
 // Fixed file name by default, but could be others.
 // todo check for prompt for files
-void GravityGui::progSpkPatGotLine(QByteArray stuff)
+void GravityGui::progSpkPatPrompts(const QList<PromptMatch> &prompts)
 {
-   QString fName, saveFName;
-   QByteArray charbytes;
-
-   if (stuff.contains("Input data file name"))
+   for (const PromptMatch &prompt : prompts)
    {
-      if (ui->filePrompt->isChecked())
-        fName = QFileDialog::getOpenFileName(this,
-                      tr("Select .out file."), "idlmov.out", ".out Files (*.out)");
-      if (!fName.length())
-         fName = "idlmov.out";
-      else
-         fName = QFileInfo(fName).fileName();
-      charbytes = fName.toLatin1();
-      ui->spkPatTerm->defaultResponse(charbytes);
-   }
-   else if (stuff.contains("Output data file name"))
-   {
-      saveFName = ui->baseName->text() + ui->fnameMod->text() + ".pat";
-      if (ui->filePrompt->isChecked())
-        fName = QFileDialog::getSaveFileName(this,
-                      tr("Save .pat file."), saveFName, ".pat Files (*.pat)");
-      if (!fName.length())
-         fName = saveFName;
-      else
-         fName = QFileInfo(fName).fileName();
-      charbytes = fName.toLatin1();
-      ui->spkPatTerm->defaultResponse(fName);
-      QFileInfo finfo(fName);
-      if (finfo.exists())
+      QString fName;
+      if (prompt.kind == PromptKind::OUT_FILE)
       {
-         QMessageBox msgBox(this);
-         QString msg;
-         QTextStream(&msg) << tr("The file: ") << fName << tr(" exists.") << endl << tr(" The spkpat family of programs will not run if this files exist.");
-         msgBox.setText(msg);
-         msgBox.setInformativeText(tr("Do you want to delete this file before proceeding?"));
-         msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::Cancel);
-         msgBox.setDefaultButton(QMessageBox::Yes);
-         msgBox.setIcon(QMessageBox::Question);
-         int resp = msgBox.exec();
-         if (resp != QMessageBox::Yes)
-         {
-            progSpkPat->terminateProg();
-            return;
-         }
+         if (ui->filePrompt->isChecked())
+           fName = QFileDialog::getOpenFileName(this,
+                         tr("Select .out file."), "idlmov.out", ".out Files (*.out)");
+         if (!fName.length())
+            fName = "idlmov.out";
          else
-         {
-            QFile::remove(fName);
-         }
+            fName = QFileInfo(fName).fileName();
+         ui->spkPatTerm->defaultResponse(fName.toLatin1());
+      }
+      else if (prompt.kind == PromptKind::PAT_FILE)
+      {
+         QString saveFName = ui->baseName->text() + ui->fnameMod->text() + ".pat";
+         if (ui->filePrompt->isChecked())
+           fName = QFileDialog::getSaveFileName(this,
+                         tr("Save .pat file."), saveFName, ".pat Files (*.pat)");
+         if (!fName.length())
+            fName = saveFName;
+         else
+            fName = QFileInfo(fName).fileName();
+         ui->spkPatTerm->defaultResponse(fName);
       }
    }
-   else if (stuff.contains("control cycles done"))
-   {
-      return; // This can take a long time, so let user 
-              // do other things, don't steal focus.
-   }
-   ui->spkPatTerm->activateWindow();
-   ui->spkPatTerm->setFocus();
-}
-
-
-void GravityGui::progSpkPatDone(int code,QProcess::ExitStatus exit_status)
-{
-   if (ui)
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::SPKPAT,tabBlack);
-      ui->spkpat6bg->setEnabled(true);
-      ui->spkpat6bgr->setEnabled(true);
-      ui->spkpat6kbg->setEnabled(true);
-      ui->spkpatdist->setEnabled(true);
-      ui->spkpatwip->setEnabled(true);
-   }
+   if (!longRun(prompts))
+      focusTerm(ui->spkPatTerm);
 }
 
 
 // FIREWORKS
 void GravityGui::doFireworks()
 {
-      // just one instance
-   if (progFireworks && progFireworks->progIsRunning() != QProcess::NotRunning)
-      return;
-
-   progFireworks = make_unique<GravityProg>(this,ui->fireworksTerm,"fireworks");
-   connect(progFireworks.get(), static_cast<void(GravityProg::*)(int,QProcess::ExitStatus)>(&GravityProg::progDone), this, [=](int code,QProcess::ExitStatus exit_status){progFireworksDone(code,exit_status);});
-   connect(progFireworks.get(), static_cast<void(GravityProg::*)(QByteArray)>(&GravityProg::progStdOutText), this, [=](QByteArray text){progFireworksGotLine(text);});
-
    fireworksSwitch();
-
-   if (progFireworks->progInvoke())
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::FIREWORKS,tabRunning);
-      ui->fireworksButton->setEnabled(false);
-      waitForWinTime=1;
-   }
+   jobs->submit(progJob("fireworks",ui->fireworksTerm,&GravityGui::progFireworksPrompts));
 }
 
-void GravityGui::progFireworksGotLine(QByteArray stuff)
+void GravityGui::progFireworksPrompts(const QList<PromptMatch> &prompts)
 {
-   QString fName, saveFName;
-   QByteArray charbytes;
-
-   ui->fireworksTerm->activateWindow();
-   ui->fireworksTerm->setFocus();
-   if (stuff.contains("Enter fireworks filename"))
-   {
-      // no obvious default file name and can be many to choose from,
-      // so always prompt for file
-     fName = QFileDialog::getOpenFileName(this,
-                   tr("Select .fwk file."), "./", ".fwk Files (*.fwk)");
-      if (fName.length())  // note: no obvious default file name
-      {
-         fName = QFileInfo(fName).fileName();
-         charbytes = fName.toLatin1();
-         ui->fireworksTerm->defaultResponse(charbytes);
-      }
-      else  // no fname, no fireworks
-      {
-         progFireworks->terminateProg();
-      }
-   }
-   else if (stuff.contains("BDT File for analog"))
+   focusTerm(ui->fireworksTerm);
+   for (const PromptMatch &prompt : prompts)
    {
-      if (analogList.size()) // if no analog, no need for bdt file
+      QString fName;
+      if (prompt.kind == PromptKind::FWK_FILE)
       {
-           // there is no easy way to know what the answer to this prompt is,
-           // so assume they want one. If not, hit cancel. 
+         // no obvious default file name and can be many to choose from,
+         // so always prompt for file
         fName = QFileDialog::getOpenFileName(this,
-                      tr("Select .bdt file or Cancel to skip."), "./", ".bdt Files (*.bdt)");
-         if (fName.length())
+                      tr("Select .fwk file."), "./", ".fwk Files (*.fwk)");
+         if (fName.length())  // note: no obvious default file name
          {
             fName = QFileInfo(fName).fileName();
-            charbytes = fName.toLatin1();
-            ui->fireworksTerm->defaultResponse(charbytes);
+            ui->fireworksTerm->defaultResponse(fName.toLatin1());
+         }
+         else  // no fname, no fireworks
+         {
+            jobs->stopIn(ui->fireworksTerm);
+            return;
          }
       }
-      else
+      else if (prompt.kind == PromptKind::BDT_FILE)
       {
-         ui->fireworksTerm->fakeEnter();
+         if (analogList.size()) // if no analog, no need for bdt file
+         {
+              // there is no easy way to know what the answer to this prompt is,
+              // so assume they want one. If not, hit cancel. 
+           fName = QFileDialog::getOpenFileName(this,
+                         tr("Select .bdt file or Cancel to skip."), "./", ".bdt Files (*.bdt)");
+            if (fName.length())
+            {
+               fName = QFileInfo(fName).fileName();
+               ui->fireworksTerm->defaultResponse(fName.toLatin1());
+            }
+         }
+         else
+         {
+            ui->fireworksTerm->fakeEnter();
+         }
       }
+      else if (prompt.kind == PromptKind::WINDOW_UP)
+         focusTerm(ui->fireworksTerm,prompt.delayMs);  // 1st time, let the fireworks window be
+                                                       // drawn and take focus, then steal it back
    }
-   else if (stuff.contains("next page"))
-   {
-      sleep(waitForWinTime);  // 1st time, let xslope window be drawn and 
-      waitForWinTime=0;       // be given focus, then we'll steal it back
-                              // this works most of the time
-   }
-
-   ui->fireworksTerm->activateWindow();
-   ui->fireworksTerm->setFocus();
-}
-
-void GravityGui::progFireworksDone(int code,QProcess::ExitStatus exit_status)
-{
-   if (ui)
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::FIREWORKS,tabBlack);
-      ui->fireworksButton->setEnabled(true);
-   }
+   focusTerm(ui->fireworksTerm);
 }
 
-
 // 3DJMP
 void GravityGui::do3DJmp()
 {
-      // just one instance
-   if (prog3DJmp && prog3DJmp->progIsRunning() != QProcess::NotRunning)
-      return;
-
-   prog3DJmp = make_unique<GravityProg>(this,ui->threeDJmpTerm,"3djmp");
-   connect(prog3DJmp.get(), static_cast<void(GravityProg::*)(int,QProcess::ExitStatus)>(&GravityProg::progDone), this, [=](int code,QProcess::ExitStatus exit_status){prog3DJmpDone(code,exit_status);});
-   connect(prog3DJmp.get(), static_cast<void(GravityProg::*)(QByteArray)>(&GravityProg::progStdOutText), this, [=](QByteArray text){prog3DJmpGotLine(text);});
-
    threeDJmpSwitch();
-
-   if (prog3DJmp->progInvoke())
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::THREEDJMP,tabRunning);
-      ui->threeDJmpButton->setEnabled(false);
-   }
+   jobs->submit(progJob("3djmp",ui->threeDJmpTerm,&GravityGui::prog3DJmpPrompts));
 }
 
-void GravityGui::prog3DJmpGotLine(QByteArray stuff)
+void GravityGui::prog3DJmpPrompts(const QList<PromptMatch> &prompts)
 {
-   QString fName;
-   QByteArray charbytes;
-
-   if (stuff.contains("Input data file"))
-   {
-      // no obvious default file name and can be many to choose from,
-      // so always prompt for file
-     fName = QFileDialog::getOpenFileName(this,
-                   tr("Select .spk .out file."), "./", ".spk and .out Files (*.spk *.out)");
-      if (fName.length())
-      {
-         fName = QFileInfo(fName).fileName();
-         charbytes = fName.toLatin1();
-         ui->threeDJmpTerm->defaultResponse(charbytes);
-      }
-   }
-   else if (stuff.contains("BDT File"))
+   for (const PromptMatch &prompt : prompts)
    {
-      if (analogList.size()) // if no analog, no need for bdt file
+      QString fName;
+      if (prompt.kind == PromptKind::SPK_FILE)
       {
-           // there is no easy way to know what the answer to this prompt is,
-           // so assume they want one. If not, hit cancel. 
+         // no obvious default file name and can be many to choose from,
+         // so always prompt for file
         fName = QFileDialog::getOpenFileName(this,
-                      tr("Select .bdt file or Cancel to skip."), "./", ".bdt Files (*.bdt)");
+                      tr("Select .spk .out file."), "./", ".spk and .out Files (*.spk *.out)");
          if (fName.length())
          {
             fName = QFileInfo(fName).fileName();
-            charbytes = fName.toLatin1();
-            ui->threeDJmpTerm->defaultResponse(charbytes);
+            ui->threeDJmpTerm->defaultResponse(fName.toLatin1());
          }
       }
-      else
+      else if (prompt.kind == PromptKind::BDT_FILE)
       {
-         ui->threeDJmpTerm->fakeEnter();
+         if (analogList.size()) // if no analog, no need for bdt file
+         {
+              // there is no easy way to know what the answer to this prompt is,
+              // so assume they want one. If not, hit cancel. 
+           fName = QFileDialog::getOpenFileName(this,
+                         tr("Select .bdt file or Cancel to skip."), "./", ".bdt Files (*.bdt)");
+            if (fName.length())
+            {
+               fName = QFileInfo(fName).fileName();
+               ui->threeDJmpTerm->defaultResponse(fName.toLatin1());
+            }
+         }
+         else
+         {
+            ui->threeDJmpTerm->fakeEnter();
+         }
       }
    }
-   ui->threeDJmpTerm->activateWindow();
-   ui->threeDJmpTerm->setFocus();
+   focusTerm(ui->threeDJmpTerm);
 }
 
 
-void GravityGui::prog3DJmpDone(int code,QProcess::ExitStatus exit_status)
-{
-   if (ui)
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::THREEDJMP,tabBlack);
-      ui->threeDJmpButton->setEnabled(true);
-   }
-}
-
 // Direct 3D family of functions. Only one of these can run at a time.
 // The button event handler passes the program name.
 void GravityGui::doDirect3d(QString progname)
 {
-      // just one instance
-   if (prog3d && prog3d->progIsRunning() != QProcess::NotRunning)
-      return;
-   prog3d = make_unique<GravityProg>(this,ui->direct3dTerm,progname);
-   connect(prog3d.get(), static_cast<void(GravityProg::*)(int,QProcess::ExitStatus)>(&GravityProg::progDone), this, [=](int code,QProcess::ExitStatus exit_status){prog3dDone(code,exit_status);});
-   connect(prog3d.get(), static_cast<void(GravityProg::*)(QByteArray)>(&GravityProg::progStdOutText), this, [=](QByteArray text){prog3dGotLine(text);});
-
+   JobSpec spec = progJob(progname,ui->direct3dTerm,&GravityGui::prog3dPrompts);
+   spec.lane = "direct3d";
    direct3dSwitch();
-
-   if (prog3d->progInvoke())
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::DIRECT3D,tabRunning);
-      // disable all of the buttons.
-      ui->direct3d_bl->setEnabled(false);
-      ui->direct3d_bl_mp->setEnabled(false);
-      ui->direct3d_bl_sig_01->setEnabled(false);
-      ui->direct3d_bl_sig_05->setEnabled(false);
-      ui->direct3d_bl_sub->setEnabled(false);
-   }
+   jobs->submit(spec);
 }
 
-void GravityGui::prog3dGotLine(QByteArray stuff)
+void GravityGui::prog3dPrompts(const QList<PromptMatch> &prompts)
 {
-   QString fName;
-   QByteArray charbytes;
-
-   ui->direct3dTerm->activateWindow();
-   ui->direct3dTerm->setFocus();
-   if (stuff.contains("INPUT *.dir filename"))
+   focusTerm(ui->direct3dTerm);
+   for (const PromptMatch &prompt : prompts)
    {
+      if (prompt.kind != PromptKind::DIR_FILE)
+         continue;
       if (ui->baseName->text().length())
       {
+         QString fName;
          if (ui->filePrompt->isChecked())
            fName = QFileDialog::getOpenFileName(this,
                          tr("Select .dir file."), "./", ".dir Files (*.dir)");
@@ -765,28 +532,13 @@ void GravityGui::prog3dGotLine(QByteArray stuff)
             fName = ui->baseName->text() + ui->fnameMod->text() + ".dir";
          else
             fName = QFileInfo(fName).fileName();
-         charbytes = fName.toLatin1();
-         ui->direct3dTerm->defaultResponse(charbytes);
+         ui->direct3dTerm->defaultResponse(fName.toLatin1());
       }
       else
       {
          ui->direct3dTerm->printWarn("There is no base filename.\nLoad a parameter file, a .gdt file,\nor enter a base filename manually.");
-         prog3d->terminateProg();
+         jobs->stopIn(ui->direct3dTerm);
          return;
       }
    }
 }
-
-
-void GravityGui::prog3dDone(int code,QProcess::ExitStatus exit_status)
-{
-   if (ui)
-   {
-      ui->termTab->tabBar()->setTabTextColor(TABS::DIRECT3D,tabBlack);
-      ui->direct3d_bl->setEnabled(true);
-      ui->direct3d_bl_mp->setEnabled(true);
-      ui->direct3d_bl_sig_01->setEnabled(true);
-      ui->direct3d_bl_sig_05->setEnabled(true);
-      ui->direct3d_bl_sub->setEnabled(true);
-   }
-}
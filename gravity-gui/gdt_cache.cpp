@@ -0,0 +1,128 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutexLocker>
+#include "gdt_cache.h"
+
+using namespace std;
+
+// About what a tree node of each kind costs, for the budget.
+static const int MAP_NODE = 48;
+
+static qint64 infoBytes(const GdtInfo &info)
+{
+   return sizeof(GdtInfo) + qint64(info.chans.size()) * MAP_NODE
+        + qint64(info.stats.size()) * (MAP_NODE + sizeof(ChanStats))
+        + qint64(info.analogs.size()) * MAP_NODE;
+}
+
+GdtStamp gdtStamp(const QString &path)
+{
+   QFileInfo file(path);
+   GdtStamp stamp;
+
+   if (file.exists())
+   {
+      stamp.size = file.size();
+      stamp.mtime = file.lastModified().toMSecsSinceEpoch();
+   }
+   return stamp;
+}
+
+bool GdtCache::find(const QString &path, GdtInfo &info)
+{
+   GdtStamp stamp = gdtStamp(path);
+   QMutexLocker locked(&lock);
+
+   auto found = byPath.find(path);
+   if (found == byPath.end() || !current(found.value(),stamp))
+   {
+      if (found != byPath.end())    // the file has changed
+         drop(found.value());
+      ++misses;
+      return false;
+   }
+   entries.splice(entries.begin(),entries,found.value());
+   info = entries.front().info;
+   ++hits;
+   return true;
+}
+
+bool GdtCache::contains(const QString &path) const
+{
+   GdtStamp stamp = gdtStamp(path);
+   QMutexLocker locked(&lock);
+
+   auto found = byPath.find(path);
+   return found != byPath.end() && current(found.value(),stamp);
+}
+
+void GdtCache::insert(const QString &path, const GdtStamp &stamp, const GdtInfo &info)
+{
+   QMutexLocker locked(&lock);
+
+   auto found = byPath.find(path);
+   if (found != byPath.end())
+      drop(found.value());
+   entries.push_front({path,stamp,info,infoBytes(info)});
+   byPath.insert(path,entries.begin());
+   used += entries.front().bytes;
+   trim();
+}
+
+void GdtCache::setBudget(qint64 bytes)
+{
+   QMutexLocker locked(&lock);
+
+   budget = bytes;
+   trim();
+}
+
+void GdtCache::clear()
+{
+   QMutexLocker locked(&lock);
+
+   entries.clear();
+   byPath.clear();
+   used = 0;
+}
+
+GdtCache::Counts GdtCache::counts() const
+{
+   QMutexLocker locked(&lock);
+
+   return {hits,misses,static_cast<int>(entries.size()),used,budget};
+}
+
+void GdtCache::drop(EntryList::iterator entry)
+{
+   used -= entry->bytes;
+   byPath.remove(entry->path);
+   entries.erase(entry);
+}
+
+// A file bigger than the whole budget isn't kept at all.
+void GdtCache::trim()
+{
+   while (used > budget && !entries.empty())
+      drop(prev(entries.end()));
+}
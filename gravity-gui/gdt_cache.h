@@ -0,0 +1,90 @@
+#ifndef GDT_CACHE_H
+#define GDT_CACHE_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// The .gdt files loaded lately, so going back to one, say from another
+// param file that uses it, doesn't read it again. An entry is only good
+// while the file has the size and time it had when it was loaded. The
+// least recently used files go first when the entries take more memory
+// than the budget. Safe to use from any thread.
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <list>
+#include "gdt_io.h"
+
+const int GDT_CACHE_MB = 64;      // default budget
+
+// When a file was last changed, good enough to tell if it has been.
+struct GdtStamp
+{
+   qint64 size = -1;
+   qint64 mtime = 0;
+   bool operator==(const GdtStamp &other) const { return size == other.size && mtime == other.mtime; }
+};
+
+GdtStamp gdtStamp(const QString &path);
+
+class GdtCache
+{
+   public:
+      explicit GdtCache(qint64 bytes = qint64(GDT_CACHE_MB) << 20) : budget(bytes) {}
+      bool find(const QString &path, GdtInfo &info);    // counts a hit or a miss
+      bool contains(const QString &path) const;         // doesn't count
+      void insert(const QString &path, const GdtStamp &stamp, const GdtInfo &info);
+      void setBudget(qint64 bytes);
+      void clear();
+
+      struct Counts
+      {
+         quint64 hits;
+         quint64 misses;
+         int files;
+         qint64 bytes;
+         qint64 budget;
+      };
+      Counts counts() const;
+
+   private:
+      struct Entry
+      {
+         QString path;
+         GdtStamp stamp;
+         GdtInfo info;
+         qint64 bytes;
+      };
+      using EntryList = std::list<Entry>;
+
+      bool current(EntryList::iterator entry, const GdtStamp &stamp) const { return entry->stamp == stamp; }
+      void drop(EntryList::iterator entry);
+      void trim();
+
+      mutable QMutex lock;
+      EntryList entries;      // most recently used first
+      QHash<QString,EntryList::iterator> byPath;
+      qint64 budget;
+      qint64 used = 0;
+      quint64 hits = 0;
+      quint64 misses = 0;
+};
+
+#endif
@@ -0,0 +1,299 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+// The index file is a fixed header followed by the channel counts, the
+// analog channels, and the stats for each channel, all in the byte order
+// of the machine that wrote it. It is mapped and picked apart in place.
+
+#include <string.h>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QTextStream>
+#include "gdt_index.h"
+
+using namespace std;
+
+static const char INDEX_MAGIC[8] = {'G','D','T','I','N','D','E','X'};
+static const quint32 INDEX_ORDER = 0x01020304;
+static const quint32 INDEX_VERSION = 3;
+
+enum IndexFlags {IDX_START_MARK=1, IDX_END_MARK=2};
+
+struct IndexHeader
+{
+   char magic[8];
+   quint32 order;
+   quint32 version;
+   qint64 fileSize;
+   qint64 fileTime;
+   quint64 fileHash;
+   quint64 headHash;       // GdtInfo::headHash
+   qint64 startTime;
+   qint64 endTime;
+   qint64 startOffset;
+   qint64 endOffset;
+   quint32 flags;
+   quint32 numChans;       // (chan, count) qint32 pairs after the header
+   quint32 numAnalogs;     // then this many qint32 analog chans, then a
+                           // ChanStats for each chan, in the same order
+   quint32 pad;
+};
+static_assert(sizeof(IndexHeader) == 96, "index header must not change size");
+
+// The size and time of a file, the cheap part of its key.
+static void gdtStampKey(const QString &fName, GdtFileKey &key)
+{
+   QFileInfo info(fName);
+
+   key.size = info.size();
+   key.mtime = info.lastModified().toMSecsSinceEpoch();
+}
+
+static bool sameStamp(const GdtFileKey &one, const GdtFileKey &two)
+{
+   return one.size == two.size && one.mtime == two.mtime;
+}
+
+// Size, time, and a hash of all of the bytes.
+bool gdtFileKey(const QString &fName, GdtFileKey &key, QString &err, const IoProgress &progress)
+{
+   QFile file(fName);
+   ScanHash hash;
+
+   if (!file.open(QIODevice::ReadOnly))
+   {
+      QTextStream(&err) << QObject::tr("Error opening file ") << fName << endl << QObject::tr("Error is:               ") << file.errorString() << endl;
+      return false;
+   }
+   gdtStampKey(fName,key);
+   if (!hash.addFile(file,key.size,-1,err,progress))
+      return false;
+   key.hash = hash.digest();
+   return true;
+}
+
+// False if there is no index we can read. If there is one, key is what it
+// was made for, and it is up to the caller to say if that is still so.
+bool readGdtIndex(const QString &idxName, GdtFileKey &key, GdtInfo &info)
+{
+   QFile file(idxName);
+   IndexHeader head;
+
+   if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(head)))
+      return false;
+   const char *data = reinterpret_cast<const char *>(file.map(0,file.size()));
+   if (!data)
+      return false;
+   memcpy(&head,data,sizeof(head));
+   qint64 want = sizeof(head) + qint64(head.numChans) * (2 * sizeof(qint32) + sizeof(ChanStats))
+               + qint64(head.numAnalogs) * sizeof(qint32);
+   bool valid = memcmp(head.magic,INDEX_MAGIC,sizeof(head.magic)) == 0 && head.order == INDEX_ORDER
+             && head.version == INDEX_VERSION && file.size() == want;
+   if (valid)
+   {
+      const char *pos = data + sizeof(head);
+      qint32 vals[2];
+
+      info = GdtInfo();
+      for (quint32 chan = 0; chan < head.numChans; ++chan, pos += sizeof(vals))
+      {
+         memcpy(vals,pos,sizeof(vals));
+         info.chans.emplace_hint(info.chans.end(),vals[0],vals[1]);
+      }
+      for (quint32 analog = 0; analog < head.numAnalogs; ++analog, pos += sizeof(qint32))
+      {
+         memcpy(vals,pos,sizeof(qint32));
+         info.analogs.insert(info.analogs.end(),vals[0]);
+      }
+      for (auto &chan : info.chans)
+      {
+         ChanStats stats;
+         memcpy(&stats,pos,sizeof(stats));
+         pos += sizeof(stats);
+         info.stats.emplace_hint(info.stats.end(),chan.first,stats);
+      }
+      info.startTime = head.startTime;
+      info.endTime = head.endTime;
+      info.startOffset = head.startOffset;
+      info.endOffset = head.endOffset;
+      info.headHash = head.headHash;
+      info.startMark = head.flags & IDX_START_MARK;
+      info.endMark = head.flags & IDX_END_MARK;
+      key.size = head.fileSize;
+      key.mtime = head.fileTime;
+      key.hash = head.fileHash;
+   }
+   file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(data)));
+   return valid;
+}
+
+// Written to a temp file and renamed, so a reader never sees half of one.
+bool writeGdtIndex(const QString &idxName, const GdtFileKey &key, const GdtInfo &info)
+{
+   QSaveFile file(idxName);
+   IndexHeader head;
+   QByteArray body;
+
+   memset(&head,0,sizeof(head));
+   memcpy(head.magic,INDEX_MAGIC,sizeof(head.magic));
+   head.order = INDEX_ORDER;
+   head.version = INDEX_VERSION;
+   head.fileSize = key.size;
+   head.fileTime = key.mtime;
+   head.fileHash = key.hash;
+   head.headHash = info.headHash;
+   head.startTime = info.startTime;
+   head.endTime = info.endTime;
+   head.startOffset = info.startOffset;
+   head.endOffset = info.endOffset;
+   head.flags = (info.startMark ? IDX_START_MARK : 0) | (info.endMark ? IDX_END_MARK : 0);
+   head.numChans = info.chans.size();
+   head.numAnalogs = info.analogs.size();
+
+   body.reserve(info.chans.size() * (2 * sizeof(qint32) + sizeof(ChanStats)) + info.analogs.size() * sizeof(qint32));
+   for (auto &chan : info.chans)
+   {
+      qint32 vals[2] = {chan.first, chan.second};
+      body.append(reinterpret_cast<const char *>(vals),sizeof(vals));
+   }
+   for (int analog : info.analogs)
+   {
+      qint32 val = analog;
+      body.append(reinterpret_cast<const char *>(&val),sizeof(val));
+   }
+   for (auto &chan : info.chans)
+   {
+      auto found = info.stats.find(chan.first);
+      ChanStats stats = found != info.stats.end() ? found->second : ChanStats();
+      body.append(reinterpret_cast<const char *>(&stats),sizeof(stats));
+   }
+
+   if (!file.open(QIODevice::WriteOnly))
+      return false;
+   file.write(reinterpret_cast<const char *>(&head),sizeof(head));
+   file.write(body);
+   return file.commit();
+}
+
+// Scan the file, hashing it on the way, and leave an index for next time.
+// The key is taken before the scan and checked after it. If the file
+// changed while we read it, what we found may be part old and part new,
+// so it is not kept, and there is no head hash for a reload to trust.
+static bool scanAndIndex(const QString &fName, GdtInfo &info, QString &err, const IoProgress &progress,
+                         QThreadPool *pool)
+{
+   GdtFileKey key, now;
+   ScanHash hash;
+
+   gdtStampKey(fName,key);
+   if (!scanGdtFile(fName,info,err,progress,&hash,pool))
+      return false;
+   gdtStampKey(fName,now);
+   info.headHash = 0;
+   if (!sameStamp(key,now) || hash.hashed() != key.size)
+      return true;
+   key.hash = hash.digest();
+   if (info.endMark)
+      info.headHash = hash.head();
+   writeGdtIndex(fName + GDT_INDEX_SUFFIX,key,info);
+   return true;
+}
+
+// What is in a .gdt file, from the index if we can. If not, scan the file
+// and leave an index for next time. Not being able to write the index,
+// say in a read only directory, is not an error. The index is good if the
+// file has the size and time it had. If only the time changed, or verify
+// is set, the file is hashed to see if the contents are the same. A scan
+// is done on pool, if there is one.
+bool loadGdtInfo(const QString &fName, GdtInfo &info, QString &err, const IoProgress &progress, bool verify,
+                 QThreadPool *pool)
+{
+   GdtFileKey key, indexed;
+   GdtInfo found;
+   QString idxName = fName + GDT_INDEX_SUFFIX;
+
+   gdtStampKey(fName,key);
+   bool have = readGdtIndex(idxName,indexed,found);
+   if (have && !verify && sameStamp(key,indexed))
+   {
+      info = found;
+      return true;
+   }
+   if (have && key.size == indexed.size)
+   {
+      if (!gdtFileKey(fName,key,err,progress))
+         return false;
+      if (key.hash == indexed.hash)
+      {
+         info = found;
+         if (!sameStamp(key,indexed))
+            writeGdtIndex(idxName,key,info);     // touched or copied
+         return true;
+      }
+   }
+   return scanAndIndex(fName,info,err,progress,pool);
+}
+
+// The .gdt file before was loaded earlier and has changed since. If the
+// start of it is the same, up to where the end mark was, records were
+// added, so only the new ones are read. Otherwise load it all again.
+// appended says which it was. Only the old start and the new records are
+// hashed, and the hash goes on through the new records as they are read.
+bool reloadGdtInfo(const QString &fName, const GdtInfo &before, GdtInfo &info, bool &appended, QString &err,
+                   const IoProgress &progress)
+{
+   GdtFileKey key, now;
+   GdtInfo grown;
+   ScanHash hash;
+
+   appended = false;
+   gdtStampKey(fName,key);
+   if (before.endMark && before.headHash && key.size > before.endOffset)
+   {
+      QFile file(fName);
+      if (!file.open(QIODevice::ReadOnly))
+      {
+         QTextStream(&err) << QObject::tr("Error opening file ") << fName << endl << QObject::tr("Error is:               ") << file.errorString() << endl;
+         return false;
+      }
+      if (!hash.addFile(file,before.endOffset,-1,err,progress))
+         return false;
+      if (hash.digest() == before.headHash)
+      {
+         if (!scanGdtTail(fName,before,grown,err,progress,&hash))
+            return false;
+         info = grown;
+         info.headHash = 0;
+         appended = true;
+         gdtStampKey(fName,now);
+         if (sameStamp(key,now) && hash.hashed() == key.size)
+         {
+            key.hash = hash.digest();
+            if (info.endMark)
+               info.headHash = hash.head();
+            writeGdtIndex(fName + GDT_INDEX_SUFFIX,key,info);
+         }
+         return true;
+      }
+   }
+   return loadGdtInfo(fName,info,err,progress);
+}
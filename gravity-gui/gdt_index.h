@@ -0,0 +1,49 @@
+#ifndef GDT_INDEX_H
+#define GDT_INDEX_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// The index file kept next to a .gdt file, name.gdt.idx. It holds what
+// scanGdtFile found in the .gdt file so the next load doesn't have to
+// read all of the records again. It is only used if the .gdt file has the
+// same size and time it had when the index was made, or the same contents.
+
+#include <QString>
+#include "gdt_io.h"
+
+const char GDT_INDEX_SUFFIX[] = ".idx";
+
+// What the index is good for.
+struct GdtFileKey
+{
+   qint64 size = 0;
+   qint64 mtime = 0;    // msecs since the epoch
+   quint64 hash = 0;
+};
+
+bool gdtFileKey(const QString &fName, GdtFileKey &key, QString &err, const IoProgress &progress = IoProgress());
+bool readGdtIndex(const QString &idxName, GdtFileKey &key, GdtInfo &info);
+bool writeGdtIndex(const QString &idxName, const GdtFileKey &key, const GdtInfo &info);
+bool loadGdtInfo(const QString &fName, GdtInfo &info, QString &err, const IoProgress &progress = IoProgress(),
+                 bool verify = false, QThreadPool *pool = nullptr);
+bool reloadGdtInfo(const QString &fName, const GdtInfo &before, GdtInfo &info, bool &appended, QString &err,
+                   const IoProgress &progress = IoProgress());
+
+#endif
@@ -0,0 +1,1277 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+// Spike file conversion. These used to read the whole file into a QString
+// and split it into lines, which costs several times the file size and
+// fails on big files. Everything here works a block at a time instead.
+
+#include <string.h>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegularExpression>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <memory>
+#include "gdt_io.h"
+#include "spike_input.h"
+
+using namespace std;
+
+SpikeReader::SpikeReader(QIODevice *dev, int blockSize) : device(dev), capacity(blockSize)
+{
+   buffer.resize(capacity + DECODE_PAD);
+}
+
+// Move the partial line at the end of the buffer to the front and read
+// more after it. If a single line fills the whole buffer, make room.
+bool SpikeReader::refill()
+{
+   if (pos > 0)
+   {
+      memmove(buffer.data(), buffer.constData()+pos, fill-pos);
+      fill -= pos;
+      pos = 0;
+   }
+   if (fill == capacity)
+   {
+      capacity *= 2;
+      buffer.resize(capacity + DECODE_PAD);
+   }
+   qint64 got = device->read(buffer.data()+fill, capacity-fill);
+   if (got < 0)
+      readErr = true;
+   if (got <= 0)
+   {
+      atEof = true;
+      return false;
+   }
+   fill += got;
+   total += got;
+   return true;
+}
+
+bool SpikeReader::nextLine(const char *&line, int &len)
+{
+   while (true)
+   {
+      const char *start = buffer.constData() + pos;
+      const char *nl = static_cast<const char *>(memchr(start,'\n',fill-pos));
+      if (nl)
+      {
+         line = start;
+         len = nl - start;
+         pos += len + 1;
+         return true;
+      }
+      if (atEof)
+      {
+         if (pos == fill)
+            return false;
+         line = start;            // last line has no \n
+         len = fill - pos;
+         pos = fill;
+         return true;
+      }
+      refill();
+   }
+}
+
+// All of the whole lines in the buffer, or what is left at the end.
+bool SpikeReader::nextBlock(const char *&begin, const char *&end)
+{
+   while (true)
+   {
+      const char *start = buffer.constData() + pos;
+      if (pos < fill)
+      {
+         const char *last = atEof ? buffer.constData() + fill - 1
+                                  : static_cast<const char *>(memrchr(start,'\n',fill-pos));
+         if (last)
+         {
+            begin = start;
+            end = last + 1;
+            pos = end - buffer.constData();
+            return true;
+         }
+      }
+      else if (atEof)
+         return false;
+      refill();
+   }
+}
+
+// A copy of the next block, for handing off to another thread. The last
+// DECODE_PAD bytes are not part of the data.
+bool SpikeReader::nextChunk(QByteArray &chunk)
+{
+   const char *begin, *end;
+
+   if (!nextBlock(begin,end))
+      return false;
+   chunk.resize(end - begin + DECODE_PAD);
+   memcpy(chunk.data(),begin,end-begin);
+   memset(chunk.data()+(end-begin),' ',DECODE_PAD);
+   return true;
+}
+
+
+BlockWriter::BlockWriter(QIODevice *dev, int blockSize) : device(dev)
+{
+   buffer.resize(blockSize);
+}
+
+void BlockWriter::write(const char *data, int len)
+{
+   if (fill + len > buffer.size())
+   {
+      flush();
+      if (len > buffer.size())   // too big to bother buffering
+      {
+         if (device->write(data,len) != len)
+            writeErr = true;
+         return;
+      }
+   }
+   memcpy(buffer.data()+fill, data, len);
+   fill += len;
+}
+
+bool BlockWriter::flush()
+{
+   if (fill)
+   {
+      if (device->write(buffer.constData(),fill) != fill)
+         writeErr = true;
+      fill = 0;
+   }
+   return !writeErr;
+}
+
+
+static QString openErr(const QString &fName, const QString &why)
+{
+   QString msg;
+   QTextStream(&msg) << QObject::tr("Error opening file ") << fName << endl << QObject::tr("Error is:               ") << why << endl;
+   return msg;
+}
+
+static QString openErr(const QString &fName, const QFile &file)
+{
+   return openErr(fName,file.errorString());
+}
+
+// Check in with the progress callback, if there is one.
+static bool keepGoing(const IoProgress &progress, qint64 done, qint64 total, QString &err)
+{
+   if (!progress || progress(done,total))
+      return true;
+   err = QObject::tr("Cancelled.\n");
+   return false;
+}
+
+// Hash len bytes that start at offset in the file, less any already
+// hashed. They have to follow on from what was hashed before. If mark is
+// in them, the digest up to it is kept.
+void ScanHash::add(const char *bytes, qint64 offset, qint64 len, qint64 mark)
+{
+   qint64 end = offset + len;
+
+   if (end <= done || offset > done)
+      return;
+   bytes += done - offset;
+   if (mark >= done && mark <= end)
+   {
+      hash.update(bytes,mark - done);
+      headDigest = hash.digest();
+      bytes += mark - done;
+      done = mark;
+   }
+   hash.update(bytes,end - done);
+   done = end;
+}
+
+// Read and hash the file on from where the hash is, up to byte to.
+bool ScanHash::addFile(QFile &file, qint64 to, qint64 mark, QString &err, const IoProgress &progress)
+{
+   if (done >= to)
+      return true;
+   if (!file.seek(done))
+   {
+      err = openErr(file.fileName(),file);
+      return false;
+   }
+   while (done < to)
+   {
+      QByteArray block = file.read(qMin<qint64>(IO_BLOCK,to - done));
+      if (block.isEmpty())
+      {
+         QTextStream(&err) << QObject::tr("Error reading file ") << file.fileName() << endl << QObject::tr("Error is:               ") << file.errorString() << endl;
+         return false;
+      }
+      add(block.constData(),done,block.size(),mark);
+      if (!keepGoing(progress,done,to,err))
+         return false;
+   }
+   return true;
+}
+
+// The start mark goes just before the first record, the end mark just after
+// the last one.
+static void startMark(BlockWriter &writer, int chan_len, int first)
+{
+   writer.writeRecord(GDT_START,chan_len,first - 1 > 0 ? first - 1 : 0,8);
+}
+
+static void endMark(BlockWriter &writer, int chan_len, int last)
+{
+   writer.writeRecord(GDT_END,chan_len,last+1,8);
+}
+
+// Parse the time range, "from-to", "from-", or "-to", and the channel list,
+// such as "1-10,15 20". Either one can be empty for all of them.
+bool parseGdtSlice(const QString &range, const QString &chanText, GdtSlice &slice, QString &err)
+{
+   QString text = range.simplified().remove(' ');
+   bool ok = true;
+
+   slice = GdtSlice();
+   if (text.length())
+   {
+      int dash = text.indexOf('-');
+      if (dash < 0)
+         ok = false;
+      else
+      {
+         QString from = text.left(dash);
+         QString to = text.mid(dash+1);
+         if (from.length())
+            slice.fromTime = from.toInt(&ok);
+         if (ok && to.length())
+            slice.toTime = to.toInt(&ok);
+         if (slice.fromTime < 0 || slice.toTime < slice.fromTime)
+            ok = false;
+      }
+      if (!ok)
+      {
+         err = QObject::tr("The time range should look like 1000-50000, 1000-, or -50000.\n");
+         return false;
+      }
+   }
+
+   QStringList parts = chanText.split(QRegularExpression("[,\\s]+"),QString::SkipEmptyParts);
+   for (const QString &part : parts)
+   {
+      int dash = part.indexOf('-');
+      bool ok_first, ok_last = true;
+      int first = part.left(dash < 0 ? part.length() : dash).toInt(&ok_first);
+      int last = dash < 0 ? first : part.mid(dash+1).toInt(&ok_last);
+      if (!ok_first || !ok_last || first < 0 || last < first || last >= 4096)
+      {
+         QTextStream(&err) << QObject::tr("Can't use channel ") << part << QObject::tr(". Use neuron channels 0 to 4095, like 1-10,15,20.") << endl;
+         return false;
+      }
+      for (int chan = first; chan <= last; ++chan)
+         slice.chans.set(chan);
+      slice.allChans = false;
+   }
+   return true;
+}
+
+
+void SpikeBins::add(int chan, int time)
+{
+   int bin = time > 0 ? time / SLICE_BIN : 0;
+   ChanBins &cb = binsFor(chan);
+
+   if (cb.counts.empty())
+      cb.first = bin;
+   else if (bin < cb.first)
+   {
+      cb.counts.insert(cb.counts.begin(),cb.first-bin,0);
+      cb.first = bin;
+   }
+   if (bin - cb.first >= static_cast<int>(cb.counts.size()))
+      cb.counts.resize(bin - cb.first + 1,0);
+   ++cb.counts[bin - cb.first];
+}
+
+void SpikeBins::merge(const SpikeBins &other)
+{
+   for (int at = 0; at < other.slots.size(); ++at)
+   {
+      const ChanBins &from = other.chans[at];
+      ChanBins &into = binsFor(other.slots.chan(at));
+      if (from.counts.empty())
+         continue;
+      if (into.counts.empty())
+      {
+         into = from;
+         continue;
+      }
+      if (from.first < into.first)
+      {
+         into.counts.insert(into.counts.begin(),into.first-from.first,0);
+         into.first = from.first;
+      }
+      int end = from.first - into.first + from.counts.size();
+      if (end > static_cast<int>(into.counts.size()))
+         into.counts.resize(end,0);
+      for (size_t bin = 0; bin < from.counts.size(); ++bin)
+         into.counts[from.first - into.first + bin] += from.counts[bin];
+   }
+}
+
+QDataStream &operator<<(QDataStream &out, const SpikeBins &bins)
+{
+   out << quint32(bins.chans.size());
+   for (int at : bins.slots.inOrder())
+   {
+      const SpikeBins::ChanBins &cb = bins.chans[at];
+      out << qint32(bins.slots.chan(at)) << qint32(cb.first) << quint32(cb.counts.size());
+      for (int count : cb.counts)
+         out << qint32(count);
+   }
+   return out;
+}
+
+QDataStream &operator>>(QDataStream &in, SpikeBins &bins)
+{
+   quint32 num_chans, num_bins;
+   qint32 chan, first, count;
+
+   bins.slots.clear();
+   bins.chans.clear();
+   in >> num_chans;
+   for (quint32 idx = 0; idx < num_chans && in.status() == QDataStream::Ok; ++idx)
+   {
+      in >> chan >> first >> num_bins;
+      SpikeBins::ChanBins &cb = bins.binsFor(chan);
+      cb.first = first;
+      for (quint32 bin = 0; bin < num_bins && in.status() == QDataStream::Ok; ++bin)
+      {
+         in >> count;
+         cb.counts.push_back(count);
+      }
+   }
+   return in;
+}
+
+QDataStream &operator<<(QDataStream &out, const ChanStats &stats)
+{
+   out << qint64(stats.spikes) << qint32(stats.firstTime) << qint32(stats.lastTime) << stats.isiMean
+       << stats.isiM2 << quint32(stats.refractory);
+   for (int bin = 0; bin < ISI_BINS; ++bin)
+      out << quint32(stats.isiHist[bin]);
+   return out;
+}
+
+QDataStream &operator>>(QDataStream &in, ChanStats &stats)
+{
+   qint64 spikes;
+   qint32 first, last;
+   quint32 count;
+
+   in >> spikes >> first >> last >> stats.isiMean >> stats.isiM2 >> count;
+   stats.spikes = spikes;
+   stats.firstTime = first;
+   stats.lastTime = last;
+   stats.refractory = count;
+   for (int bin = 0; bin < ISI_BINS; ++bin)
+   {
+      in >> count;
+      stats.isiHist[bin] = count;
+   }
+   return in;
+}
+
+// The longest run of bins where no channel has more than maxSpikes, from
+// running totals for each channel. False if there are no spikes or one bin
+// is already too many.
+bool SpikeBins::widestRange(int maxSpikes, int &from, int &to) const
+{
+   int first = INT_MAX;
+   int last = INT_MIN;
+   vector<vector<int>> totals;
+
+   for (const ChanBins &cb : chans)
+   {
+      if (cb.counts.empty())
+         continue;
+      first = min(first,cb.first);
+      last = max(last,cb.first + static_cast<int>(cb.counts.size()));
+   }
+   if (first >= last)
+      return false;
+
+   int bins = last - first;
+   for (const ChanBins &cb : chans)
+   {
+      totals.emplace_back(bins+1,0);
+      vector<int> &total = totals.back();
+      for (int bin = 0; bin < bins; ++bin)
+      {
+         int at = bin + first - cb.first;
+         total[bin+1] = total[bin] + (at >= 0 && at < static_cast<int>(cb.counts.size()) ? cb.counts[at] : 0);
+      }
+   }
+
+   auto fits = [&totals,maxSpikes](int lo, int hi) {
+      for (auto &total : totals)
+         if (total[hi] - total[lo] > maxSpikes)
+            return false;
+      return true;
+   };
+   int lo = 0, best_lo = 0, best_len = 0;
+   for (int hi = 1; hi <= bins; ++hi)
+   {
+      while (lo < hi && !fits(lo,hi))
+         ++lo;
+      if (hi - lo > best_len)
+      {
+         best_len = hi - lo;
+         best_lo = lo;
+      }
+   }
+   if (!best_len)
+      return false;
+   from = static_cast<int>(qMin<qint64>(qint64(first + best_lo) * SLICE_BIN,INT_MAX));
+   to = static_cast<int>(qMin<qint64>(qint64(first + best_lo + best_len) * SLICE_BIN - 1,INT_MAX));
+   return true;
+}
+
+
+// The per channel results are kept in a ChanTally while the records go
+// by, and only turned into the maps the gui wants once, at the end. When
+// adding to an old .gdt file, the tally picks up where it left off.
+static void startTally(const map<int,ChanStats> &stats, ChanTally &tally)
+{
+   tally.clear();
+   for (auto &chan : stats)
+      tally.set(chan.first,chan.second);
+}
+
+static void endTally(const ChanTally &tally, chanList &counts, map<int,ChanStats> &stats)
+{
+   counts.clear();
+   stats.clear();
+   tally.forEach([&](int chan, const ChanStats &chanStats) {
+      counts.emplace_hint(counts.end(),chan,static_cast<int>(chanStats.spikes));
+      stats.emplace_hint(stats.end(),chan,chanStats);
+   });
+}
+
+// Writes the records we want to a .gdt file, with the start mark in front
+// of the first one, and keeps track of what went in.
+class GdtSink
+{
+   public:
+      GdtSink(BlockWriter &out, int chanLen, const GdtSlice &want, GdtMade &result)
+         : writer(out), chan_len(chanLen), slice(want), made(result) { startTally(made.stats,tally); }
+      void add(const char *line, int len, int chan, int time);
+      bool started() const { return made.records > 0; }
+      void finish()
+      {
+         endTally(tally,made.counts,made.stats);
+         made.endOffset = writer.pos();
+         endMark(writer,chan_len,made.lastTime);
+      }
+
+   private:
+      BlockWriter &writer;
+      int chan_len;
+      const GdtSlice &slice;
+      GdtMade &made;
+      ChanTally tally;
+};
+
+void GdtSink::add(const char *line, int len, int chan, int time)
+{
+   if (!len || !slice.wantChan(chan))     // like the old split(), ignore blank lines
+      return;
+   if (chan < 4096)
+      made.bins.add(chan,time);
+   if (!slice.inRange(time))
+      return;
+   if (!made.records++)
+      startMark(writer,chan_len,time);
+   writer.writeLine(line,len);
+   made.lastTime = time;
+   if (chan < 4096)
+      tally.add(chan,time);
+}
+
+template <class Fmt>
+static bool copyRecords(SpikeReader &reader, GdtSink &sink, const SpikeInput &input, const IoProgress &progress,
+                        QString &err)
+{
+   const char *begin, *end;
+
+   while (reader.nextBlock(begin,end))
+   {
+      forEachRecord<Fmt>(begin,end,end+DECODE_PAD,[&sink](const char *line, int len, int chan, int time) {
+         sink.add(line,len,chan,time);
+         return true;
+      });
+      if (!keepGoing(progress,input.pos(),input.size(),err))
+         return false;
+   }
+   return true;
+}
+
+// Open a file to write, or if we are adding to it, cut it back to where
+// the new part goes.
+static bool openOutput(QFile &file, qint64 keep, QString &err)
+{
+   bool opened = keep > 0 ? file.open(QIODevice::ReadWrite) && file.resize(keep) && file.seek(keep)
+                          : file.open(QIODevice::WriteOnly);
+   if (!opened)
+      err = openErr(file.fileName(),file);
+   return opened;
+}
+
+static bool seekInput(SpikeInput &input, const GdtResume &resume, QString &err)
+{
+   if (resume.active() && !input.device()->seek(resume.srcOffset))
+   {
+      err = openErr(input.fileName(),input.errorString());
+      return false;
+   }
+   return true;
+}
+
+// Copy an .adt or .bdt file, or the part of it in the slice, to a .gdt
+// file, adding the start mark before the first record and the end mark
+// after the last one. The source can be compressed. When resuming, only
+// the source after the resume point is read, and the records go in place
+// of the old end mark.
+bool makeGdtFile(const QString &src, const QString &dst, FTYPE ftype, const GdtSlice &slice, GdtMade &made,
+                 QString &err, const IoProgress &progress, const GdtResume &resume)
+{
+   int chan_len = ftype == FTYPE::ADT ? 2 : 5;   // adt is I2 I8, bdt is I5 I8
+   const char *line;
+   int len;
+
+   auto nextRec = [&](SpikeReader &reader) {
+      while (reader.nextLine(line,len))
+         if (len)
+            return true;
+      return false;
+   };
+
+   if (!resume.active())
+      made = GdtMade();
+   SpikeInput input(src);
+   if (!input.open(err) || !seekInput(input,resume,err))
+      return false;
+   QFile outfile(dst);
+   if (!openOutput(outfile,resume.gdtOffset,err))
+      return false;
+   SpikeReader reader(input.device());
+   BlockWriter writer(&outfile);
+
+   if (ftype == FTYPE::BDT && !resume.active())
+   {
+      bool hdr1 = nextRec(reader) && QByteArray::fromRawData(line,len) == BDT_HEADER;
+      bool hdr2 = nextRec(reader) && QByteArray::fromRawData(line,len) == BDT_HEADER;
+      if (!hdr1 && !hdr2)
+      {
+         QTextStream(&err) << QObject::tr("This not a valid .bdt file ") << src << endl;
+         outfile.remove();
+         return false;
+      }
+      writer.writeLine(BDT_HEADER,sizeof(BDT_HEADER)-1);
+      writer.writeLine(BDT_HEADER,sizeof(BDT_HEADER)-1);
+   }
+
+   GdtSink sink(writer,chan_len,slice,made);
+   bool copied;
+   if (ftype == FTYPE::ADT)
+      copied = copyRecords<AdtFormat>(reader,sink,input,progress,err);
+   else
+      copied = copyRecords<BdtFormat>(reader,sink,input,progress,err);
+   if (copied && !sink.started())
+   {
+      QTextStream(&err) << QObject::tr("There are no spikes in ") << src << (slice.whole() ? "" : QObject::tr(" in the time range and channels you picked")) << endl;
+      copied = false;
+   }
+   if (!copied)
+   {
+      writer.flush();
+      outfile.remove();
+      return false;
+   }
+   sink.finish();
+
+   if (reader.error() || !writer.flush())
+   {
+      QTextStream(&err) << QObject::tr("Error creating ") << dst << endl << QObject::tr("Error is:               ") << (reader.error() ? input.errorString() : outfile.errorString()) << endl;
+      return false;
+   }
+   return true;
+}
+
+
+bool GdtScanner::addLine(const char *line, int len)
+{
+   int chan;
+
+   if (len == 0)          // blank lines don't count
+      return state != DONE;
+
+   switch (state)
+   {
+      case HEADER1:
+         if (QByteArray::fromRawData(line,len) == BDT_HEADER)
+         {
+            state = HEADER2;
+            return true;
+         }
+         state = FIND_START;
+         break;
+      case HEADER2:
+         if (QByteArray::fromRawData(line,len) == BDT_HEADER)
+         {
+            chan_len = 5;
+            state = FIND_START;
+            return true;
+         }
+         state = FIND_START;  // 1st line can't be a start mark as a .adt
+         break;
+      case DONE:
+         return false;
+      default:
+         break;
+   }
+
+   chan = recChan(line,len,chan_len); // 1st number in string is chan
+   switch (state)
+   {
+      case FIND_START:
+         if (chan == GDT_START)
+         {
+            info.startMark = true;
+            info.startOffset = offsetOf(line);
+            state = FIRST_REC;
+         }
+         return true;
+      case FIRST_REC:
+         info.startTime = recTime(line,len,chan_len);
+         state = RECORDS;
+         break;
+      default:
+         break;
+   }
+
+   return addRecord(line,len,chan,recTime(line,len,chan_len));
+}
+
+bool GdtScanner::addRecord(const char *line, int len, int chan, int time)
+{
+   if (len == 0)
+      return true;
+   if (chan == GDT_END)
+   {
+      info.endMark = true;
+      info.endOffset = offsetOf(line);
+      state = DONE;
+      return false;
+   }
+   info.endTime = time;
+   ++records;
+   if (chan < 4096)    // neuron channels
+      tally.add(chan,time);
+   else if (chan / 4096 < 32)
+      analogBits |= 1u << (chan / 4096);
+   else
+      info.analogs.insert(chan / 4096);
+   return true;
+}
+
+// A scanner for records further on in the same file.
+GdtScanner GdtScanner::tail() const
+{
+   GdtScanner part;
+
+   part.state = state;
+   part.chan_len = chan_len;
+   return part;
+}
+
+// A scanner for the records added to a file after the end mark it had
+// when it was scanned before. It picks up with what was found then, and
+// is handed the file from the old end mark on.
+GdtScanner GdtScanner::resume(const GdtInfo &before, int chanLen)
+{
+   GdtScanner scanner;
+
+   scanner.info = before;
+   scanner.info.endMark = false;
+   scanner.info.endOffset = -1;
+   scanner.info.headHash = 0;
+   startTally(before.stats,scanner.tally);
+   scanner.state = RECORDS;
+   scanner.chan_len = chanLen;
+   return scanner;
+}
+
+// Add what a tail() found, unless we already hit the end mark.
+void GdtScanner::merge(const GdtScanner &later)
+{
+   if (done())
+      return;
+   tally.merge(later.tally);
+   analogBits |= later.analogBits;
+   info.analogs.insert(later.info.analogs.begin(),later.info.analogs.end());
+   if (later.records)
+      info.endTime = later.info.endTime;
+   records += later.records;
+   if (later.done())
+   {
+      info.endMark = true;
+      info.endOffset = later.info.endOffset;
+      state = DONE;
+   }
+}
+
+void GdtScanner::finish(GdtInfo &result) const
+{
+   result = info;
+   endTally(tally,result.chans,result.stats);
+   for (int analog = 0; analog < 32; ++analog)
+      if (analogBits & (1u << analog))
+         result.analogs.insert(analog);
+}
+
+// Find the header and start mark a line at a time, then hand the records
+// to the decoder for the format. Returns where we stopped. The offset is
+// where begin is in the file.
+const char *GdtScanner::addBlock(const char *begin, const char *end, const char *limit, qint64 offset)
+{
+   const char *line = begin;
+
+   blockBegin = begin;
+   blockOffset = offset;
+   while (line < end && state < RECORDS)
+   {
+      const char *nl = static_cast<const char *>(memchr(line,'\n',end-line));
+      if (!nl)
+         nl = end;
+      bool more = addLine(line,nl-line);
+      line = nl < end ? nl + 1 : end;
+      if (!more)
+         return line;
+   }
+   if (line >= end || state == DONE)
+      return line;
+
+   auto rec = [this](const char *line, int len, int chan, int time) { return addRecord(line,len,chan,time); };
+   if (chan_len == 5)
+      return forEachRecord<BdtFormat>(line,end,limit,rec);
+   return forEachRecord<AdtFormat>(line,end,limit,rec);
+}
+
+// One part of a mapped .gdt file, for a GdtScanner tail.
+struct ScanSlice
+{
+   const char *begin;
+   const char *end;
+   qint64 offset;
+};
+
+// It runs at the priority of the thread that asked for the scan, if that
+// was set, so a background scan stays in the background.
+struct SliceScanner
+{
+   const GdtScanner &head;
+   const char *limit;
+   QThread::Priority priority;
+
+   GdtScanner operator()(const ScanSlice &slice) const
+   {
+      if (priority != QThread::InheritPriority && QThread::currentThread()->priority() != priority)
+         QThread::currentThread()->setPriority(priority);
+      GdtScanner part = head.tail();
+      part.addBlock(slice.begin,slice.end,limit,slice.offset);
+      return part;
+   }
+};
+
+// Hand a .gdt file to a scanner from byte offset from on. The file is
+// mapped and the lines are picked out of the mapped bytes where they are,
+// so there is no copy of the file in memory at all. Up to the records this
+// goes a block at a time, then batches of slices of the records are
+// scanned on the thread pool, each with its own counts, and merged in
+// order. If the file can't be mapped, read it a block at a time instead.
+// If there is a hash, the whole file goes through it, in the same pass.
+// The slices go on pool, or the global pool if there isn't one.
+static bool scanFrom(QFile &file, qint64 from, GdtScanner &scanner, QString &err, const IoProgress &progress,
+                     ScanHash *hash, QThreadPool *pool)
+{
+   qint64 size = file.size();
+   bool going = true;
+
+   if (hash && !hash->addFile(file,from,-1,err,progress))
+      return false;
+   const char *data = size ? reinterpret_cast<const char *>(file.map(0,size)) : nullptr;
+   auto hashTo = [&](qint64 to) {
+      if (hash)
+         hash->add(data,0,to,scanner.endOffset());
+   };
+   if (data)
+   {
+      const char *end = data + size;
+      const char *pos = data + qMin(from,size);
+      auto sliceEnd = [end](const char *at, qint64 len) {   // on a line
+         if (end - at <= len)
+            return end;
+         const char *nl = static_cast<const char *>(memchr(at+len,'\n',end-at-len));
+         return nl ? nl + 1 : end;
+      };
+      while (going && pos < end && !scanner.done() && !scanner.inRecords())
+      {
+         pos = scanner.addBlock(pos,sliceEnd(pos,IO_BLOCK),end,pos-data);
+         hashTo(pos-data);
+         going = keepGoing(progress,pos-data,size,err);
+      }
+      QThreadPool *slices = pool ? pool : QThreadPool::globalInstance();
+      SliceScanner scan{scanner,end,pool ? QThread::currentThread()->priority() : QThread::InheritPriority};
+      int threads = slices->maxThreadCount();
+      while (going && pos < end && !scanner.done())
+      {
+         QList<QFuture<GdtScanner>> parts;
+         while (parts.size() < threads && pos < end)
+         {
+            const char *stop = sliceEnd(pos,4 * IO_BLOCK);
+            ScanSlice slice{pos,stop,pos-data};
+            parts.append(QtConcurrent::run(slices,[&scan,slice]() { return scan(slice); }));
+            pos = stop;
+         }
+         for (QFuture<GdtScanner> &part : parts)
+            scanner.merge(part.result());
+         hashTo(pos-data);
+         going = keepGoing(progress,pos-data,size,err);
+      }
+      if (going)
+         hashTo(size);
+      file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(data)));
+   }
+   else
+   {
+      if (from && !file.seek(from))
+      {
+         err = openErr(file.fileName(),file);
+         return false;
+      }
+      SpikeReader reader(&file);
+      const char *begin, *end;
+      while (going && !scanner.done() && reader.nextBlock(begin,end))
+      {
+         qint64 offset = from+reader.offset()-(end-begin);
+         scanner.addBlock(begin,end,end+DECODE_PAD,offset);
+         if (hash)
+            hash->add(begin,offset,end-begin,scanner.endOffset());
+         going = keepGoing(progress,from+reader.bytesRead(),size,err);
+      }
+      if (going && hash)
+         going = hash->addFile(file,size,scanner.endOffset(),err,progress);
+   }
+   return going;
+}
+
+// Find the channels and times in a .gdt file, and hash it if asked to.
+bool scanGdtFile(const QString &fName, GdtInfo &info, QString &err, const IoProgress &progress, ScanHash *hash,
+                 QThreadPool *pool)
+{
+   GdtScanner scanner;
+   QFile file(fName);
+
+   if (!file.open(QIODevice::ReadOnly))
+   {
+      err = openErr(fName,file);
+      return false;
+   }
+   if (!scanFrom(file,0,scanner,err,progress,hash,pool))
+      return false;
+   scanner.finish(info);
+   if (!info.startMark)
+   {
+      QTextStream(&err) << QObject::tr("This not a valid .gdt file ") << fName << endl;
+      return false;
+   }
+   return true;
+}
+
+// The channel width of an open .gdt file, 5 if it has a .bdt header, 2 if
+// not. Leaves the file at the start.
+static int gdtChanLen(QFile &file)
+{
+   QByteArray head = file.read(sizeof(BDT_HEADER) - 1);
+
+   file.seek(0);
+   return head == BDT_HEADER ? 5 : 2;
+}
+
+// When records have been added to a .gdt file since it was scanned, only
+// read the new ones, from the old end mark on, and add them to what we had
+// before. Only the header is read from the start of the file, to get the
+// format. This does not check that the rest of the start is the same as
+// it was, see reloadGdtInfo. False if the old scan had no end mark. A hash
+// picks up from wherever it got to, which is the start if it is new.
+bool scanGdtTail(const QString &fName, const GdtInfo &before, GdtInfo &info, QString &err, const IoProgress &progress,
+                 ScanHash *hash)
+{
+   QFile file(fName);
+
+   if (!before.endMark || before.endOffset < 0)
+   {
+      QTextStream(&err) << QObject::tr("There is no end mark to read on from in ") << fName << endl;
+      return false;
+   }
+   if (!file.open(QIODevice::ReadOnly))
+   {
+      err = openErr(fName,file);
+      return false;
+   }
+   GdtScanner scanner = GdtScanner::resume(before,gdtChanLen(file));
+   if (!scanFrom(file,before.endOffset,scanner,err,progress,hash,nullptr))
+      return false;
+   scanner.finish(info);
+   return true;
+}
+
+// Hand each record between the start and end marks of a .gdt file, which
+// info says where to find, to rec, in file order. One pass on one thread.
+template <typename Rec>
+static bool forMarkedRecords(const QString &fName, const GdtInfo &info, QString &err, const IoProgress &progress,
+                             Rec rec)
+{
+   QFile file(fName);
+   bool going = true;
+
+   if (!file.open(QIODevice::ReadOnly))
+   {
+      err = openErr(fName,file);
+      return false;
+   }
+   if (!info.startMark || info.startOffset < 0)
+   {
+      QTextStream(&err) << QObject::tr("This not a valid .gdt file ") << fName << endl;
+      return false;
+   }
+
+   int chan_len = gdtChanLen(file);
+   qint64 size = file.size();
+   qint64 stop = info.endMark ? qMin(info.endOffset,size) : size;
+   if (info.startOffset >= stop)      // info is for an older version of the file
+   {
+      QTextStream(&err) << fName << QObject::tr(" has changed since it was loaded, load it again.") << endl;
+      return false;
+   }
+   auto marked = [&rec](const char *, int len, int chan, int time) {
+      if (len == 0)
+         return true;
+      if (chan == GDT_END)
+         return false;
+      rec(chan,time);
+      return true;
+   };
+   auto addBlock = [&](const char *begin, const char *end, const char *limit) {
+      if (chan_len == 5)
+         forEachRecord<BdtFormat>(begin,end,limit,marked);
+      else
+         forEachRecord<AdtFormat>(begin,end,limit,marked);
+   };
+   const char *data = size ? reinterpret_cast<const char *>(file.map(0,size)) : nullptr;
+   if (data)
+   {
+      const char *end = data + stop;
+      const char *pos = static_cast<const char *>(memchr(data+info.startOffset,'\n',end-data-info.startOffset));
+      pos = pos ? pos + 1 : end;      // past the start mark
+      while (going && pos < end)
+      {
+         const char *block_end = end;
+         if (end - pos > IO_BLOCK)
+         {
+            const char *nl = static_cast<const char *>(memchr(pos+IO_BLOCK,'\n',end-pos-IO_BLOCK));
+            block_end = nl ? nl + 1 : end;
+         }
+         addBlock(pos,block_end,data+size);
+         pos = block_end;
+         going = keepGoing(progress,pos-data,stop,err);
+      }
+      file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(data)));
+   }
+   else
+   {
+      const char *line;
+      int len;
+      if (!file.seek(info.startOffset))
+      {
+         err = openErr(fName,file);
+         return false;
+      }
+      SpikeReader reader(&file);
+      reader.nextLine(line,len);     // the start mark
+      const char *begin, *end;
+      while (going && reader.offset() + info.startOffset < stop && reader.nextBlock(begin,end))
+      {
+         addBlock(begin,end,end+DECODE_PAD);
+         going = keepGoing(progress,info.startOffset+reader.bytesRead(),stop,err);
+      }
+   }
+   return going;
+}
+
+// The spike counts for a raster of the records between the start and end
+// marks. The pyramid is too big to keep a copy for each thread.
+bool rasterGdtFile(const QString &fName, const GdtInfo &info, RasterPyramid &raster, QString &err,
+                   const IoProgress &progress)
+{
+   vector<int> chans;
+
+   for (auto &chan : info.chans)
+      chans.push_back(chan.first);
+   raster.reset(chans,info.startTime,info.endTime);
+   if (!forMarkedRecords(fName,info,err,progress,[&raster](int chan, int time) {
+          if (chan < ANALOG_ID)
+             raster.add(chan,time);
+       }))
+      return false;
+   raster.finish();
+   return true;
+}
+
+// The analog records between the start and end marks.
+bool analogGdtFile(const QString &fName, const GdtInfo &info, AnalogCollector &analog, QString &err,
+                   const IoProgress &progress)
+{
+   return forMarkedRecords(fName,info,err,progress,[&analog](int chan, int time) {
+      if (chan >= ANALOG_ID)
+         analog.add(chan,time);
+   });
+}
+
+// A chunk of .edt records converted to .bdt records, and what was in it.
+struct BdtChunk
+{
+   QByteArray text;     // all of the records, for the .bdt file
+   QByteArray sliced;   // the ones in the slice, if that isn't all of them
+   ChanTally tally;     // the rest of these are for the records in the slice
+   SpikeBins bins;
+   int firstTime = 0;
+   int lastTime = 0;
+   int records = 0;
+};
+
+// One chunk of .edt records to .bdt records. Blank lines become 0 0, same
+// as they always have.
+struct EdtChunkConverter
+{
+   typedef BdtChunk result_type;     // for QtConcurrent::mapped
+
+   const GdtSlice &slice;
+
+   BdtChunk operator()(const QByteArray &chunk) const
+   {
+      const int chan_len = 5;
+      const int bdt_t_wid = 8;
+      const char *begin = chunk.constData();
+      const char *end = begin + chunk.size() - DECODE_PAD;
+      bool whole = slice.whole();
+      BdtChunk bdt;
+      int used = 0;
+
+        // .bdt records are shorter than .edt records, but blank lines grow
+      bdt.text.resize(chunk.size() + MAX_RECORD_TEXT);
+      forEachRecord<EdtFormat>(begin,end,end+DECODE_PAD,[&](const char *, int, int chan, int time) {
+         if (used + MAX_RECORD_TEXT > bdt.text.size())
+            bdt.text.resize(bdt.text.size() * 2);
+         char *text = bdt.text.data();
+         char *rec = text + used;
+         time /= 5;  // .1 ms to .5 ms res
+         used = formatRecord(rec,chan,chan_len,time,bdt_t_wid) - text;
+         if (!slice.wantChan(chan))
+            return true;
+         if (chan < 4096)
+            bdt.bins.add(chan,time);
+         if (!slice.inRange(time))
+            return true;
+         if (!whole)
+            bdt.sliced.append(rec,text+used-rec);
+         if (!bdt.records++)
+            bdt.firstTime = time;
+         bdt.lastTime = time;
+         if (chan < 4096)
+            bdt.tally.add(chan,time);
+         return true;
+      });
+      bdt.text.resize(used);
+      return bdt;
+   }
+};
+
+// Read an .edt file once and write a .gdt file, a .bdt file, or both.
+// This is from edt2bdt.f, plus what makeGdtFile does to a .bdt file.
+// The file is read in chunks of whole lines, a batch of chunks is converted
+// on the thread pool while the next batch is read, and the results are
+// written out in order, so the output is the same as doing it a line at a
+// time. The .gdt is written here, the .bdt on another thread while we go on
+// to the next batch. Only the records in the slice go in the .gdt file.
+static bool convertEdt(const QString &edt, const QString &gdt, const QString &bdt, const GdtSlice &slice,
+                       GdtMade &made, QString &err, const IoProgress &progress, const GdtResume &resume)
+{
+   const int chan_len = 5;
+   SpikeInput e_file(edt);
+   QFile g_file(gdt);
+   QFile b_file(bdt);
+   unique_ptr<BlockWriter> g_writer;
+   unique_ptr<BlockWriter> b_writer;
+   QFuture<void> bdtWrite;
+   const char *line;
+   int len;
+
+   // on the way out after a failure, a part made file is worse than none
+   auto discard = [&]() {
+      bdtWrite.waitForFinished();
+      g_writer.reset();
+      b_writer.reset();
+      if (g_file.isOpen())
+         g_file.remove();
+      if (b_file.isOpen())
+         b_file.remove();
+      return false;
+   };
+
+   if (!resume.active())
+      made = GdtMade();
+   ChanTally tally;
+   startTally(made.stats,tally);
+   if (!e_file.open(err) || !seekInput(e_file,resume,err))
+      return false;
+   if (gdt.length())
+   {
+      if (!openOutput(g_file,resume.gdtOffset,err))
+         return false;
+      g_writer = make_unique<BlockWriter>(&g_file);
+      if (!resume.active())
+      {
+         g_writer->writeLine(BDT_HEADER,sizeof(BDT_HEADER)-1);
+         g_writer->writeLine(BDT_HEADER,sizeof(BDT_HEADER)-1);
+      }
+   }
+   if (bdt.length())
+   {
+      if (!openOutput(b_file,resume.bdtOffset,err))
+         return discard();
+      b_writer = make_unique<BlockWriter>(&b_file);
+      if (!resume.active())
+      {
+         b_writer->writeLine(BDT_HEADER,sizeof(BDT_HEADER)-1);
+         b_writer->writeLine(BDT_HEADER,sizeof(BDT_HEADER)-1);
+      }
+   }
+
+   SpikeReader reader(e_file.device());
+   if (!resume.active())
+   {
+      reader.nextLine(line,len); // skip header
+      reader.nextLine(line,len);
+   }
+
+   int batchSize = QThreadPool::globalInstance()->maxThreadCount() * 2;
+   auto readBatch = [&reader,batchSize]() {
+      QList<QByteArray> batch;
+      QByteArray chunk;
+      while (batch.size() < batchSize && reader.nextChunk(chunk))
+         batch.append(chunk);
+      return batch;
+   };
+
+   QList<QByteArray> batch = readBatch();
+   while (!batch.isEmpty())
+   {
+      QFuture<BdtChunk> converted = QtConcurrent::mapped(batch,EdtChunkConverter{slice});
+      QList<QByteArray> next = readBatch();
+      QList<BdtChunk> results = converted.results();
+      if (b_writer)
+      {
+         BlockWriter *writer = b_writer.get();
+         bdtWrite.waitForFinished();    // keep the .bdt in order
+         bdtWrite = QtConcurrent::run([writer,results]() {
+            for (const BdtChunk &chunk : results)
+               writer->write(chunk.text.constData(),chunk.text.size());
+         });
+      }
+      for (const BdtChunk &chunk : results)
+      {
+         made.bins.merge(chunk.bins);
+         if (!chunk.records)
+            continue;
+         if (!made.records && g_writer)
+            startMark(*g_writer,chan_len,chunk.firstTime);
+         made.records += chunk.records;
+         const QByteArray &text = slice.whole() ? chunk.text : chunk.sliced;
+         if (g_writer)
+            g_writer->write(text.constData(),text.size());
+         made.lastTime = chunk.lastTime;
+         tally.merge(chunk.tally);      // chunks are in time order
+      }
+      batch = next;
+      if (!keepGoing(progress,e_file.pos(),e_file.size(),err))
+         return discard();
+   }
+   bdtWrite.waitForFinished();
+   endTally(tally,made.counts,made.stats);
+
+   if (g_writer)
+   {
+      if (!made.records)
+      {
+         QTextStream(&err) << QObject::tr("There are no spikes in ") << edt << (slice.whole() ? "" : QObject::tr(" in the time range and channels you picked")) << endl;
+         return discard();
+      }
+      made.endOffset = g_writer->pos();
+      endMark(*g_writer,chan_len,made.lastTime);
+   }
+
+   bool g_ok = !g_writer || g_writer->flush();
+   bool b_ok = !b_writer || b_writer->flush();
+   if (reader.error() || !g_ok || !b_ok)
+   {
+      if (reader.error())
+         QTextStream(&err) << QObject::tr("Error reading ") << edt << endl << QObject::tr("Error is: ") << e_file.errorString() << endl;
+      else if (!g_ok)
+         QTextStream(&err) << QObject::tr("Error creating ") << gdt << endl << QObject::tr("Error is: ") << g_file.errorString() << endl;
+      else
+         QTextStream(&err) << QObject::tr("Error creating ") << bdt << endl << QObject::tr("Error is: ") << b_file.errorString() << endl;
+      return discard();
+   }
+   return true;
+}
+
+// Create a .gdt from an .edt without going through a .bdt file first.
+// If bdt is not empty, that .bdt file is written as well.
+bool makeGdtFromEdt(const QString &edt, const QString &gdt, const QString &bdt, const GdtSlice &slice,
+                    GdtMade &made, QString &err, const IoProgress &progress, const GdtResume &resume)
+{
+   return convertEdt(edt,gdt,bdt,slice,made,err,progress,resume);
+}
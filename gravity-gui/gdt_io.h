@@ -0,0 +1,258 @@
+#ifndef GDT_IO_H
+#define GDT_IO_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Streaming readers and writers for the .adt, .bdt, .edt, and .gdt spike
+// files. None of these touch the gui, so they can be used from anywhere.
+
+#include <QIODevice>
+#include <QFile>
+#include <QThreadPool>
+#include <QByteArray>
+#include <QString>
+#include <QDataStream>
+#include <functional>
+#include <bitset>
+#include <vector>
+#include <limits.h>
+#include "gravity_gui.h"
+#include "spike_decode.h"
+#include "spike_format.h"
+#include "chan_stats.h"
+#include "raster_pyramid.h"
+#include "analog_trace.h"
+#include "content_hash.h"
+
+const int IO_BLOCK = 1 << 20;     // bytes per read or write
+const char BDT_HEADER[] = "   11 1111111";
+const int SLICE_BIN = 2000;       // ticks per bin when looking for a time range
+
+// Called every so often with the bytes done so far and the total. Return
+// false to stop. This may be called from a worker thread.
+using IoProgress = std::function<bool(qint64,qint64)>;
+
+// Reads a file a block at a time and hands it back a line at a time, or
+// as a run of whole lines. The line is not null terminated, does not
+// include the \n, and is only valid until the next call. Blocks always
+// have DECODE_PAD readable bytes after the end for the record decoder.
+class SpikeReader
+{
+   public:
+      explicit SpikeReader(QIODevice *dev, int blockSize = IO_BLOCK);
+      bool nextLine(const char *&line, int &len);
+      bool nextBlock(const char *&begin, const char *&end);
+      bool nextChunk(QByteArray &chunk);
+      bool error() const { return readErr; }
+      qint64 bytesRead() const { return total; }
+      qint64 offset() const { return total - (fill - pos); }  // of next unread byte
+
+   private:
+      bool refill();
+
+      QIODevice *device;
+      QByteArray buffer;
+      int capacity;        // buffer size less the pad
+      int pos = 0;         // start of unconsumed data in buffer
+      int fill = 0;        // end of valid data in buffer
+      qint64 total = 0;    // bytes read from the device so far
+      bool atEof = false;
+      bool readErr = false;
+};
+
+// Collects output in a fixed size buffer and writes it out in big blocks.
+// Records are formatted right into the buffer.
+class BlockWriter
+{
+   public:
+      explicit BlockWriter(QIODevice *dev, int blockSize = IO_BLOCK);
+      ~BlockWriter() { flush(); }
+      void write(const char *data, int len);
+      void writeLine(const char *data, int len) { write(data,len); write("\n",1); }
+      void writeRecord(int chan, int chanW, int time, int timeW)
+      {
+         if (fill + MAX_RECORD_TEXT > buffer.size())
+            flush();
+         char *start = buffer.data();
+         fill = formatRecord(start+fill,chan,chanW,time,timeW) - start;
+      }
+      bool flush();
+      bool error() const { return writeErr; }
+      qint64 pos() const { return device->pos() + fill; }  // in the file
+
+   private:
+      QIODevice *device;
+      QByteArray buffer;
+      int fill = 0;
+      bool writeErr = false;
+};
+
+// What we know about a .gdt file after reading it.
+struct GdtInfo
+{
+   chanList chans;         // neuron chan, # spikes
+   std::map<int,ChanStats> stats;   // for the same chans
+   analogSet analogs;
+   long startTime = 0;     // first record after the start mark
+   long endTime = 0;       // last record before the end mark
+   qint64 startOffset = -1;   // byte offset of the start mark line
+   qint64 endOffset = -1;     // and of the end mark line
+   quint64 headHash = 0;      // of the bytes before the end mark line
+   bool startMark = false;
+   bool endMark = false;
+};
+
+// Picks the channels and times out of a .gdt file a line at a time, so
+// it does not care where the lines come from. Once it is past the start
+// mark, the rest of the file can be cut up and each part handed to a
+// tail() of this one on its own thread, then merged back in file order.
+class GdtScanner
+{
+   public:
+      const char *addBlock(const char *begin, const char *end, const char *limit, qint64 offset);
+      bool done() const { return state == DONE; }
+      bool inRecords() const { return state == RECORDS; }
+      qint64 endOffset() const { return info.endMark ? info.endOffset : -1; }
+      GdtScanner tail() const;
+      static GdtScanner resume(const GdtInfo &before, int chanLen);
+      void merge(const GdtScanner &later);
+      void finish(GdtInfo &result) const;
+
+   private:
+      bool addLine(const char *line, int len);  // false when done
+      bool addRecord(const char *line, int len, int chan, int time);
+      qint64 offsetOf(const char *line) const { return blockOffset + (line - blockBegin); }
+
+      enum State {HEADER1, HEADER2, FIND_START, FIRST_REC, RECORDS, DONE};
+      GdtInfo info;        // all but the neuron channels
+      ChanTally tally;
+      quint32 analogBits = 0;   // analog chans under 32, any others are in info
+      long records = 0;
+      State state = HEADER1;
+      int chan_len = 2;    // if no header, assume a .adt file
+      const char *blockBegin = nullptr;
+      qint64 blockOffset = 0;   // file offset of blockBegin
+};
+
+// The part of a file to put in a .gdt file. Times are in the ticks of
+// the .gdt file and both ends are included. The channel list only applies
+// to the neuron channels, analog records in the time range are kept.
+struct GdtSlice
+{
+   int fromTime = 0;
+   int toTime = INT_MAX;
+   bool allChans = true;
+   std::bitset<4096> chans;
+
+   bool wantChan(int chan) const { return allChans || chan >= 4096 || chan < 0 || chans[chan]; }
+   bool inRange(int time) const { return time >= fromTime && time <= toTime; }
+   bool whole() const { return allChans && fromTime <= 0 && toTime == INT_MAX; }
+};
+
+// Hashes a file's bytes in order as they are scanned, for the .gdt index,
+// so the file only has to be read once. The digest of the bytes before the
+// end mark is taken on the way, see GdtInfo::headHash.
+class ScanHash
+{
+   public:
+      void add(const char *bytes, qint64 offset, qint64 len, qint64 mark = -1);
+      bool addFile(QFile &file, qint64 to, qint64 mark, QString &err, const IoProgress &progress = IoProgress());
+      qint64 hashed() const { return done; }
+      quint64 digest() const { return hash.digest(); }
+      quint64 head() const { return headDigest; }
+
+   private:
+      ContentHash hash;
+      qint64 done = 0;           // bytes hashed so far
+      quint64 headDigest = 0;    // of the bytes before mark
+};
+
+bool parseGdtSlice(const QString &range, const QString &chanText, GdtSlice &slice, QString &err);
+
+// Spike counts per neuron channel in SLICE_BIN wide time bins, used to
+// find the longest time range that keeps each channel under a limit.
+class SpikeBins
+{
+   friend QDataStream &operator<<(QDataStream &out, const SpikeBins &bins);
+   friend QDataStream &operator>>(QDataStream &in, SpikeBins &bins);
+
+   public:
+      void add(int chan, int time);
+      void merge(const SpikeBins &other);
+      bool widestRange(int maxSpikes, int &from, int &to) const;
+
+   private:
+      struct ChanBins
+      {
+         int first = 0;          // bin number of counts[0]
+         std::vector<int> counts;
+      };
+      ChanBins &binsFor(int chan)
+      {
+         size_t at = slots.slot(chan);
+         if (at == chans.size())
+            chans.emplace_back();
+         return chans[at];
+      }
+
+      ChanSlots slots;
+      std::vector<ChanBins> chans;    // by slot
+};
+
+QDataStream &operator<<(QDataStream &out, const ChanStats &stats);
+QDataStream &operator>>(QDataStream &in, ChanStats &stats);
+
+// What went into a new .gdt file.
+struct GdtMade
+{
+   chanList counts;     // neuron chan, # spikes written
+   std::map<int,ChanStats> stats;   // of the spikes written
+   SpikeBins bins;      // the chans we wanted, over the whole source file
+   long records = 0;    // written, not counting the marks
+   int lastTime = 0;    // of the last record written
+   qint64 endOffset = 0;   // of the end mark in the .gdt file
+};
+
+// To add records to the end of a .gdt file made earlier, instead of making
+// it again. The GdtMade passed in with this has to be what the earlier
+// conversion returned, it is added to.
+struct GdtResume
+{
+   qint64 srcOffset = 0;   // read the source from here, past the header
+   qint64 gdtOffset = 0;   // end mark of the .gdt file, cut off and moved
+   qint64 bdtOffset = 0;   // end of the side .bdt file
+   bool active() const { return srcOffset > 0; }
+};
+
+bool makeGdtFile(const QString &src, const QString &dst, FTYPE ftype, const GdtSlice &slice, GdtMade &made,
+                 QString &err, const IoProgress &progress = IoProgress(), const GdtResume &resume = GdtResume());
+bool scanGdtFile(const QString &fName, GdtInfo &info, QString &err, const IoProgress &progress = IoProgress(),
+                 ScanHash *hash = nullptr, QThreadPool *pool = nullptr);
+bool scanGdtTail(const QString &fName, const GdtInfo &before, GdtInfo &info, QString &err,
+                 const IoProgress &progress = IoProgress(), ScanHash *hash = nullptr);
+bool rasterGdtFile(const QString &fName, const GdtInfo &info, RasterPyramid &raster, QString &err,
+                   const IoProgress &progress = IoProgress());
+bool analogGdtFile(const QString &fName, const GdtInfo &info, AnalogCollector &analog, QString &err,
+                   const IoProgress &progress = IoProgress());
+bool makeGdtFromEdt(const QString &edt, const QString &gdt, const QString &bdt, const GdtSlice &slice,
+                    GdtMade &made, QString &err, const IoProgress &progress = IoProgress(),
+                    const GdtResume &resume = GdtResume());
+
+#endif
@@ -0,0 +1,129 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <QtConcurrent>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QThread>
+#include <algorithm>
+#include "gdt_prefetch.h"
+#include "gdt_cache.h"
+#include "gdt_index.h"
+#include "gravity_params.h"
+
+using namespace std;
+
+GdtPrefetcher::GdtPrefetcher(GdtCache &gdtCache, QObject *parent)
+   : QObject(parent), cache(gdtCache)
+{
+   pool.setMaxThreadCount(1);
+}
+
+GdtPrefetcher::~GdtPrefetcher()
+{
+   pause(false);
+   stop();
+   job.waitForFinished();
+   slicePool.waitForDone();
+}
+
+void GdtPrefetcher::start(const QString &dir)
+{
+   QMutexLocker locked(&lock);
+   int gen = ++generation;
+   job = QtConcurrent::run(&pool,[this,dir,gen]() { run(dir,gen); });
+}
+
+void GdtPrefetcher::stop()
+{
+   QMutexLocker locked(&lock);
+   ++generation;
+   resumed.wakeAll();
+}
+
+void GdtPrefetcher::pause(bool on)
+{
+   QMutexLocker locked(&lock);
+   paused = on;
+   if (!on)
+      resumed.wakeAll();
+}
+
+// Wait here while the user's own load runs.
+bool GdtPrefetcher::keepGoing(int gen) const
+{
+   QMutexLocker locked(&lock);
+   while (paused && gen == generation)
+      resumed.wait(&lock);
+   return gen == generation;
+}
+
+void GdtPrefetcher::run(const QString &dir, int gen)
+{
+   QThread::currentThread()->setPriority(QThread::IdlePriority);
+   QDir session(dir);
+   QStringList names;
+   int loaded = 0;
+
+   for (const QFileInfo &param : session.entryInfoList({"param*","*.prm"},QDir::Files))
+   {
+      GravityParams params;
+      QString err;
+      if (param.size() <= 1 << 20 && params.load(param.filePath(),err) && params.gdtFile.length())
+         names.append(session.absoluteFilePath(params.gdtFile));
+      if (!keepGoing(gen))
+         return;
+   }
+   for (const QFileInfo &gdt : session.entryInfoList({"*.gdt"},QDir::Files))
+      names.append(gdt.filePath());
+
+   QList<QFileInfo> files;
+   for (const QString &name : names)
+   {
+      QFileInfo file(name);
+      QString path = file.canonicalFilePath();      // "" if it isn't there
+      if (path.length() && none_of(files.begin(),files.end(),[&path](const QFileInfo &have) { return have.canonicalFilePath() == path; }))
+         files.append(QFileInfo(path));
+   }
+   sort(files.begin(),files.end(),[](const QFileInfo &a, const QFileInfo &b) { return a.lastModified() > b.lastModified(); });
+
+   IoProgress progress = [this,gen](qint64, qint64) { return keepGoing(gen); };
+   for (const QFileInfo &file : files)
+   {
+      GdtCache::Counts counts = cache.counts();
+      if (!keepGoing(gen) || counts.bytes >= counts.budget)
+         break;
+      QString path = file.filePath();
+      if (cache.contains(path))
+         continue;
+      GdtStamp stamp = gdtStamp(path);
+      GdtInfo info;
+      QString err;
+      if (loadGdtInfo(path,info,err,progress,false,&slicePool))
+      {
+         cache.insert(path,stamp,info);
+         ++loaded;
+      }
+   }
+   QMutexLocker locked(&lock);
+   if (gen == generation)
+      emit fetched(loaded);
+}
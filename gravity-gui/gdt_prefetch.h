@@ -0,0 +1,67 @@
+#ifndef GDT_PREFETCH_H
+#define GDT_PREFETCH_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Reads ahead when a session is opened. The .gdt files in the session
+// directory, and the ones its param files use, are loaded into the cache
+// on an idle priority thread, newest first, so the first load the user
+// asks for is already done. The scans put their slices on a pool of its
+// own, at the same idle priority. It stops while the GdtWorker is busy
+// with something the user asked for, and drops what it is doing when the
+// session changes.
+
+#include <QObject>
+#include <QThreadPool>
+#include <QFuture>
+#include <QMutex>
+#include <QWaitCondition>
+
+class GdtCache;
+
+class GdtPrefetcher : public QObject
+{
+   Q_OBJECT
+
+   public:
+      explicit GdtPrefetcher(GdtCache &gdtCache, QObject *parent = nullptr);
+      ~GdtPrefetcher();
+      void start(const QString &dir);
+      void stop();
+      void pause(bool on);
+
+   signals:
+      void fetched(int files);   // when it is done with a directory
+
+   private:
+      void run(const QString &dir, int gen);
+      bool keepGoing(int gen) const;
+
+      GdtCache &cache;
+      QThreadPool pool;
+      QThreadPool slicePool;      // for the scans
+      QFuture<void> job;
+      mutable QMutex lock;        // for the next three
+      mutable QWaitCondition resumed;
+      int generation = 0;
+      bool paused = false;
+};
+
+#endif
@@ -0,0 +1,241 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QTextStream>
+#include "gdt_update.h"
+#include "content_hash.h"
+#include "spike_input.h"
+
+using namespace std;
+
+static const quint32 SOURCE_MAGIC = 0x47445453;   // GDTS
+static const quint32 SOURCE_VERSION = 3;
+
+// What is in the name.gdt.src file.
+struct GdtSource
+{
+   QByteArray options;
+   qint64 srcSize = 0;
+   qint64 srcTime = 0;
+   quint64 srcHash = 0;
+   qint64 gdtSize = 0;
+   qint64 gdtTime = 0;
+   qint64 bdtSize = 0;
+   GdtMade made;
+};
+
+// The source hashed, and the part of it that was there last time.
+struct SourceHash
+{
+   qint64 size = 0;
+   quint64 whole = 0;
+   quint64 prefix = 0;
+   bool prefixLine = false;   // the part ends with a whole line
+};
+
+static QByteArray optionsKey(FTYPE ftype, const QString &bdt, const GdtSlice &slice)
+{
+   QByteArray key;
+   QDataStream str(&key,QIODevice::WriteOnly);
+
+   str << qint32(ftype) << bdt << qint32(slice.fromTime) << qint32(slice.toTime) << slice.allChans
+       << QByteArray(slice.chans.to_string().c_str());
+   return key;
+}
+
+static bool readGdtSource(const QString &fName, GdtSource &side)
+{
+   QFile file(fName);
+   quint32 magic, version, num_chans;
+
+   if (!file.open(QIODevice::ReadOnly))
+      return false;
+   QDataStream in(&file);
+   in >> magic >> version;
+   if (magic != SOURCE_MAGIC || version != SOURCE_VERSION)
+      return false;
+   in >> side.options >> side.srcSize >> side.srcTime >> side.srcHash >> side.gdtSize >> side.gdtTime >> side.bdtSize;
+   qint32 lastTime;
+   qint64 records;
+   in >> records >> lastTime >> side.made.endOffset >> num_chans;
+   side.made.records = records;
+   side.made.lastTime = lastTime;
+   for (quint32 idx = 0; idx < num_chans && in.status() == QDataStream::Ok; ++idx)
+   {
+      qint32 chan, count;
+      in >> chan >> count;
+      side.made.counts[chan] = count;
+      in >> side.made.stats[chan];
+   }
+   in >> side.made.bins;
+   return in.status() == QDataStream::Ok;
+}
+
+static bool writeGdtSource(const QString &fName, const GdtSource &side)
+{
+   QSaveFile file(fName);
+
+   if (!file.open(QIODevice::WriteOnly))
+      return false;
+   QDataStream out(&file);
+   out << SOURCE_MAGIC << SOURCE_VERSION;
+   out << side.options << side.srcSize << side.srcTime << side.srcHash << side.gdtSize << side.gdtTime << side.bdtSize;
+   out << qint64(side.made.records) << qint32(side.made.lastTime) << side.made.endOffset
+       << quint32(side.made.counts.size());
+   for (auto &chan : side.made.counts)
+   {
+      auto found = side.made.stats.find(chan.first);
+      out << qint32(chan.first) << qint32(chan.second)
+          << (found != side.made.stats.end() ? found->second : ChanStats());
+   }
+   out << side.made.bins;
+   return file.commit();
+}
+
+// The outputs have to be just as we left them.
+static bool outputsMatch(const GdtSource &side, const QString &gdt, const QString &bdt)
+{
+   QFileInfo g_info(gdt);
+   if (!g_info.exists() || g_info.size() != side.gdtSize
+       || g_info.lastModified().toMSecsSinceEpoch() != side.gdtTime)
+      return false;
+   return bdt.isEmpty() || QFileInfo(bdt).size() == side.bdtSize;
+}
+
+// Hash all of the source, and the first prefixLen bytes of it on the way.
+static bool hashSource(const QString &src, qint64 prefixLen, SourceHash &hash, QString &err,
+                       const IoProgress &progress)
+{
+   QFile file(src);
+   ContentHash all;
+
+   if (!file.open(QIODevice::ReadOnly))
+   {
+      QTextStream(&err) << QObject::tr("Error opening file ") << src << endl << QObject::tr("Error is:               ") << file.errorString() << endl;
+      return false;
+   }
+   hash.size = file.size();
+   const char *data = hash.size ? reinterpret_cast<const char *>(file.map(0,hash.size)) : nullptr;
+   QByteArray block;
+   qint64 pos = 0;
+   while (pos < hash.size)
+   {
+      qint64 len = qMin<qint64>(IO_BLOCK,hash.size-pos);
+      if (pos < prefixLen && pos + len > prefixLen)
+         len = prefixLen - pos;         // stop at the end of the old part
+      const char *bytes;
+      if (data)
+         bytes = data + pos;
+      else
+      {
+         block = file.read(len);
+         if (block.size() != len)
+         {
+            QTextStream(&err) << QObject::tr("Error reading ") << src << endl << QObject::tr("Error is:               ") << file.errorString() << endl;
+            return false;
+         }
+         bytes = block.constData();
+      }
+      all.update(bytes,len);
+      pos += len;
+      if (pos == prefixLen)
+      {
+         hash.prefix = all.digest();
+         hash.prefixLine = bytes[len-1] == '\n';
+      }
+      if (progress && !progress(pos,hash.size))
+      {
+         err = QObject::tr("Cancelled.\n");
+         return false;
+      }
+   }
+   hash.whole = all.digest();
+   return true;
+}
+
+// Make the .gdt file, or bring it up to date. how says which we did.
+bool updateGdtFile(const QString &src, const QString &dst, const QString &bdt, FTYPE ftype, const GdtSlice &slice,
+                   GdtMade &made, GdtUpdate &how, QString &err, const IoProgress &progress)
+{
+   QString sideName = dst + GDT_SOURCE_SUFFIX;
+   QByteArray options = optionsKey(ftype,bdt,slice);
+   GdtSource old;
+   SourceHash hash;
+   GdtResume resume;
+
+   bool have_old = readGdtSource(sideName,old) && old.options == options && outputsMatch(old,dst,bdt);
+   QFileInfo s_info(src);
+   qint64 src_time = s_info.lastModified().toMSecsSinceEpoch();
+   if (have_old && s_info.size() == old.srcSize && src_time == old.srcTime)
+   {
+      made = old.made;        // same size and time, no need to read it
+      how = GdtUpdate::UNCHANGED;
+      return true;
+   }
+   if (!hashSource(src,have_old ? old.srcSize : 0,hash,err,progress))
+      return false;
+
+   how = GdtUpdate::MADE;
+   if (have_old && hash.size == old.srcSize && hash.whole == old.srcHash)
+   {
+      made = old.made;
+      how = GdtUpdate::UNCHANGED;
+      old.srcTime = src_time;      // touched, so the time does it next time
+      writeGdtSource(sideName,old);
+      return true;
+   }
+     // a compressed source can't be read from the middle
+   if (have_old && old.srcSize > 0 && hash.size > old.srcSize && hash.prefix == old.srcHash && hash.prefixLine
+       && compressionOf(src) == Compression::NONE)
+   {
+      made = old.made;
+      resume.srcOffset = old.srcSize;
+      resume.gdtOffset = old.made.endOffset;
+      resume.bdtOffset = old.bdtSize;
+      how = GdtUpdate::APPENDED;
+   }
+
+   QFile::remove(sideName);     // no good until we are done
+   bool ok;
+   if (ftype == FTYPE::EDT)
+      ok = makeGdtFromEdt(src,dst,bdt,slice,made,err,progress,resume);
+   else
+      ok = makeGdtFile(src,dst,ftype,slice,made,err,progress,resume);
+   if (!ok)
+      return false;
+
+   GdtSource now;
+   QFileInfo g_info(dst);
+   now.options = options;
+   now.srcSize = hash.size;
+   now.srcTime = src_time;
+   now.srcHash = hash.whole;
+   now.gdtSize = g_info.size();
+   now.gdtTime = g_info.lastModified().toMSecsSinceEpoch();
+   now.bdtSize = bdt.length() ? QFileInfo(bdt).size() : 0;
+   now.made = made;
+   writeGdtSource(sideName,now);    // if we can't, it is made again next time
+   return true;
+}
@@ -0,0 +1,39 @@
+#ifndef GDT_UPDATE_H
+#define GDT_UPDATE_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Making a .gdt file again from the same source. A file next to the .gdt
+// file, name.gdt.src, has the size, time, and a hash of the source it was
+// made from and the options used. If they are the same, there is nothing
+// to do, and the source is only hashed if its size or time changed. If
+// the source only has new records on the end, just those are added.
+
+#include <QString>
+#include "gdt_io.h"
+
+const char GDT_SOURCE_SUFFIX[] = ".src";
+
+enum class GdtUpdate {MADE, APPENDED, UNCHANGED};
+
+bool updateGdtFile(const QString &src, const QString &dst, const QString &bdt, FTYPE ftype, const GdtSlice &slice,
+                   GdtMade &made, GdtUpdate &how, QString &err, const IoProgress &progress = IoProgress());
+
+#endif
@@ -0,0 +1,77 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <QFileInfo>
+#include "gdt_watch.h"
+
+GdtWatcher::GdtWatcher(QObject *parent) : QObject(parent)
+{
+   quiet.setSingleShot(true);
+   quiet.setInterval(GDT_SETTLE_MS);
+   connect(&watcher,&QFileSystemWatcher::fileChanged,this,&GdtWatcher::fileChanged);
+   connect(&quiet,&QTimer::timeout,this,&GdtWatcher::settle);
+}
+
+// What was just loaded from path, and when path was last changed before
+// it was read.
+void GdtWatcher::watch(const QString &path, const GdtStamp &when, const GdtInfo &info)
+{
+   if (path != current)
+   {
+      stop();
+      current = path;
+      watcher.addPath(path);
+   }
+   stamp = when;
+   loaded = info;
+}
+
+void GdtWatcher::stop()
+{
+   quiet.stop();
+   if (!watcher.files().isEmpty())
+      watcher.removePaths(watcher.files());
+   current.clear();
+   loaded = GdtInfo();
+   stamp = GdtStamp();
+}
+
+void GdtWatcher::fileChanged(const QString &path)
+{
+   if (path == current)
+      quiet.start();
+}
+
+// A file that was replaced drops out of the watcher, so add it back. If
+// it is gone for now, look again later.
+void GdtWatcher::settle()
+{
+   if (current.isEmpty())
+      return;
+   if (!QFileInfo::exists(current))
+   {
+      quiet.start();
+      return;
+   }
+   if (!watcher.files().contains(current))
+      watcher.addPath(current);
+   if (!(gdtStamp(current) == stamp))
+      emit changed(current);
+}
@@ -0,0 +1,64 @@
+#ifndef GDT_WATCH_H
+#define GDT_WATCH_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Keeps an eye on the .gdt file that is loaded, so when it is made again
+// or added to from somewhere else, say a script in another terminal, the
+// gui can read it again. Changes come in bursts while the file is being
+// written, so changed() is only sent once the file has been left alone
+// for a bit and its size or time is not what it was when it was loaded.
+// Files that are replaced instead of written in place are picked up again.
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include "gdt_cache.h"
+
+const int GDT_SETTLE_MS = 500;    // quiet time before a reload
+
+class GdtWatcher : public QObject
+{
+   Q_OBJECT
+
+   public:
+      explicit GdtWatcher(QObject *parent = nullptr);
+      void watch(const QString &path, const GdtStamp &stamp, const GdtInfo &info);
+      void stop();
+      void retry() { quiet.start(); }
+      QString path() const { return current; }
+      const GdtInfo &info() const { return loaded; }
+
+   signals:
+      void changed(const QString &path);
+
+   private slots:
+      void fileChanged(const QString &path);
+      void settle();
+
+   private:
+      QFileSystemWatcher watcher;
+      QTimer quiet;
+      QString current;
+      GdtStamp stamp;      // of what was loaded
+      GdtInfo loaded;
+};
+
+#endif
@@ -0,0 +1,62 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <QtConcurrent>
+#include "gdt_worker.h"
+
+using namespace std;
+
+GdtWorker::GdtWorker(QObject *parent) : QObject(parent), cancelled(false), percent(-1)
+{
+     // the job gets its own thread, the conversions use the global pool
+   pool.setMaxThreadCount(1);
+   connect(&watcher, &QFutureWatcher<bool>::finished, this, [this]() {
+      function<void(bool)> finish = whenDone;
+      whenDone = nullptr;
+      busy = false;
+      emit running(false);
+      if (finish)
+         finish(watcher.result());
+   });
+}
+
+GdtWorker::~GdtWorker()
+{
+   cancelled = true;
+   watcher.waitForFinished();
+}
+
+void GdtWorker::start(function<bool(const IoProgress&)> job, function<void(bool)> finish)
+{
+   busy = true;
+   cancelled = false;
+   percent = -1;
+   whenDone = finish;
+   emit running(true);
+
+     // called on the worker thread, the signal is queued to the gui
+   IoProgress report = [this](qint64 done, qint64 total) {
+      int pct = total > 0 ? static_cast<int>(done * 100 / total) : 0;
+      if (percent.exchange(pct) != pct)
+         emit progress(pct);
+      return !cancelled;
+   };
+   watcher.setFuture(QtConcurrent::run(&pool,[job,report]() { return job(report); }));
+}
@@ -0,0 +1,59 @@
+#ifndef GDT_WORKER_H
+#define GDT_WORKER_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include "gdt_io.h"
+
+// Runs one file job, such as making or loading a .gdt file, on its own
+// thread so the gui and the terminals of running programs keep going.
+// The job is handed a progress callback to pass on to the gdt_io
+// functions. The finish function is called back on the gui thread.
+class GdtWorker : public QObject
+{
+   Q_OBJECT
+
+   public:
+      explicit GdtWorker(QObject *parent = nullptr);
+      ~GdtWorker();
+      bool isBusy() const { return busy; }
+      bool wasCancelled() const { return cancelled; }
+      void start(std::function<bool(const IoProgress&)> job, std::function<void(bool)> finish);
+      void cancel() { cancelled = true; }
+
+   signals:
+      void progress(int);     // percent done
+      void running(bool);
+
+   private:
+      QThreadPool pool;
+      QFutureWatcher<bool> watcher;
+      std::function<void(bool)> whenDone;
+      std::atomic<bool> cancelled;
+      std::atomic<int> percent;
+      bool busy = false;
+};
+
+#endif
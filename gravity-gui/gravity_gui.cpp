@@ -21,6 +21,10 @@ This file is part of the USF Gravity Gui software suite.
 #include "gravity_gui.h"
 #include "g_prog.h"
 #include "ui_gravity_gui.h"
+#include "gdt_cache.h"
+#include "gdt_prefetch.h"
+#include "job_queue.h"
+#include "job_view.h"
 
 
 #pragma GCC diagnostic ignored "-Wunused-result"
@@ -40,6 +44,10 @@ GravityGui::GravityGui(QWidget *parent) : QMainWindow(parent), ui(new Ui::Gravit
 
 GravityGui::~GravityGui()
 {
+   delete gdtWorker;      // its job may still be filling gdtCache
+   gdtPrefetch.reset();
+   delete jobWin;
+   jobs.reset();          // the programs still running write to the terminals
    delete ui;
    ui = nullptr;
 }
@@ -303,3 +311,23 @@ void GravityGui::on_actionClear_Recent_Session_List_triggered()
 {
    doClearRecents();
 }
+
+void GravityGui::on_actionGdt_Cache_Size_triggered()
+{
+   setCacheSize();
+}
+
+void GravityGui::on_actionSpike_Raster_triggered()
+{
+   showRaster();
+}
+
+void GravityGui::on_actionJob_Queue_triggered()
+{
+   showJobQueue();
+}
+
+void GravityGui::on_actionMax_Jobs_triggered()
+{
+   setMaxJobs();
+}
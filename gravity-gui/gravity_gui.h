@@ -23,33 +23,23 @@ This file is part of the USF Gravity Gui software suite.
 #include <QMainWindow>
 #include <QProcess>
 #include <QTextStream>
-#include <QSignalMapper>
 #include <QCheckBox>
 #include <QColor>
 #include <QStringList>
 #include <QAction>
 #include <set>
 #include <memory>
+#include <functional>
 #include "ReplWidget.h"
+#include "chan_select.h"
 //#include "g_prog.h"
 
 using namespace std;
 
-// First part of file is fixed length
-enum PARAMS1 {SHIFT=0,OUTFILE,PARTICLES,TIMESTEP,SLIDE,NORM,ACCEPTOR,EFFECTOR,
-             FORCE,RATE_NORM,FWD_TAU,BCK_TAU,FWD_CHG,BCK_CHG,WELL_DIAM,OPTIONS,P1_END};
-// Second part depends on # of particles. The second part is fixed offset
-// after you add in the # of particles. Use this, e.g., as #particles+RESPONSE
-enum PARAMS2 {RESPONSE=0,INFILE,TIMESPAN};
-
-// the second part of the file is unused, constant, but has to be there.
-// These are the default values:
-const QStringList secondPart({"N", "2","2","1","1","1","1","2","1000",
-                              "11"});
-
 enum TABS {GBATCH=0,XTRYDIS,XPROJTM,SURROGATES,XSLOPE,SPKPAT,FIREWORKS,THREEDJMP,DIRECT3D,SAVE};
 
 enum FTYPE {ADT=0,BDT,EDT};
+enum SelectMode {SEL_REPLACE=0,SEL_ADD,SEL_KEEP};   // what a selection rule does to the selection
 const QString capDir("captures");
 const int MAX_RECENTS = 8;
 
@@ -57,8 +47,7 @@ using chanList = map<int,int>;
 using chanListIter = chanList::iterator;
 using chanListPair = pair<chanListIter,bool>;
 
-using selChanList = set<int>;
-using selChanListIter = selChanList::iterator;
+using selChanList = ChanSelection;
 
 using analogSet = set<int>;
 using analogSetIter = analogSet::iterator;
@@ -66,7 +55,6 @@ using analogSetIter = analogSet::iterator;
 const int GDT_START=21;
 const int GDT_END=22;
 const int MAX_SPIKES=10000;
-const int PARAM_LINES=32;  // at least this many lines
 // a lot of the fortran programs expect short filenames. Warn if a name is too big.
 const int GBATCH_MAX_FNAME=30;
 
@@ -79,6 +67,26 @@ class GravityGuiCtls;
 }
 
 class GravityProg;
+class GdtWorker;
+class GdtCache;
+class GdtPrefetcher;
+class GdtWatcher;
+class AnalogExtractor;
+class RasterView;
+class JobQueue;
+class JobQueueDialog;
+class RunDir;
+class QDialog;
+class QLabel;
+class ChanListModel;
+class QProgressBar;
+class QPushButton;
+struct GdtInfo;
+struct GdtSlice;
+struct GdtMade;
+struct JobSpec;
+struct GravityParams;
+struct PromptMatch;
 
 class GravityGui : public QMainWindow
 {
@@ -96,8 +104,10 @@ private slots:
     void on_gdtFile_clicked();
     void on_paramLoadFile_clicked();
     void on_paramSaveFile_clicked();
-    void neuroClicked(int);
-    void analogClicked(int);
+    void neuroClicked(int chan, bool checked);
+    void analogClicked(int chan, bool checked);
+    void neuroMenu(const QPoint &pos);
+    void gdtFileChanged(const QString &path);
     void on_shiftValues_currentIndexChanged(int index);
     void on_timeStep_valueChanged(double arg1);
     void on_slideValue_textChanged(const QString &arg1);
@@ -144,25 +154,10 @@ private slots:
     void on_openViewer_clicked();
     void OpenRecentProj();
     void on_actionClear_Recent_Session_List_triggered();
-
-public slots:
-    void progGbatchDone(int,QProcess::ExitStatus);
-    void progXtrydisDone(int,QProcess::ExitStatus);
-    void progXtrydisGotLine(QByteArray);
-    void progXprojtmDone(int,QProcess::ExitStatus);
-    void progXprojtmGotLine(QByteArray);
-    void progSurrogatesDone(int,QProcess::ExitStatus);
-    void progGsigDone(int,QProcess::ExitStatus);
-    void progXslopeDone(int,QProcess::ExitStatus);
-    void progXslopeGotLine(QByteArray);
-    void progSpkPatDone(int,QProcess::ExitStatus);
-    void progSpkPatGotLine(QByteArray);
-    void prog3dDone(int,QProcess::ExitStatus);
-    void prog3dGotLine(QByteArray);
-    void progFireworksDone(int,QProcess::ExitStatus);
-    void progFireworksGotLine(QByteArray);
-    void prog3DJmpDone(int,QProcess::ExitStatus);
-    void prog3DJmpGotLine(QByteArray);
+    void on_actionGdt_Cache_Size_triggered();
+    void on_actionSpike_Raster_triggered();
+    void on_actionJob_Queue_triggered();
+    void on_actionMax_Jobs_triggered();
 
 protected:
       void closeEvent(QCloseEvent *evt);
@@ -176,15 +171,29 @@ private:
     void setOtherButtonFont(const QFont&);
     void setInputFont(const QFont&);
     void makeGDT();
+    bool askGdtSlice(GdtSlice&);
+    void makeGDTDone(const QString&, const QString&, FTYPE, const GdtMade&);
     void warnTooLong(const QString&);
-    void makeOffsetsGnew();
+    bool makeOffsetsGnew(RunDir&, int, QString&);
     void gdtFileOpen();
-    void gdtFileLoad(QString);
+    void gdtFileLoad(QString, function<void()> = nullptr);
+    bool ioBusy();
+    void showCacheCounts();
+    void setCacheSize();
+    void showRaster();
+    void loadRaster();
+    void showJobs();
+    void showJobQueue();
+    void setMaxJobs();
+    ReplWidget *tabTerm(int);
     void checkSelected();
     void validateGDT();
+    bool askSelectRange(const QString&, const QString&, int, double&, double&, SelectMode&);
+    bool askSelectPattern(QString&, SelectMode&);
+    void applySelection(const ChanSelection&, SelectMode);
     void paramLoad();
     void paramSave();
-    QString buildParams();
+    GravityParams buildParams();
     void initParams();
     void actionQuit();
     void doClearRecents();
@@ -194,6 +203,17 @@ private:
     void doWinCap();
     void doOpenViewer();
     void quitCurrentProg();
+    JobSpec progJob(const QString&, ReplWidget*, void (GravityGui::*)(const QList<PromptMatch>&) = nullptr);
+    void focusTerm(ReplWidget*, int = 0);
+    void progXtrydisPrompts(const QList<PromptMatch>&);
+    void progXprojtmPrompts(const QList<PromptMatch>&);
+    void progXslopePrompts(const QList<PromptMatch>&);
+    void progSpkPatPrompts(const QList<PromptMatch>&);
+    void prog3dPrompts(const QList<PromptMatch>&);
+    void progFireworksPrompts(const QList<PromptMatch>&);
+    void prog3DJmpPrompts(const QList<PromptMatch>&);
+    bool runReady(RunDir&, JobSpec&, ReplWidget*, const QString&, bool);
+    void runDone(RunDir&, const QString&, ReplWidget*, int, QProcess::ExitStatus);
     void doXtrydis();
     void doGbatch();
     void doXprojtm();
@@ -212,7 +232,7 @@ private:
     void baseNameChanged();
     void modNameChanged();
     bool setSurrogatesArgs(QStringList&);
-    bool makeChanList(QString);
+    bool makeChanList(const GdtInfo&);
     void paramsDirty();
     void paramsClean();
     void checkDirty();
@@ -228,39 +248,45 @@ private:
     void fireworksSwitch();
     void threeDJmpSwitch();
     void saveSwitch();
-    bool edt2bdt(QString&, QString&);
     void createCapture();
     void updateRecents();
 
     QString gdtSelFName;
     QString gdtParamFName;
     QString paramFName;
+    QString gdtSliceRange;
+    QString gdtSliceChans;
     chanList currChans;
     analogSet analogList;
     selChanList selectedChans;
     bool haveGDT=false;
     bool dirtyFlag=false;
-    int waitForWinTime=0;
+    set<ReplWidget*> focusWait;     // terminals waiting for a program's window
     QStringList recentProjs;
     QAction *menuProjs[MAX_RECENTS];
 
-    unique_ptr<GravityProg> progTrydis;
-    unique_ptr<GravityProg> progGbatch;
-    unique_ptr<GravityProg> progXprojtm;
-    unique_ptr<GravityProg> progSurrogates;
-    unique_ptr<GravityProg> progGsig;
-    unique_ptr<GravityProg> progXslope;
-    unique_ptr<GravityProg> progSpkPat;
-    unique_ptr<GravityProg> progFireworks;
-    unique_ptr<GravityProg> prog3DJmp;
-    unique_ptr<GravityProg> prog3d;
+    unique_ptr<JobQueue> jobs;      // the programs, running and waiting
 
     QColor tabBlack = QColor(0,0,0);
     QColor tabRunning = QColor(150,70,0);
 
 
-    QSignalMapper *neuroMapper;
-    QSignalMapper *analogMapper;
+    ChanListModel *neuroModel;
+    ChanListModel *analogModel;
+    GdtWorker *gdtWorker;
+    QProgressBar *ioProgress;
+    QPushButton *ioCancel;
+    unique_ptr<GdtCache> gdtCache;
+    unique_ptr<GdtPrefetcher> gdtPrefetch;    // uses gdtCache, so is deleted before it
+    GdtWatcher *gdtWatch;
+    unique_ptr<AnalogExtractor> analogExtract;
+    QDialog *rasterWin = nullptr;
+    RasterView *raster = nullptr;
+    QLabel *cacheStatus;
+    int gdtCacheMB;
+    JobQueueDialog *jobWin = nullptr;
+    QLabel *jobStatus;
+    int maxJobs;
 
     Ui::GravityGuiCtls *ui;
 };
@@ -6,7 +6,7 @@
 
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = gravity_gui
 TEMPLATE = app
@@ -15,7 +15,13 @@ CONFIG -= debug_and_release
 CONFIG += warn_off
 CONFIG += debug
 
-LIBS += -lncurses
+LIBS += -lncurses -lz
+
+# .zst spike files, if we have zstd
+packagesExist(libzstd) {
+    DEFINES += HAVE_ZSTD
+    LIBS += -lzstd
+}
 
 QMAKE_CXXFLAGS += -Wall -Wno-strict-aliasing
 
@@ -25,10 +31,60 @@ SOURCES += main.cpp\
            g_progs_impl.cpp \
            g_prog.cpp \
            ReplWidget.cpp \ 
-    helpbox.cpp
+    helpbox.cpp \
+    gdt_io.cpp \
+    gdt_worker.cpp \
+    gdt_index.cpp \
+    gdt_update.cpp \
+    gdt_cache.cpp \
+    gdt_prefetch.cpp \
+    gdt_watch.cpp \
+    raster_pyramid.cpp \
+    raster_view.cpp \
+    analog_trace.cpp \
+    analog_io.cpp \
+    analog_extract.cpp \
+    job_queue.cpp \
+    job_view.cpp \
+    run_dir.cpp \
+    gravity_params.cpp \
+    pipeline.cpp \
+    prompt_engine.cpp \
+    spike_input.cpp \
+    batch_convert.cpp \
+    content_hash.cpp \
+    chan_stats.cpp \
+    chan_select.cpp \
+    chan_model.cpp
 
 HEADERS  += gravity_gui.h ReplWidget.h g_prog.h \
-    helpbox.h
+    helpbox.h \
+    gdt_io.h \
+    gdt_worker.h \
+    gdt_index.h \
+    gdt_update.h \
+    gdt_cache.h \
+    gdt_prefetch.h \
+    gdt_watch.h \
+    raster_pyramid.h \
+    raster_view.h \
+    analog_trace.h \
+    analog_io.h \
+    analog_extract.h \
+    job_queue.h \
+    job_view.h \
+    run_dir.h \
+    gravity_params.h \
+    pipeline.h \
+    prompt_engine.h \
+    spike_input.h \
+    batch_convert.h \
+    content_hash.h \
+    chan_stats.h \
+    chan_select.h \
+    chan_model.h \
+    spike_decode.h \
+    spike_format.h
 
 FORMS    += gravity_gui.ui \
     helpbox.ui
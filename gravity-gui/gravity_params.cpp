@@ -0,0 +1,149 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Reading and writing parameter files, see gravity_params.h.
+
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTextStream>
+#include "gravity_params.h"
+
+void GravityParams::setBase(const QString &base)
+{
+   gout = base + ".gout";
+   pos = base + ".pos";
+   dir = base + ".dir";
+}
+
+QString GravityParams::base() const
+{
+   return QFileInfo(gout).completeBaseName();
+}
+
+bool GravityParams::load(const QString &fName, QString &err)
+{
+   QFile file(fName);
+   if (!file.open(QIODevice::ReadOnly))
+   {
+      QTextStream(&err) << QObject::tr("Error opening file ") << fName << endl << QObject::tr("Error is:               ") << file.errorString();
+      return false;
+   }
+   QString all = file.readAll();
+     // ignore blank lines or lines with just ws
+   QStringList rows = all.split(QRegularExpression("\\s+"),QString::SkipEmptyParts);
+   if (rows.size() < PARAM_LINES || !rows[SHIFT].contains("100") || !rows[OUTFILE].contains(".gout"))
+   {
+      QTextStream(&err) << QObject::tr("FATAL: This does not seem to be a valid parameter file.") << endl;
+      return false;
+   }
+
+   shift = rows[SHIFT];
+   gout = rows[OUTFILE];
+   int num_particles = rows[PARTICLES].toInt();
+   timeStep = rows[TIMESTEP];
+   slide = rows[SLIDE];
+   norm = rows[NORM];
+   acceptor = rows[ACCEPTOR];
+   effector = rows[EFFECTOR];
+   force = rows[FORCE];
+   fwdTau = rows[FWD_TAU];
+   bckTau = rows[BCK_TAU];
+   fwdChg = rows[FWD_CHG];
+   bckChg = rows[BCK_CHG];
+   wellDiam = rows[WELL_DIAM];
+   options = rows[OPTIONS];
+   int second = P1_END + num_particles;
+   if (num_particles < 0 || rows.size() <= second + TIMESPAN)
+   {
+      QTextStream(&err) << QObject::tr("FATAL: This does not seem to be a valid parameter file.") << endl;
+      return false;
+   }
+   chans.clear();
+   for (int chan = 0; chan < num_particles; ++chan)
+      chans.push_back(rows[P1_END+chan].toInt());
+   gdtFile = rows[second+INFILE];
+   timeSpan = rows[second+TIMESPAN];
+   int names = second + TIMESPAN + 1 + secondPart.size();
+   if (rows.size() > names + 1)
+   {
+      pos = rows[names];
+      dir = rows[names+1];
+   }
+   else
+   {
+      pos = base() + ".pos";
+      dir = base() + ".dir";
+   }
+   return true;
+}
+
+QString GravityParams::text() const
+{
+   QString params;
+   QTextStream stream(&params);
+
+   stream << shift << endl;
+   stream << gout << endl;
+   stream << chans.size() << endl;
+   stream << timeStep << endl;
+   stream << slide << endl;
+   stream << norm << endl;
+   stream << acceptor << endl;
+   stream << effector << endl;
+   stream << force << endl;
+   stream << "3" << endl;   // rate norm is constant
+   stream << fwdTau << endl;
+   stream << bckTau << endl;
+   stream << fwdChg << endl;
+   stream << bckChg << endl;
+   stream << wellDiam << endl;
+   stream << options << endl;
+   for (int chan : chans)
+      stream << chan << endl;
+   stream << "y" << endl;     // "yes" to a prompt
+   stream << gdtFile << endl;
+   stream << timeSpan << endl;
+   for (auto &line : secondPart)  // always same, but has to be there
+      stream << line << endl;
+   stream << pos << endl;
+   stream << dir << endl;
+   stream << "e" << endl << endl;
+
+   return params;
+}
+
+// The command line for edt_surrogate to make count surrogates of the
+// spike trains in gdt, leaving out the analog channels, which it takes
+// as their number plus 1000.
+QStringList surrogateArgs(const QString &gdt, const QString &count, const QString &seed,
+                          const std::set<int> &analogs)
+{
+   QStringList args;
+
+   args << gdt << "count" << count;
+   if (seed.length() != 0)
+      args << "seed" << seed;
+   args << "exclude";
+   for (int chan : analogs)
+      args << QString::number(chan+1000);
+   return args;
+}
@@ -0,0 +1,78 @@
+#ifndef GRAVITY_PARAMS_H
+#define GRAVITY_PARAMS_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// The parameters gbatch and gsig read on stdin, which is also the format
+// of a parameter file. The gui fills this in from its controls, the
+// pipeline mode from a file, so nothing here needs a widget. The values
+// are kept as the text that goes in the file.
+
+#include <QString>
+#include <QStringList>
+#include <vector>
+#include <set>
+
+// First part of file is fixed length
+enum PARAMS1 {SHIFT=0,OUTFILE,PARTICLES,TIMESTEP,SLIDE,NORM,ACCEPTOR,EFFECTOR,
+             FORCE,RATE_NORM,FWD_TAU,BCK_TAU,FWD_CHG,BCK_CHG,WELL_DIAM,OPTIONS,P1_END};
+// Second part depends on # of particles. The second part is fixed offset
+// after you add in the # of particles. Use this, e.g., as #particles+RESPONSE
+enum PARAMS2 {RESPONSE=0,INFILE,TIMESPAN};
+
+// the second part of the file is unused, constant, but has to be there.
+// These are the default values:
+const QStringList secondPart({"N", "2","2","1","1","1","1","2","1000",
+                              "11"});
+
+const int PARAM_LINES=32;  // at least this many lines
+
+struct GravityParams
+{
+   QString shift;          // also the number of surrogates
+   QString gout;           // output file names
+   QString pos;
+   QString dir;
+   QString timeStep;
+   QString slide;
+   QString norm;
+   QString acceptor;
+   QString effector;
+   QString force;
+   QString fwdTau;
+   QString bckTau;
+   QString fwdChg;
+   QString bckChg;
+   QString wellDiam;
+   QString options;
+   std::vector<int> chans;
+   QString gdtFile;
+   QString timeSpan;
+
+   void setBase(const QString &base);
+   QString base() const;
+   bool load(const QString &fName, QString &err);
+   QString text() const;
+};
+
+QStringList surrogateArgs(const QString &gdt, const QString &count, const QString &seed,
+                          const std::set<int> &analogs);
+
+#endif
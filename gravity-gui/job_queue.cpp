@@ -0,0 +1,307 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// The job queue behind the run buttons, see job_queue.h.
+
+#include <algorithm>
+#include "job_queue.h"
+#include "g_prog.h"
+
+using namespace std;
+
+JobQueue::JobQueue(GravityGui *owner, int most) : gui(owner), maxJobs(max(most,1))
+{
+}
+
+// The programs still running are killed. They must not call back into a
+// queue that is going away.
+JobQueue::~JobQueue()
+{
+   for (Job &job : jobs)
+      if (job.prog)
+      {
+         job.prog->disconnect(this);
+         delete job.prog;
+         job.prog = nullptr;
+      }
+}
+
+int JobQueue::submit(const JobSpec &spec)
+{
+   jobs.emplace_back();
+   Job &job = jobs.back();
+   job.id = nextId++;
+   job.seq = job.id;
+   job.spec = spec;
+   job.queued = QDateTime::currentDateTime();
+   if (job.spec.interactive && !job.spec.terminal)
+      job.spec.interactive = false;
+   schedule();
+   emit changed();
+   return job.id;
+}
+
+JobQueue::Job *JobQueue::find(int id)
+{
+   auto iter = find_if(jobs.begin(),jobs.end(),[=](const Job &job) { return job.id == id; });
+   return iter == jobs.end() ? nullptr : &*iter;
+}
+
+const JobQueue::Job *JobQueue::job(int id) const
+{
+   return const_cast<JobQueue*>(this)->find(id);
+}
+
+QByteArray JobQueue::output(int id) const
+{
+   const Job *found = job(id);
+   if (!found)
+      return QByteArray();
+   return found->prog ? found->prog->output() : found->log;
+}
+
+// Stopping a running job goes through its finish like any other exit.
+void JobQueue::cancel(int id)
+{
+   Job *job = find(id);
+   if (!job)
+      return;
+   if (job->state == QUEUED)
+   {
+      job->state = CANCELLED;
+      job->finished = QDateTime::currentDateTime();
+      schedule();
+      emit changed();
+   }
+   else if (job->state == RUNNING && job->prog)
+   {
+      job->stopping = true;
+      job->prog->terminateProg();
+   }
+}
+
+void JobQueue::stopIn(ReplWidget *terminal)
+{
+   for (Job &job : jobs)
+      if (job.state == RUNNING && job.shownIn == terminal)
+         cancel(job.id);
+}
+
+void JobQueue::setPriority(int id, int priority)
+{
+   Job *job = find(id);
+   if (job && job->state == QUEUED && job->spec.priority != priority)
+   {
+      job->spec.priority = priority;
+      schedule();
+      emit changed();
+   }
+}
+
+// Each takes the other's priority and place among equal ones, so only
+// the two of them move.
+void JobQueue::swap(int id, int other)
+{
+   Job *one = find(id);
+   Job *two = find(other);
+   if (!one || !two || one == two || one->state != QUEUED || two->state != QUEUED)
+      return;
+   std::swap(one->spec.priority,two->spec.priority);
+   std::swap(one->seq,two->seq);
+   schedule();
+   emit changed();
+}
+
+void JobQueue::setMaxRunning(int most)
+{
+   maxJobs = max(most,1);
+   schedule();
+   emit changed();
+}
+
+int JobQueue::count(State state) const
+{
+   return count_if(jobs.begin(),jobs.end(),[=](const Job &job) { return job.state == state; });
+}
+
+bool JobQueue::inUse(ReplWidget *terminal) const
+{
+   return any_of(jobs.begin(),jobs.end(),
+                 [=](const Job &job) { return job.state == RUNNING && job.shownIn == terminal; });
+}
+
+bool JobQueue::laneBusy(const JobSpec &spec) const
+{
+   return !spec.lane.isEmpty() &&
+          any_of(jobs.begin(),jobs.end(),[&](const Job &job) {
+             return job.state == RUNNING && job.spec.lane == spec.lane && !(spec.shared && job.spec.shared);
+          });
+}
+
+// The queued jobs in the order they will be started, then the others,
+// the latest first.
+QList<int> JobQueue::ids() const
+{
+   vector<const Job*> waiting, others;
+   for (const Job &job : jobs)
+      (job.state == QUEUED ? waiting : others).push_back(&job);
+   sort(waiting.begin(),waiting.end(),[](const Job *a, const Job *b) {
+      return a->spec.priority != b->spec.priority ? a->spec.priority > b->spec.priority : a->seq < b->seq;
+   });
+   QList<int> result;
+   for (const Job *job : waiting)
+      result.append(job->id);
+   for (auto iter = others.rbegin(); iter != others.rend(); ++iter)
+      result.append((*iter)->id);
+   return result;
+}
+
+// Start what we can. A job waiting for its lane or terminal holds them for
+// the jobs after it, so jobs in one lane always start in order. The ready
+// checks can put up a dialog, and other jobs can finish while it is up, so
+// a call that comes in then just asks for another pass.
+void JobQueue::schedule()
+{
+   if (scheduling)
+   {
+      again = true;
+      return;
+   }
+   scheduling = true;
+   do
+   {
+      again = false;
+      QStringList heldLanes;
+      QList<ReplWidget*> heldTerms;
+      for (int id : ids())
+      {
+         Job *job = find(id);
+         if (!job || job->state != QUEUED)
+            continue;
+         if (count(RUNNING) >= maxJobs)
+            break;
+         const JobSpec &spec = job->spec;
+         bool wait = laneBusy(spec) || heldLanes.contains(spec.lane) ||
+                     (spec.interactive && (inUse(spec.terminal) || heldTerms.contains(spec.terminal)));
+         if (wait)
+         {
+            if (!spec.lane.isEmpty())
+               heldLanes.append(spec.lane);
+            if (spec.interactive)
+               heldTerms.append(spec.terminal);
+            continue;
+         }
+         if (!start(*job))
+            again = true;     // dropped, look again from the top
+         if (again)
+            break;
+      }
+   } while (again);
+   scheduling = false;
+}
+
+// The job can be cancelled, or even dropped from the history, while a
+// ready check is up, so look it up again after. If it was, whatever the
+// check set up is undone by the cancelled callback.
+bool JobQueue::start(Job &ready_job)
+{
+   int id = ready_job.id;
+   JobSpec spec = ready_job.spec;
+   bool go = !spec.ready || spec.ready(spec);
+   Job *found = find(id);
+   if (!found || found->state != QUEUED)
+   {
+      if (go && spec.cancelled)
+         spec.cancelled();
+      return false;
+   }
+   Job &job = *found;
+   job.spec = spec;
+   if (!go)
+   {
+      job.state = CANCELLED;
+      job.finished = QDateTime::currentDateTime();
+      emit changed();
+      return false;
+   }
+
+   ReplWidget *term = job.spec.terminal;
+   if (term && !job.spec.interactive && inUse(term))
+      term = nullptr;
+   job.shownIn = term;
+   job.prog = new GravityProg(gui,term,job.spec.program);
+   if (!job.spec.env.isEmpty())
+      job.prog->setEnv(job.spec.env);
+   if (!job.spec.workDir.isEmpty())
+      job.prog->setWorkDir(job.spec.workDir);
+   connect(job.prog,&GravityProg::progDone,this,
+           [=](int code, QProcess::ExitStatus status) { finish(id,code,status); });
+   job.state = RUNNING;
+   job.started = QDateTime::currentDateTime();
+   if (job.spec.started)
+      job.spec.started(job.prog,term != nullptr);
+   if (!job.prog->progInvoke(job.spec.args))
+   {
+      finish(id,-1,QProcess::CrashExit);
+      return true;
+   }
+   if (!job.spec.input.isEmpty())
+      job.prog->stdIn(job.spec.input);
+   emit changed();
+   return true;
+}
+
+// The program is deleted later, we may be inside one of its signals. Its
+// terminal is free again before the done callback runs, so the callback
+// can see if another job is still using it. shownIn is kept for the view.
+void JobQueue::finish(int id, int code, QProcess::ExitStatus status)
+{
+   Job *job = find(id);
+   if (!job || job->state != RUNNING)
+      return;
+   if (job->stopping)
+      job->state = CANCELLED;
+   else
+      job->state = code == 0 && status == QProcess::NormalExit ? DONE : FAILED;
+   job->exitCode = code;
+   job->finished = QDateTime::currentDateTime();
+   job->log = job->prog->output();
+   job->prog->disconnect(this);
+   job->prog->deleteLater();
+   job->prog = nullptr;
+   auto done = job->spec.done;
+   trimHistory();
+   if (done)
+      done(code,status);
+   schedule();
+   emit changed();
+}
+
+void JobQueue::trimHistory()
+{
+   int finished = jobs.size() - count(QUEUED) - count(RUNNING);
+   for (auto iter = jobs.begin(); iter != jobs.end() && finished > JOB_HISTORY; )
+      if (iter->state != QUEUED && iter->state != RUNNING)
+      {
+         iter = jobs.erase(iter);
+         --finished;
+      }
+      else
+         ++iter;
+}
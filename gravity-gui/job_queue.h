@@ -0,0 +1,123 @@
+#ifndef JOB_QUEUE_H
+#define JOB_QUEUE_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Runs the gravity programs. Each press of a run button puts a job in the
+// queue, and up to maxRunning() jobs run at once, highest priority first,
+// then in the order they were put in, unless they were moved past each
+// other or given another priority in the queue view. gbatch, gsig, and
+// edt_surrogate run on their own, so they are put in at JOB_BACKGROUND,
+// behind the programs someone is waiting on at a terminal. Jobs that
+// would step on each other, say by one reading what another writes, are
+// given the same lane and run one at a time, in order, except that shared
+// jobs in a lane can run together when no other kind is running. A
+// program that asks the user things needs its terminal and waits for it. One that doesn't shows in its terminal if that is
+// free, or else its output is kept with the job for the queue view.
+
+#include <QObject>
+#include <QProcess>
+#include <QDateTime>
+#include <QStringList>
+#include <functional>
+#include <list>
+
+class GravityGui;
+class GravityProg;
+class ReplWidget;
+
+const int JOB_HISTORY = 200;      // finished jobs kept for the queue view
+const int JOB_BACKGROUND = -1;    // priority of jobs no one sits at a terminal for
+
+struct JobSpec
+{
+   QString program;
+   QStringList args;
+   QStringList env;                // name, value pairs
+   QString input;                  // written to stdin once it starts
+   QString lane;                   // jobs in the same lane run one at a time
+   bool shared = false;            // but shared ones can run with each other
+   QString workDir;                // empty for the session directory
+   ReplWidget *terminal = nullptr;
+   bool interactive = true;        // has to have its terminal
+   int priority = 0;
+   std::function<bool(JobSpec&)> ready;   // just before it starts, can fill in the rest, false drops it
+   std::function<void(GravityProg*,bool)> started;   // the program, and if it is in the terminal
+   std::function<void(int,QProcess::ExitStatus)> done;
+   std::function<void()> cancelled;       // after ready said yes, it won't run after all
+};
+
+class JobQueue : public QObject
+{
+   Q_OBJECT
+
+   public:
+      enum State {QUEUED, RUNNING, DONE, FAILED, CANCELLED};
+      struct Job
+      {
+         int id = 0;
+         int seq = 0;                     // order among equal priorities
+         JobSpec spec;
+         State state = QUEUED;
+         GravityProg *prog = nullptr;     // while it runs
+         ReplWidget *shownIn = nullptr;   // the terminal it got, if any
+         bool stopping = false;           // cancelled while running
+         QDateTime queued;
+         QDateTime started;
+         QDateTime finished;
+         int exitCode = 0;
+         QByteArray log;                  // output, if it had no terminal
+      };
+
+      explicit JobQueue(GravityGui *owner, int most);
+      ~JobQueue();
+      int submit(const JobSpec &spec);
+      void cancel(int id);                 // drop it if queued, stop it if running
+      void stopIn(ReplWidget *terminal);   // the job that has it
+      void setPriority(int id, int priority);
+      void swap(int id, int other);        // two queued jobs trade places
+      void setMaxRunning(int most);
+      int maxRunning() const { return maxJobs; }
+      int count(State state) const;
+      bool inUse(ReplWidget *terminal) const;
+      const Job *job(int id) const;
+      QByteArray output(int id) const;     // so far, of one with no terminal
+      QList<int> ids() const;              // queued by priority and seq, then the rest, newest first
+
+   signals:
+      void changed();
+
+   private:
+      Job *find(int id);
+      bool laneBusy(const JobSpec &spec) const;
+      void schedule();
+      bool start(Job &job);
+      void finish(int id, int code, QProcess::ExitStatus status);
+      void trimHistory();
+
+      GravityGui *gui;
+      std::list<Job> jobs;      // in the order they were put in
+      int maxJobs;
+      int nextId = 1;
+      bool scheduling = false;
+      bool again = false;
+};
+
+#endif
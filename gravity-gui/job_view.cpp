@@ -0,0 +1,243 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// The job queue window, see job_view.h.
+
+#include <QTableView>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTimer>
+#include <QFontDatabase>
+#include "job_view.h"
+
+static QString stateName(JobQueue::State state)
+{
+   switch (state)
+   {
+      case JobQueue::QUEUED:    return QObject::tr("queued");
+      case JobQueue::RUNNING:   return QObject::tr("running");
+      case JobQueue::DONE:      return QObject::tr("done");
+      case JobQueue::FAILED:    return QObject::tr("failed");
+      case JobQueue::CANCELLED: return QObject::tr("cancelled");
+   }
+   return QString();
+}
+
+// h:mm:ss
+static QString runTime(qint64 secs)
+{
+   return QString("%1:%2:%3").arg(secs / 3600).arg(secs / 60 % 60,2,10,QChar('0')).arg(secs % 60,2,10,QChar('0'));
+}
+
+JobListModel::JobListModel(JobQueue *queue, QObject *parent) : QAbstractTableModel(parent), jobs(queue)
+{
+   rows = jobs->ids();
+}
+
+void JobListModel::reload()
+{
+   beginResetModel();
+   rows = jobs->ids();
+   endResetModel();
+}
+
+void JobListModel::tick()
+{
+   if (!rows.isEmpty())
+      emit dataChanged(index(0,TIME),index(rows.size()-1,TIME),{Qt::DisplayRole});
+}
+
+int JobListModel::rowCount(const QModelIndex &parent) const
+{
+   return parent.isValid() ? 0 : rows.size();
+}
+
+int JobListModel::columnCount(const QModelIndex &parent) const
+{
+   return parent.isValid() ? 0 : COLUMNS;
+}
+
+// The time is how long it has waited if it is queued, else how long it ran.
+QVariant JobListModel::data(const QModelIndex &index, int role) const
+{
+   if (!index.isValid() || index.row() >= rows.size())
+      return QVariant();
+   const JobQueue::Job *job = jobs->job(rows[index.row()]);
+   if (!job)
+      return QVariant();
+   if (role == Qt::ToolTipRole)
+      return job->spec.program + " " + job->spec.args.join(' ');
+   if (role == Qt::TextAlignmentRole && (index.column() == ID || index.column() == PRIORITY))
+      return int(Qt::AlignRight | Qt::AlignVCenter);
+   if (role != Qt::DisplayRole)
+      return QVariant();
+
+   QDateTime now = QDateTime::currentDateTime();
+   switch (index.column())
+   {
+      case ID:
+         return job->id;
+      case PROGRAM:
+         return job->spec.program;
+      case LANE:
+         return job->spec.lane;
+      case PRIORITY:
+         return job->spec.priority;
+      case STATE:
+         if (job->state == JobQueue::FAILED)
+            return stateName(job->state) + " (" + QString::number(job->exitCode) + ")";
+         if (job->state == JobQueue::RUNNING && !job->shownIn)
+            return tr("running, no terminal");
+         return stateName(job->state);
+      case TIME:
+         if (job->state == JobQueue::QUEUED)
+            return runTime(job->queued.secsTo(now));
+         if (job->started.isValid())
+            return runTime(job->started.secsTo(job->state == JobQueue::RUNNING ? now : job->finished));
+         return QString();
+   }
+   return QVariant();
+}
+
+QVariant JobListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+   static const char *names[COLUMNS] = {"Job","Program","Lane","Priority","State","Time"};
+
+   if (orientation != Qt::Horizontal || role != Qt::DisplayRole || section < 0 || section >= COLUMNS)
+      return QVariant();
+   return tr(names[section]);
+}
+
+JobQueueDialog::JobQueueDialog(JobQueue *queue, QWidget *parent) : QDialog(parent), jobs(queue)
+{
+   setWindowTitle(tr("Job Queue"));
+   resize(700,400);
+   model = new JobListModel(jobs,this);
+   table = new QTableView(this);
+   table->setModel(model);
+   table->setSelectionBehavior(QAbstractItemView::SelectRows);
+   table->setSelectionMode(QAbstractItemView::SingleSelection);
+   table->verticalHeader()->hide();
+   table->horizontalHeader()->setStretchLastSection(true);
+   upButton = new QPushButton(tr("Up"),this);
+   downButton = new QPushButton(tr("Down"),this);
+   cancelButton = new QPushButton(tr("Cancel Job"),this);
+   outputButton = new QPushButton(tr("Output"),this);
+   priorityBox = new QSpinBox(this);
+   priorityBox->setRange(-99,99);
+   priorityBox->setToolTip(tr("Higher priority jobs start first"));
+   QLabel *priorityLabel = new QLabel(tr("Priority:"),this);
+   priorityLabel->setBuddy(priorityBox);
+   QPushButton *closeButton = new QPushButton(tr("Close"),this);
+
+   QHBoxLayout *buttons = new QHBoxLayout;
+   buttons->addWidget(upButton);
+   buttons->addWidget(downButton);
+   buttons->addWidget(priorityLabel);
+   buttons->addWidget(priorityBox);
+   buttons->addWidget(cancelButton);
+   buttons->addWidget(outputButton);
+   buttons->addStretch();
+   buttons->addWidget(closeButton);
+   QVBoxLayout *layout = new QVBoxLayout(this);
+   layout->addWidget(table);
+   layout->addLayout(buttons);
+
+   connect(upButton,&QPushButton::clicked,this,[this]() { moveJob(-1); });
+   connect(downButton,&QPushButton::clicked,this,[this]() { moveJob(1); });
+   connect(priorityBox,static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),this,
+           [this](int priority) { jobs->setPriority(currentId(),priority); });
+   connect(cancelButton,&QPushButton::clicked,this,[this]() { jobs->cancel(currentId()); });
+   connect(outputButton,&QPushButton::clicked,this,&JobQueueDialog::showOutput);
+   connect(closeButton,&QPushButton::clicked,this,&QDialog::hide);
+   connect(table->selectionModel(),&QItemSelectionModel::currentRowChanged,this,&JobQueueDialog::updateButtons);
+   connect(table,&QTableView::doubleClicked,this,&JobQueueDialog::showOutput);
+
+     // keep the same job picked when the rows move around
+   connect(jobs,&JobQueue::changed,this,[this]() {
+      int id = currentId();
+      model->reload();
+      int row = model->rowOf(id);
+      if (row >= 0)
+         table->selectRow(row);
+      updateButtons();
+   });
+   clock = new QTimer(this);
+   connect(clock,&QTimer::timeout,model,&JobListModel::tick);
+   clock->start(1000);
+   updateButtons();
+}
+
+int JobQueueDialog::currentId() const
+{
+   QModelIndex current = table->selectionModel()->currentIndex();
+   return current.isValid() && table->selectionModel()->isRowSelected(current.row(),QModelIndex()) ?
+          model->idAt(current.row()) : 0;
+}
+
+// Up swaps a queued job with the one above it, down with the one below.
+void JobQueueDialog::moveJob(int by)
+{
+   int id = currentId();
+   const JobQueue::Job *job = jobs->job(id);
+   if (!job || job->state != JobQueue::QUEUED)
+      return;
+   jobs->swap(id,model->idAt(model->rowOf(id) + by));
+}
+
+void JobQueueDialog::showOutput()
+{
+   const JobQueue::Job *job = jobs->job(currentId());
+   if (!job)
+      return;
+   QDialog *win = new QDialog(this);
+   win->setAttribute(Qt::WA_DeleteOnClose);
+   win->setWindowTitle(tr("Job %1: %2").arg(job->id).arg(job->spec.program));
+   win->resize(700,500);
+   QPlainTextEdit *text = new QPlainTextEdit(win);
+   text->setReadOnly(true);
+   text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+   QByteArray output = jobs->output(job->id);
+   if (output.isEmpty())
+      text->setPlainText(job->state == JobQueue::QUEUED ? tr("It has not started.") :
+                         job->shownIn ? tr("The output is in the terminal.") : tr("No output."));
+   else
+      text->setPlainText(QString::fromLatin1(output));
+   QVBoxLayout *layout = new QVBoxLayout(win);
+   layout->addWidget(text);
+   win->show();
+}
+
+void JobQueueDialog::updateButtons()
+{
+   const JobQueue::Job *job = jobs->job(currentId());
+   bool queued = job && job->state == JobQueue::QUEUED;
+   upButton->setEnabled(queued);
+   downButton->setEnabled(queued);
+   priorityBox->setEnabled(queued);
+   QSignalBlocker quiet(priorityBox);
+   priorityBox->setValue(job ? job->spec.priority : 0);
+   cancelButton->setEnabled(job && (queued || job->state == JobQueue::RUNNING));
+   outputButton->setEnabled(job != nullptr);
+}
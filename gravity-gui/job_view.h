@@ -0,0 +1,86 @@
+#ifndef JOB_VIEW_H
+#define JOB_VIEW_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// A window on the job queue. The rows are the queued jobs in the order
+// they will start, then the running and finished ones. A queued job can be
+// moved up or down or given another priority, any job that has not
+// finished can be cancelled, and the output of one that ran without a
+// terminal can be looked at.
+
+#include <QAbstractTableModel>
+#include <QDialog>
+#include <QList>
+#include "job_queue.h"
+
+class QTableView;
+class QPushButton;
+class QSpinBox;
+class QTimer;
+
+class JobListModel : public QAbstractTableModel
+{
+   Q_OBJECT
+
+   public:
+      enum Column {ID=0,PROGRAM,LANE,PRIORITY,STATE,TIME,COLUMNS};
+
+      explicit JobListModel(JobQueue *queue, QObject *parent = nullptr);
+      int idAt(int row) const { return row >= 0 && row < rows.size() ? rows[row] : 0; }
+      int rowOf(int id) const { return rows.indexOf(id); }
+      void reload();                   // after the queue changed
+      void tick();                     // the run times move along
+
+      int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+      int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+      QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+      QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+   private:
+      JobQueue *jobs;
+      QList<int> rows;      // job ids
+};
+
+class JobQueueDialog : public QDialog
+{
+   Q_OBJECT
+
+   public:
+      explicit JobQueueDialog(JobQueue *queue, QWidget *parent = nullptr);
+
+   private:
+      int currentId() const;
+      void moveJob(int by);
+      void showOutput();
+      void updateButtons();
+
+      JobQueue *jobs;
+      JobListModel *model;
+      QTableView *table;
+      QPushButton *upButton;
+      QPushButton *downButton;
+      QSpinBox *priorityBox;
+      QPushButton *cancelButton;
+      QPushButton *outputButton;
+      QTimer *clock;
+};
+
+#endif
@@ -20,12 +20,29 @@ This file is part of the USF Gravity Gui software suite.
 
 #include "gravity_gui.h"
 #include "g_prog.h"
+#include "batch_convert.h"
+#include "pipeline.h"
 
 #include <QApplication>
+#include <QCoreApplication>
 #include <QFont>
+#include <string.h>
 
 int main(int argc, char *argv[])
 {
+      // the batch modes don't need a display
+    for (int arg = 1; arg < argc; ++arg)
+       if (strcmp(argv[arg],MAKE_GDT_OPT) == 0)
+       {
+          QCoreApplication app(argc, argv);
+          return makeGdtBatch(app.arguments());
+       }
+       else if (strcmp(argv[arg],PIPELINE_OPT) == 0)
+       {
+          QCoreApplication app(argc, argv);
+          return runPipeline(app.arguments());
+       }
+
     QApplication app(argc, argv);
     GravityGui w;
     w.show();
@@ -0,0 +1,449 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//   gravity_gui --pipeline [--timeout secs] [--seed N] [--answer prog:regex=reply]...
+//               params.prm stages
+// Runs gravity programs one after the other in the directory of the
+// parameter file, with the parameters in it, e.g.
+//   gravity_gui --pipeline run1.prm "gbatch,xtrydis,gsig:1000"
+// Stages are separated by commas or "->". gsig:N makes N surrogates with
+// edt_surrogate and then runs gsig on them, surrogates:N just makes them.
+// gbatch, gsig, and the spkpat programs get run directories and their
+// results are versioned, the same as from the gui. The prompts the gui
+// answers are answered the same way here, from the same prompt table,
+// and --answer adds others. A prompt is matched within a line. A stage
+// stops if it asks something nothing answers, or prints nothing for the
+// timeout, an hour unless --timeout says otherwise. Some prompts in the
+// table have a timeout of their own, from when they are answered.
+// What the programs print goes to stderr. At the end a JSON status goes
+// to stdout. The exit code is 0 if every stage worked, 1 if one did not,
+// the ones after it are skipped, and 2 if nothing could be run, a bad
+// command line included.
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QTextStream>
+#include "pipeline.h"
+#include "gravity_params.h"
+#include "gdt_index.h"
+#include "run_dir.h"
+#include "prompt_engine.h"
+
+using namespace std;
+
+struct StageKind
+{
+   const char *name;
+   const char *program;
+   bool runDir;         // runs in a run directory
+   bool params;         // the parameters go on its stdin
+};
+
+static const StageKind stageKinds[] = {
+   {"gbatch","gbatch",true,true},
+   {"surrogates","edt_surrogate",false,false},
+   {"gsig","gsig",true,true},
+   {"xtrydis","xtrydis",false,false},
+   {"xprojtm","xprojtm",false,false},
+   {"xslope","xslope",false,false},
+   {"direct3d_bl","direct3d_bl",false,false},
+   {"direct3d_bl_mp","direct3d_bl_mp",false,false},
+   {"direct3d_bl_sig_01","direct3d_bl_sig_01",false,false},
+   {"direct3d_bl_sig_05","direct3d_bl_sig_05",false,false},
+   {"direct3d_bl_sub","direct3d_bl_sub",false,false},
+   {"spkpat6bg","spkpat6bg",true,false},
+   {"spkpat6bgr","spkpat6bgr",true,false},
+   {"spkpat6kbg","spkpat6kbg",true,false},
+   {"spkpatdist","spkpatdist",true,false},
+   {"spkpatwip","spkpatwip",true,false},
+};
+
+struct Stage
+{
+   const StageKind *kind;
+   QString text;        // as it was given
+   int count = 0;       // of surrogates, from name:count
+};
+
+struct Answer
+{
+   QString program;     // empty for all of them
+   QRegularExpression prompt;
+   QString reply;
+};
+
+struct PipelineOpts
+{
+   int timeout = PIPELINE_TIMEOUT;   // secs with no output before we give up, 0 for never
+   QString seed;
+   QList<Answer> answers;
+};
+
+static const StageKind *stageKind(const QString &name)
+{
+   for (const StageKind &kind : stageKinds)
+      if (name == kind.name)
+         return &kind;
+   return nullptr;
+}
+
+static bool parseStages(const QString &text, QList<Stage> &stages, QString &err)
+{
+   QString spec = text;
+   spec.replace("->",",").replace(QChar(0x2192),",");
+   for (QString part : spec.split(',',QString::SkipEmptyParts))
+   {
+      part = part.trimmed();
+      Stage stage;
+      stage.text = part;
+      QString name = part.section(':',0,0);
+      if (part.contains(':'))
+      {
+         bool ok;
+         stage.count = part.section(':',1).toInt(&ok);
+         if (!ok || stage.count < 1 || (name != "gsig" && name != "surrogates"))
+         {
+            QTextStream(&err) << QObject::tr("Bad stage ") << part << QObject::tr(", only gsig and surrogates take a count.") << endl;
+            return false;
+         }
+      }
+      stage.kind = stageKind(name);
+      if (!stage.kind)
+      {
+         QTextStream(&err) << QObject::tr("Unknown stage ") << part << endl;
+         return false;
+      }
+      if (name == "gsig" && stage.count)    // make its surrogates first
+      {
+         Stage make = stage;
+         make.kind = stageKind("surrogates");
+         make.text = "surrogates:" + QString::number(stage.count);
+         stages.append(make);
+      }
+      stages.append(stage);
+   }
+   if (stages.isEmpty())
+      err = QObject::tr("There are no stages to run.\n");
+   return !stages.isEmpty();
+}
+
+// prog:regex=reply
+static bool parseAnswer(const QString &text, Answer &answer, QString &err)
+{
+   int colon = text.indexOf(':');
+   int equal = text.indexOf('=',colon + 1);
+   if (colon < 0 || equal < 0)
+   {
+      QTextStream(&err) << QObject::tr("--answer needs program:regex=reply, not ") << text << endl;
+      return false;
+   }
+   answer.program = text.left(colon);
+   answer.prompt.setPattern(text.mid(colon + 1,equal - colon - 1));
+   answer.reply = text.mid(equal + 1);
+   if (!answer.prompt.isValid())
+   {
+      QTextStream(&err) << QObject::tr("Bad regular expression in --answer: ") << answer.prompt.errorString() << endl;
+      return false;
+   }
+   return true;
+}
+
+// What the gui answers without asking when its file prompt option is off.
+// The prompts it does not answer are left for --answer, with none the
+// stage stops as unanswered rather than wait for the timeout.
+static QString defaultReply(const PromptMatch &prompt, const GravityParams &params)
+{
+   switch (prompt.kind)
+   {
+      case PromptKind::ANSWER:
+         return prompt.reply;
+      case PromptKind::POS_FILE:
+         return params.pos;
+      case PromptKind::GOUT_FILE:
+         return params.gout;
+      case PromptKind::DIR_FILE:
+         return params.dir;
+      case PromptKind::OUT_FILE:
+         return "idlmov.out";
+      case PromptKind::PAT_FILE:
+         return params.base() + ".pat";
+      default:
+         return QString();
+   }
+}
+
+// Run one program to the end, answering its prompts as they come in.
+static bool runProgram(QProcess &proc, const Stage &stage, const QString &input, const GravityParams &params,
+                       const PipelineOpts &opts, QByteArray &log, QJsonObject &status)
+{
+   QTextStream errs(stderr);
+   QString program = stage.kind->program;
+   PromptEngine prompts(program);
+   for (const Answer &answer : opts.answers)
+      if (answer.program.isEmpty() || answer.program == program)
+         prompts.addAnswer(answer.prompt,answer.reply);
+
+   proc.setProcessChannelMode(QProcess::MergedChannels);
+   proc.start(program,proc.arguments());
+   if (!proc.waitForStarted(5000))
+   {
+      status["status"] = "failed";
+      status["error"] = QObject::tr("Program failed to start: ") + proc.errorString();
+      return false;
+   }
+   if (!input.isEmpty())
+      proc.write(input.toLatin1());
+
+   QEventLoop loop;
+   bool stopped = false;
+   QObject::connect(&proc,&QProcess::readyRead,[&]() {
+      QByteArray text = proc.readAll();
+      log += text;
+      errs << text << flush;
+      for (const PromptMatch &prompt : prompts.feed(QString::fromLatin1(text)))
+      {
+         if (stopped || prompt.kind == PromptKind::WINDOW_UP || prompt.kind == PromptKind::LONG_RUN)
+            continue;
+         QString reply = defaultReply(prompt,params);
+         if (!reply.isNull())
+         {
+            proc.write((reply + "\n").toLatin1());
+            prompts.answered();
+         }
+         else
+         {
+            stopped = true;
+            status["status"] = "unanswered";
+            status["error"] = QObject::tr("Nothing answers this prompt, give one with --answer.");
+            status["prompt"] = prompt.line.trimmed();
+            proc.kill();
+         }
+      }
+   });
+   QObject::connect(&prompts,&PromptEngine::timedOut,[&](const QString &pending, int ms) {
+      if (stopped)
+         return;
+      stopped = true;
+      status["status"] = "timeout";
+      status["error"] = QObject::tr("No output for %1 seconds").arg(ms / 1000);
+      status["prompt"] = pending.trimmed();
+      proc.kill();
+   });
+   QObject::connect(&proc,static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                    &loop,&QEventLoop::quit);
+   prompts.setTimeout(opts.timeout * 1000);
+   if (proc.state() != QProcess::NotRunning)
+      loop.exec();
+   proc.waitForFinished();
+   if (stopped)
+      return false;
+   status["exitCode"] = proc.exitCode();
+   if (proc.exitStatus() != QProcess::NormalExit)
+   {
+      status["status"] = "failed";
+      status["error"] = QObject::tr("The program crashed or was killed.");
+      return false;
+   }
+   if (proc.exitCode() != 0)
+   {
+      status["status"] = "failed";
+      status["error"] = QObject::tr("The program exited with code %1.").arg(proc.exitCode());
+      return false;
+   }
+   status["status"] = "done";
+   return true;
+}
+
+static bool runStage(const Stage &stage, const GravityParams &given, const PipelineOpts &opts, QJsonObject &status)
+{
+   QString program = stage.kind->program;
+   GravityParams params = given;
+   QProcess proc;
+   RunDir run;
+   QString err;
+
+   status["stage"] = stage.text;
+   status["program"] = program;
+   if (stage.count)
+      params.shift = QString::number(stage.count);
+
+   QStringList args;
+   if (program == "edt_surrogate")
+   {
+      GdtInfo info;
+      if (!loadGdtInfo(params.gdtFile,info,err,IoProgress(),true))  // no one is watching, check the index
+      {
+         status["status"] = "failed";
+         status["error"] = err;
+         return false;
+      }
+      args = surrogateArgs(params.gdtFile,params.shift,opts.seed,info.analogs);
+   }
+   proc.setArguments(args);
+
+   if (stage.kind->runDir)
+   {
+      QString session = QDir::currentPath();
+      bool ok = run.make(session,program,err) &&
+                (!QFileInfo::exists(params.gdtFile) || run.linkInput(params.gdtFile,err));
+      if (ok && program == "gbatch" && params.chans.size() > 1)
+         ok = QFileInfo::exists("offsets.gnew") ? run.linkInput("offsets.gnew",err)
+                                                : run.writeOffsets(params.chans.size(),err);
+      else if (ok && program == "gsig")
+         ok = run.linkGsigInputs(err);
+      else if (ok && program.startsWith("spkpat"))
+         ok = run.linkSpkPatInputs(err);
+      if (!ok)
+      {
+         run.remove();
+         status["status"] = "failed";
+         status["error"] = err;
+         return false;
+      }
+      proc.setWorkingDirectory(run.path());
+      status["runDir"] = QDir(session).relativeFilePath(run.path());
+   }
+   if (program.startsWith("spkpat"))
+   {
+      QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+      env.insert("newsur","1");
+      proc.setProcessEnvironment(env);
+   }
+
+   QString input = stage.kind->params ? params.text() : QString();
+   QByteArray log;
+   QElapsedTimer clock;
+   clock.start();
+   bool ok = runProgram(proc,stage,input,params,opts,log,status);
+   status["seconds"] = clock.elapsed() / 1000.0;
+   if (!run.isMade())
+      return ok;
+   if (!ok)
+      return false;     // the run directory is kept to look at
+
+   QString version;
+   QStringList files;
+   if (!input.isEmpty())
+      run.keepRecord(program + ".in",input.toLatin1());
+   run.keepRecord(program + ".log",log);
+   if (!run.promote(params.base() + "/" + program,version,files,err))
+   {
+      status["status"] = "failed";
+      status["error"] = err;
+      return false;
+   }
+   status.remove("runDir");
+   status["version"] = QDir::current().relativeFilePath(version);
+   status["files"] = QJsonArray::fromStringList(files);
+   return true;
+}
+
+int runPipeline(const QStringList &args)
+{
+   QCommandLineParser parser;
+   QTextStream out(stdout);
+   QTextStream errs(stderr);
+   QJsonObject result;
+   QString err;
+
+   parser.setApplicationDescription(QObject::tr("Run gravity programs one after another, no gui."));
+   parser.addHelpOption();
+   parser.addOption({PIPELINE_OPT+2,QObject::tr("Run a pipeline, no gui.")});
+   parser.addOption({"timeout",QObject::tr("Give up on a stage after this many seconds with no output, default is %1, 0 for none.")
+                                .arg(PIPELINE_TIMEOUT),"secs"});
+   parser.addOption({"seed",QObject::tr("Seed for edt_surrogate."),"N"});
+   parser.addOption({"answer",QObject::tr("Answer a prompt, e.g. xtrydis:\"BIN WIDTH\"=10. Can be given more than once."),
+                     "prog:regex=reply"});
+   parser.addPositionalArgument("params",QObject::tr("The parameter file."));
+   parser.addPositionalArgument("stages",QObject::tr("What to run, e.g. \"gbatch,xtrydis,gsig:1000\"."));
+   auto fail = [&](const QString &why) {
+      errs << why << flush;
+      result["ok"] = false;
+      result["error"] = why;
+      out << QJsonDocument(result).toJson() << flush;
+      return 2;
+   };
+
+     // usage errors get a status too, only --help is just text
+   if (!parser.parse(args))
+      return fail(parser.errorText() + "\n");
+   if (parser.isSet("help"))
+      parser.showHelp(0);
+   PipelineOpts opts;
+   QList<Stage> stages;
+   QStringList positional = parser.positionalArguments();
+   if (positional.size() != 2)
+      return fail(QObject::tr("Give a parameter file and the stages to run, see --help.\n"));
+   if (parser.isSet("timeout"))
+   {
+      bool ok;
+      opts.timeout = parser.value("timeout").toInt(&ok);
+      if (!ok || opts.timeout < 0)
+         return fail(QObject::tr("--timeout needs a number of seconds.\n"));
+   }
+   opts.seed = parser.value("seed");
+   for (const QString &text : parser.values("answer"))
+   {
+      Answer answer;
+      if (!parseAnswer(text,answer,err))
+         return fail(err);
+      opts.answers.append(answer);
+   }
+   if (!parseStages(positional[1],stages,err))
+      return fail(err);
+
+   QFileInfo paramInfo(positional[0]);
+   GravityParams params;
+   result["params"] = paramInfo.absoluteFilePath();
+   if (!params.load(paramInfo.filePath(),err))
+      return fail(err);
+   QDir::setCurrent(paramInfo.canonicalPath());    // the session directory
+   result["session"] = QDir::currentPath();
+
+   QJsonArray done;
+   bool ok = true;
+   for (const Stage &stage : stages)
+   {
+      QJsonObject status;
+      if (!ok)
+      {
+         status["stage"] = stage.text;
+         status["program"] = stage.kind->program;
+         status["status"] = "skipped";
+      }
+      else
+      {
+         errs << QObject::tr("=== ") << stage.text << endl;
+         ok = runStage(stage,params,opts,status);
+      }
+      done.append(status);
+   }
+   result["stages"] = done;
+   result["ok"] = ok;
+   out << QJsonDocument(result).toJson() << flush;
+   return ok ? 0 : 1;
+}
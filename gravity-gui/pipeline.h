@@ -0,0 +1,33 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Running the gravity programs one after another from the command line,
+// no gui, for unattended runs on machines with no one at them.
+
+#include <QStringList>
+
+const char PIPELINE_OPT[] = "--pipeline";
+const int PIPELINE_TIMEOUT = 3600;     // secs with no output, by default
+
+int runPipeline(const QStringList &args);
+
+#endif
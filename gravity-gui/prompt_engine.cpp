@@ -0,0 +1,150 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "prompt_engine.h"
+
+struct PromptEntry
+{
+   const char *program;    // a name, or a name prefix ending in *
+   const char *prompt;     // regular expression, matched within a line
+   PromptKind kind;
+   int delayMs;
+   bool once;
+   int timeoutMs;          // with no output once it is answered, 0 for the default, -1 for never
+};
+
+// The prompts we know about. This breaks if the prompt text changes.
+// The window prompts come when the program has put up its X window. The
+// first time, give it time to be drawn and take the focus, then we take
+// the focus back. The long run ones say the program will be busy for a
+// while, so the user can do other things. Once a file name is given the
+// program should say something soon, if it doesn't it is likely asking
+// something we don't know about. Until it is given, the user may be
+// picking the file, so only the default timeout runs. A program with its
+// window up waits on the user there, for as long as it takes.
+static const PromptEntry promptTable[] = {
+   {"xtrydis","input file",PromptKind::POS_FILE,0,false,ANSWER_WAIT_MS},
+   {"xprojtm","POSITION FILE NAME",PromptKind::GOUT_FILE,0,false,ANSWER_WAIT_MS},
+   {"xslope","input file",PromptKind::POS_FILE,0,false,ANSWER_WAIT_MS},
+   {"xslope","CHOOSE DATA",PromptKind::WINDOW_UP,WINDOW_WAIT_MS,true,-1},
+   {"xslope","Reading in control",PromptKind::LONG_RUN,0,false,0},
+   {"spkpat*","Input data file name",PromptKind::OUT_FILE,0,false,ANSWER_WAIT_MS},
+   {"spkpat*","Output data file name",PromptKind::PAT_FILE,0,false,ANSWER_WAIT_MS},
+   {"spkpat*","control cycles done",PromptKind::LONG_RUN,0,false,0},
+   {"fireworks","Enter fireworks filename",PromptKind::FWK_FILE,0,false,ANSWER_WAIT_MS},
+   {"fireworks","BDT File for analog",PromptKind::BDT_FILE,0,false,ANSWER_WAIT_MS},
+   {"fireworks","next page",PromptKind::WINDOW_UP,WINDOW_WAIT_MS,true,-1},
+   {"3djmp","Input data file",PromptKind::SPK_FILE,0,false,ANSWER_WAIT_MS},
+   {"3djmp","BDT File",PromptKind::BDT_FILE,0,false,ANSWER_WAIT_MS},
+   {"direct3d*","INPUT \\*\\.dir filename",PromptKind::DIR_FILE,0,false,ANSWER_WAIT_MS},
+};
+
+static bool forProgram(const QString &pattern, const QString &program)
+{
+   if (pattern.endsWith('*'))
+      return program.startsWith(pattern.left(pattern.length()-1));
+   return program == pattern;
+}
+
+PromptEngine::PromptEngine(const QString &program, QObject *parent) : QObject(parent)
+{
+   for (const PromptEntry &entry : promptTable)
+      if (forProgram(entry.program,program))
+         rules.append({QRegularExpression(entry.prompt),entry.kind,QString(),entry.delayMs,entry.once,entry.timeoutMs});
+   idle.setSingleShot(true);
+   connect(&idle,&QTimer::timeout,this,[=]() { emit timedOut(partial,idle.interval()); });
+}
+
+// An answer that is tried before the ones in the table, after any
+// answers added before it.
+void PromptEngine::addAnswer(const QRegularExpression &prompt, const QString &reply)
+{
+   int at = 0;
+   while (at < rules.size() && rules[at].kind == PromptKind::ANSWER)
+      ++at;
+   rules.insert(at,{prompt,PromptKind::ANSWER,reply,0,false,0});
+}
+
+// With no output for this long, timedOut is sent. 0 turns it off. A
+// prompt with a timeout of its own in the table uses that instead, from
+// when it is answered until the next output.
+void PromptEngine::setTimeout(int ms)
+{
+   defaultMs = ms;
+   arm(ms);
+}
+
+// The answer to the last prompt was sent.
+void PromptEngine::answered()
+{
+   if (answerMs > 0)
+      arm(answerMs);
+   answerMs = 0;
+}
+
+void PromptEngine::arm(int ms)
+{
+   if (ms > 0)
+   {
+      idle.setInterval(ms);
+      idle.start();
+   }
+   else
+      idle.stop();
+}
+
+// Add some output and get back the prompts in it, in the order they came.
+// Whole lines that have been looked at are dropped, what is left is the
+// start of a line that may turn out to be a prompt.
+QList<PromptMatch> PromptEngine::feed(const QString &text)
+{
+   QList<PromptMatch> found;
+   int wait = defaultMs;
+
+   answerMs = 0;
+   partial += text;
+   partial.remove('\r');
+   for (;;)
+   {
+      int first = -1;
+      QRegularExpressionMatch hit;
+      for (int rule = 0; rule < rules.size(); ++rule)
+      {
+         QRegularExpressionMatch match = rules[rule].prompt.match(partial);
+         if (match.hasMatch() && (first < 0 || match.capturedStart() < hit.capturedStart()))
+         {
+            first = rule;
+            hit = match;
+         }
+      }
+      if (first < 0)
+         break;
+      const Rule &rule = rules[first];
+      int line_start = partial.lastIndexOf('\n',hit.capturedStart()) + 1;
+      found.append({rule.kind,partial.mid(line_start,hit.capturedEnd()-line_start),rule.reply,rule.delayMs});
+      partial.remove(0,hit.capturedEnd());
+      wait = rule.timeoutMs < 0 ? -1 : defaultMs;
+      answerMs = rule.timeoutMs;
+      if (rule.once)
+         rules.removeAt(first);
+   }
+   partial.remove(0,partial.lastIndexOf('\n') + 1);
+   arm(wait);
+   return found;
+}
@@ -0,0 +1,83 @@
+#ifndef PROMPT_ENGINE_H
+#define PROMPT_ENGINE_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Finds the prompts in what a program prints. The output is put back
+// together into lines, so a prompt that comes in two reads is still seen,
+// and the prompts each program asks are in one table the gui and the
+// pipeline both use.
+
+#include <QObject>
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QTimer>
+
+const int WINDOW_WAIT_MS = 1000;   // for a program's X window to come up
+const int ANSWER_WAIT_MS = 120000; // for a program to go on after a file name
+
+// What a prompt wants, so whoever answers it knows what to do.
+enum class PromptKind {POS_FILE, GOUT_FILE, DIR_FILE, OUT_FILE, PAT_FILE, FWK_FILE, SPK_FILE, BDT_FILE,
+                       WINDOW_UP, LONG_RUN, ANSWER};
+
+struct PromptMatch
+{
+   PromptKind kind;
+   QString line;        // from the start of the line to the end of the prompt
+   QString reply;       // for an ANSWER
+   int delayMs = 0;     // wait this long before acting on it
+};
+
+class PromptEngine : public QObject
+{
+   Q_OBJECT
+
+   public:
+      explicit PromptEngine(const QString &program, QObject *parent = nullptr);
+      void addAnswer(const QRegularExpression &prompt, const QString &reply);
+      QList<PromptMatch> feed(const QString &text);
+      QString pending() const { return partial; }
+      void setTimeout(int ms);
+      void answered();
+
+   signals:
+      void timedOut(const QString &pending, int ms);   // no output for ms
+
+   private:
+      struct Rule
+      {
+         QRegularExpression prompt;
+         PromptKind kind;
+         QString reply;
+         int delayMs;
+         bool once;        // only the first time it is asked
+         int timeoutMs;    // once answered, 0 for defaultMs, -1 for never
+      };
+      void arm(int ms);
+
+      QList<Rule> rules;
+      QString partial;     // the line it is on, less any prompt in it already seen
+      QTimer idle;
+      int defaultMs = 0;
+      int answerMs = 0;    // of the last prompt, until it is answered
+};
+
+#endif
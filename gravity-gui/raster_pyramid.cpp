@@ -0,0 +1,88 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include "raster_pyramid.h"
+
+using namespace std;
+
+// As many level 0 bins per channel as the cell budget allows, within
+// limits, and one level for every halving after that.
+void RasterPyramid::reset(const vector<int> &rowChans, int startTime, int endTime)
+{
+   int64_t span = max<int64_t>(int64_t(endTime) - startTime + 1,1);
+   int64_t want = RASTER_CELLS / max<size_t>(rowChans.size(),1);
+   int64_t bins = min<int64_t>(max<int64_t>(want,RASTER_MIN_BINS),RASTER_MAX_BINS);
+
+   rowOf.fill(-1);
+   chans.clear();
+   for (int chan : rowChans)
+      if (chan >= 0 && chan < MAX_NEURON_CHANS && rowOf[chan] < 0)
+      {
+         rowOf[chan] = chans.size();
+         chans.push_back(chan);
+      }
+   start = startTime;
+   base = static_cast<int>(max<int64_t>((span + bins - 1) / bins,1));
+   bins = (span + base - 1) / base;
+   binCount.assign(1,static_cast<int>(bins));
+   levels.assign(1,vector<uint16_t>(chans.size() * bins,0));
+   peaks.clear();
+}
+
+// Add up the coarser levels from level 0, and find the peaks.
+void RasterPyramid::finish()
+{
+   levels.resize(1);
+   binCount.resize(1);
+   while (binCount.back() > 1)
+   {
+      int from_bins = binCount.back();
+      int to_bins = (from_bins + 1) / 2;
+      vector<uint16_t> next(chans.size() * size_t(to_bins));
+      const vector<uint16_t> &prev = levels.back();
+      for (size_t row = 0; row < chans.size(); ++row)
+      {
+         const uint16_t *from = &prev[row * from_bins];
+         uint16_t *to = &next[row * to_bins];
+         for (int bin = 0; bin < from_bins; ++bin)
+            to[bin/2] = static_cast<uint16_t>(min<int>(to[bin/2] + from[bin],UINT16_MAX));
+      }
+      levels.push_back(move(next));
+      binCount.push_back(to_bins);
+   }
+   peaks.assign(levels.size(),vector<uint16_t>(chans.size(),0));
+   for (size_t level = 0; level < levels.size(); ++level)
+      for (size_t row = 0; row < chans.size(); ++row)
+      {
+         const uint16_t *counts = &levels[level][row * binCount[level]];
+         peaks[level][row] = *max_element(counts,counts + binCount[level]);
+      }
+}
+
+// The finest level with bins at least a pixel wide, so drawing it never
+// drops a bin, or the top level if none are.
+int RasterPyramid::levelFor(double ticksPerPixel) const
+{
+   int level = 0;
+   while (level + 1 < levelCount() && binTicks(level) < ticksPerPixel)
+      ++level;
+   return level;
+}
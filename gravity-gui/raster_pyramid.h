@@ -0,0 +1,78 @@
+#ifndef RASTER_PYRAMID_H
+#define RASTER_PYRAMID_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Spike counts for each neuron channel in time bins, at a run of
+// resolutions, for drawing a raster of a whole .gdt file. Level 0 has the
+// narrowest bins, each level up has bins twice as wide, until one bin
+// holds the whole file. A view picks the level with one or two pixels per
+// bin, so drawing costs the same at any zoom. Counts stop at 65535.
+// No Qt in here.
+
+#include <stdint.h>
+#include <array>
+#include <vector>
+#include "chan_stats.h"
+
+const int RASTER_MIN_BINS = 1024;           // per channel at level 0
+const int RASTER_MAX_BINS = 1 << 18;
+const int64_t RASTER_CELLS = 1 << 24;       // level 0 bins for all channels
+
+class RasterPyramid
+{
+   public:
+      RasterPyramid() { rowOf.fill(-1); }
+      void reset(const std::vector<int> &chans, int startTime, int endTime);
+      void add(int chan, int time)
+      {
+         if (static_cast<unsigned>(chan) >= static_cast<unsigned>(MAX_NEURON_CHANS) || rowOf[chan] < 0)
+            return;
+         int64_t bin = (int64_t(time) - start) / base;
+         if (bin < 0 || bin >= binCount[0])
+            return;
+         uint16_t &count = levels[0][size_t(rowOf[chan]) * binCount[0] + bin];
+         if (count < UINT16_MAX)
+            ++count;
+      }
+      void finish();
+
+      int rows() const { return chans.size(); }
+      int chan(int row) const { return chans[row]; }
+      int levelCount() const { return levels.size(); }
+      int bins(int level) const { return binCount[level]; }
+      int64_t binTicks(int level) const { return int64_t(base) << level; }
+      int startTime() const { return start; }
+      int64_t endTime() const { return start + binTicks(0) * binCount[0]; }
+      const uint16_t *row(int level, int row) const { return &levels[level][size_t(row) * binCount[level]]; }
+      uint16_t peak(int level, int row) const { return peaks[level][row]; }
+      int levelFor(double ticksPerPixel) const;
+
+   private:
+      std::array<int,MAX_NEURON_CHANS> rowOf;
+      std::vector<int> chans;       // of each row, in order
+      int start = 0;
+      int base = 1;                 // ticks per bin at level 0
+      std::vector<int> binCount;    // per level
+      std::vector<std::vector<uint16_t>> levels;   // rows * bins, a row at a time
+      std::vector<std::vector<uint16_t>> peaks;    // biggest bin of each row
+};
+
+#endif
@@ -0,0 +1,539 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QApplication>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QKeyEvent>
+#include <math.h>
+#include <algorithm>
+#include "raster_view.h"
+#include "analog_io.h"
+
+using namespace std;
+
+static quint64 tileKey(int level, int col, int tileRow)
+{
+   return (quint64(level) << 56) | (quint64(col) << 24) | quint64(tileRow);
+}
+
+// One pixel per bin and row. The darker, the more spikes, on a log scale
+// against the busiest bin of the row, but never so light a single spike
+// can't be seen.
+static QImage renderTile(const RasterPyramid &raster, int level, int col, int tileRow)
+{
+   QImage image(RASTER_TILE_BINS,RASTER_TILE_ROWS,QImage::Format_ARGB32_Premultiplied);
+   int first_bin = col * RASTER_TILE_BINS;
+   int bins = min(RASTER_TILE_BINS,raster.bins(level) - first_bin);
+
+   image.fill(Qt::transparent);
+   for (int y = 0; y < RASTER_TILE_ROWS; ++y)
+   {
+      int row = tileRow * RASTER_TILE_ROWS + y;
+      if (row >= raster.rows())
+         break;
+      const uint16_t *counts = raster.row(level,row) + first_bin;
+      double scale = 1.0 / log1p(max<int>(raster.peak(level,row),1));
+      QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+      for (int bin = 0; bin < bins; ++bin)
+         if (counts[bin])
+            line[bin] = qRgba(0,0,0,min(80 + static_cast<int>(175 * log1p(counts[bin]) * scale),255));
+   }
+   return image;
+}
+
+RasterView::RasterView(QWidget *parent) : QWidget(parent), generation(0)
+{
+   buildPool.setMaxThreadCount(1);
+   setFocusPolicy(Qt::StrongFocus);
+   setMinimumSize(300,200);
+   status = tr("No .gdt file is loaded.");
+}
+
+RasterView::~RasterView()
+{
+   ++generation;
+   buildPool.waitForDone();
+   tilePool.waitForDone();
+}
+
+// Build the raster for a .gdt file, unless it is the one we have and it
+// hasn't changed. A build still going for another file is dropped.
+void RasterView::load(const QString &path, const GdtInfo &info)
+{
+   GdtStamp stamp = gdtStamp(path);
+
+   if (raster && path == shownPath && stamp == shownStamp)
+      return;
+   int gen = ++generation;
+   raster.reset();
+   analog.reset();
+   tiles.clear();
+   pending.clear();
+   shownPath = path;
+   shownStamp = stamp;
+   status = tr("Reading the spikes in %1").arg(path);
+   update();
+
+   auto built = make_shared<RasterPyramid>();
+   auto traces = make_shared<vector<AnalogTrace>>();
+   auto err = make_shared<QString>();
+   auto watch = new QFutureWatcher<bool>(this);
+   connect(watch,&QFutureWatcher<bool>::finished,this,[=]() {
+      watch->deleteLater();
+      if (gen != generation)
+         return;
+      if (watch->result())
+      {
+         raster = built;
+         analog = traces;
+         fit();
+      }
+      else
+         status = *err;
+      update();
+   });
+   watch->setFuture(QtConcurrent::run(&buildPool,[=]() {
+      IoProgress going = [this,gen](qint64,qint64) { return gen == generation; };
+      if (!rasterGdtFile(path,info,*built,*err,going))
+         return false;
+      readAnalogCache(path + ANALOG_CACHE_SUFFIX,info,*traces);    // if it is made yet
+      return true;
+   }));
+}
+
+// The .ana file for the file shown has been made, see extractAnalog().
+void RasterView::analogReady(const QString &path, const GdtInfo &info)
+{
+   if (path != shownPath)
+      return;
+   int gen = generation;
+   auto traces = make_shared<vector<AnalogTrace>>();
+   auto watch = new QFutureWatcher<bool>(this);
+   connect(watch,&QFutureWatcher<bool>::finished,this,[=]() {
+      watch->deleteLater();
+      if (gen != generation || !watch->result())
+         return;
+      analog = traces;
+      update();
+   });
+   watch->setFuture(QtConcurrent::run(&buildPool,[=]() {
+      return readAnalogCache(path + ANALOG_CACHE_SUFFIX,info,*traces);
+   }));
+}
+
+void RasterView::clear()
+{
+   ++generation;
+   raster.reset();
+   analog.reset();
+   tiles.clear();
+   pending.clear();
+   shownPath.clear();
+   shownStamp = GdtStamp();
+   status = tr("No .gdt file is loaded.");
+   update();
+}
+
+// Channel numbers down the left, seconds along the bottom, the analog
+// strips just above the seconds.
+QRect RasterView::plotRect() const
+{
+   int label_w = fontMetrics().width("88888") + 8;
+   int axis_h = fontMetrics().height() + 6;
+
+   return QRect(label_w,0,max(width() - label_w,1),max(height() - axis_h - analogRect().height(),1));
+}
+
+// Never more than half of the height, the strips get thinner instead.
+QRect RasterView::analogRect() const
+{
+   int label_w = fontMetrics().width("88888") + 8;
+   int axis_h = fontMetrics().height() + 6;
+   int traces = analog ? analog->size() : 0;
+   int strips_h = min(traces * RASTER_ANALOG_ROWS * rowHeight(),(height() - axis_h) / 2);
+
+   return QRect(label_w,height() - axis_h - strips_h,max(width() - label_w,1),strips_h);
+}
+
+int RasterView::rowHeight() const
+{
+   return max(fontMetrics().height(),8);
+}
+
+int RasterView::rowAt(int y) const
+{
+   QRect plot = plotRect();
+
+   if (!raster || y < plot.top() || y > plot.bottom())
+      return -1;
+   int row = topRow + (y - plot.top()) / rowHeight();
+   return row < raster->rows() ? row : -1;
+}
+
+void RasterView::fit()
+{
+   if (!raster)
+      return;
+   fromTime = raster->startTime();
+   ticksPerPixel = double(raster->endTime() - raster->startTime()) / plotRect().width();
+   topRow = 0;
+   limitView();
+   fitted = true;
+}
+
+// Keep the view on the file, and no closer in than 16 pixels a bin.
+void RasterView::limitView()
+{
+   if (!raster)
+      return;
+   QRect plot = plotRect();
+   double span = raster->endTime() - raster->startTime();
+   double fewest = raster->binTicks(0) / 16.0;
+   double most = max(span / plot.width(),fewest);
+   ticksPerPixel = qBound(fewest,ticksPerPixel,most);
+   double last = raster->startTime() + span - ticksPerPixel * plot.width();
+   fromTime = qBound<double>(raster->startTime(),fromTime,max<double>(last,raster->startTime()));
+   int rows_fit = plot.height() / rowHeight();
+   topRow = qBound(0,topRow,max(raster->rows() - rows_fit,0));
+}
+
+// Around the time at x.
+void RasterView::zoom(double factor, int x)
+{
+   double at = x - plotRect().left();
+   double time = fromTime + at * ticksPerPixel;
+
+   ticksPerPixel /= factor;
+   fromTime = time - at * ticksPerPixel;
+   fitted = false;
+   limitView();
+   update();
+}
+
+void RasterView::moveTime(double ticks)
+{
+   fromTime += ticks;
+   fitted = false;
+   limitView();
+   update();
+}
+
+void RasterView::scrollRows(int rows)
+{
+   topRow += rows;
+   limitView();
+   update();
+}
+
+QRectF RasterView::tileRect(const QRect &plot, int level, int col, int tileRow) const
+{
+   double tile_ticks = double(raster->binTicks(level)) * RASTER_TILE_BINS;
+   double left = plot.left() + (raster->startTime() + col * tile_ticks - fromTime) / ticksPerPixel;
+   double top = plot.top() + (tileRow * RASTER_TILE_ROWS - topRow) * rowHeight();
+
+   return QRectF(left,top,tile_ticks / ticksPerPixel,RASTER_TILE_ROWS * rowHeight());
+}
+
+void RasterView::requestTile(quint64 key)
+{
+   if (pending.contains(key))
+      return;
+   pending.insert(key);
+
+   int gen = generation;
+   int level = key >> 56;
+   int col = (key >> 24) & 0xffffffff;
+   int tile_row = key & 0xffffff;
+   shared_ptr<const RasterPyramid> from = raster;
+   auto watch = new QFutureWatcher<QImage>(this);
+   connect(watch,&QFutureWatcher<QImage>::finished,this,[=]() {
+      watch->deleteLater();
+      if (gen != generation)
+         return;
+      pending.remove(key);
+      tiles.insert(key,watch->result());
+      update();
+   });
+   watch->setFuture(QtConcurrent::run(&tilePool,[from,level,col,tile_row]() {
+      return renderTile(*from,level,col,tile_row);
+   }));
+}
+
+void RasterView::dropTiles(const QSet<quint64> &keep)
+{
+   for (auto tile = tiles.begin(); tile != tiles.end(); )
+      if (keep.contains(tile.key()))
+         ++tile;
+      else
+         tile = tiles.erase(tile);
+}
+
+void RasterView::paintEvent(QPaintEvent *)
+{
+   QPainter painter(this);
+   QRect plot = plotRect();
+
+   painter.fillRect(rect(),palette().base());
+   painter.setPen(palette().text().color());
+   if (!raster)
+   {
+      painter.drawText(rect(),Qt::AlignCenter | Qt::TextWordWrap,status);
+      return;
+   }
+
+   int row_h = rowHeight();
+   int last_row = min(raster->rows(),topRow + (plot.height() + row_h - 1) / row_h);
+   if (selection)
+   {
+      QColor picked = palette().highlight().color();
+      picked.setAlpha(60);
+      for (int row = topRow; row < last_row; ++row)
+         if (selection->has(raster->chan(row)))
+            painter.fillRect(0,plot.top() + (row - topRow) * row_h,width(),row_h,picked);
+   }
+   for (int row = topRow; row < last_row; ++row)
+      painter.drawText(QRect(0,plot.top() + (row - topRow) * row_h,plot.left() - 4,row_h),
+                       Qt::AlignRight | Qt::AlignVCenter,QString::number(raster->chan(row)));
+
+     // the tiles that cover the plot, or the half of the one above them
+     // they are in, if they are not drawn yet
+   int level = raster->levelFor(ticksPerPixel);
+   double tile_ticks = double(raster->binTicks(level)) * RASTER_TILE_BINS;
+   double from = fromTime - raster->startTime();
+   int first_col = max(0,static_cast<int>(floor(from / tile_ticks)));
+   int last_col = min((raster->bins(level) - 1) / RASTER_TILE_BINS,
+                      static_cast<int>(floor((from + ticksPerPixel * plot.width()) / tile_ticks)));
+   bool above = level + 1 < raster->levelCount();
+   QSet<quint64> keep;
+
+   painter.save();
+   painter.setClipRect(plot);
+   for (int tile_row = topRow / RASTER_TILE_ROWS; tile_row <= (last_row - 1) / RASTER_TILE_ROWS; ++tile_row)
+      for (int col = first_col; col <= last_col; ++col)
+      {
+         quint64 key = tileKey(level,col,tile_row);
+         quint64 up_key = tileKey(level+1,col/2,tile_row);
+         QRectF target = tileRect(plot,level,col,tile_row);
+         keep.insert(key);
+         if (above)
+            keep.insert(up_key);
+         auto tile = tiles.constFind(key);
+         if (tile != tiles.constEnd())
+         {
+            painter.drawImage(target,*tile);
+            continue;
+         }
+         requestTile(key);
+         auto up = above ? tiles.constFind(up_key) : tiles.constEnd();
+         if (up != tiles.constEnd())
+            painter.drawImage(target,*up,QRectF((col % 2) * RASTER_TILE_BINS / 2.0,0,RASTER_TILE_BINS / 2.0,RASTER_TILE_ROWS));
+      }
+   painter.restore();
+   if (analog && analog->size())
+   {
+      QRect strips = analogRect();
+      int strip_h = strips.height() / static_cast<int>(analog->size());
+      for (size_t trace = 0; trace < analog->size() && strip_h > 2; ++trace)
+      {
+         QRect strip(strips.left(),strips.top() + static_cast<int>(trace) * strip_h,strips.width(),strip_h);
+         painter.drawText(QRect(0,strip.top(),plot.left() - 4,strip_h),Qt::AlignRight | Qt::AlignVCenter,
+                          tr("A%1").arg((*analog)[trace].chan));
+         drawAnalog(painter,strip,(*analog)[trace]);
+      }
+      plot.setBottom(strips.bottom());
+   }
+   drawAxis(painter,plot);
+   if (tiles.size() > RASTER_MAX_TILES)
+      dropTiles(keep);
+}
+
+// Scaled to what is in view. Each pixel column is a line from the lowest
+// to the highest sample in it, stretched to meet the column before, so the
+// cost depends on the width, not on how many samples there are.
+void RasterView::drawAnalog(QPainter &painter, const QRect &strip, const AnalogTrace &trace)
+{
+   auto timeAt = [&](int x) { return fromTime + x * ticksPerPixel; };
+   float lo, hi;
+
+   trace.range(timeAt(0),timeAt(strip.width()),lo,hi);
+   if (isnan(lo))
+      return;
+   double scale = hi > lo ? (strip.height() - 3) / double(hi - lo) : 0;
+   auto yOf = [&](float value) { return strip.bottom() - 1 - static_cast<int>((value - lo) * scale); };
+   int prev_top = -1, prev_bottom = -1;
+
+   painter.save();
+   painter.setClipRect(strip);
+   painter.setPen(palette().text().color());
+   for (int x = 0; x < strip.width(); ++x)
+   {
+      float col_lo, col_hi;
+      trace.range(timeAt(x),timeAt(x+1),col_lo,col_hi);
+      if (isnan(col_lo))
+      {
+         prev_top = -1;
+         continue;
+      }
+      int top = yOf(col_hi);
+      int bottom = yOf(col_lo);
+      if (prev_top >= 0)
+      {
+         top = min(top,prev_bottom);
+         bottom = max(bottom,prev_top);
+      }
+      painter.drawLine(strip.left() + x,top,strip.left() + x,bottom);
+      prev_top = yOf(col_hi);
+      prev_bottom = yOf(col_lo);
+   }
+   painter.restore();
+}
+
+// Seconds from the start of the recording, at 1, 2, or 5 times a power
+// of ten, about 100 pixels apart.
+void RasterView::drawAxis(QPainter &painter, const QRect &plot)
+{
+   double secs_per_pixel = ticksPerPixel / TICKS_PER_SEC;
+   double want = secs_per_pixel * 100;
+   double step = pow(10.0,floor(log10(want)));
+   if (step * 5 <= want)
+      step *= 5;
+   else if (step * 2 <= want)
+      step *= 2;
+   double first = ceil(fromTime / TICKS_PER_SEC / step) * step;
+   double last = (fromTime + ticksPerPixel * plot.width()) / TICKS_PER_SEC;
+   int y = plot.bottom() + 1;
+
+   painter.drawLine(plot.left(),y,plot.right(),y);
+   for (double sec = first; sec <= last; sec += step)
+   {
+      int x = plot.left() + static_cast<int>((sec * TICKS_PER_SEC - fromTime) / ticksPerPixel);
+      painter.drawLine(x,y,x,y+3);
+      painter.drawText(QRect(x-50,y+3,100,height()-y-3),Qt::AlignHCenter | Qt::AlignTop,QString::number(sec,'g',8));
+   }
+}
+
+void RasterView::resizeEvent(QResizeEvent *event)
+{
+   QWidget::resizeEvent(event);
+   if (fitted)
+      fit();
+   else
+      limitView();
+}
+
+void RasterView::wheelEvent(QWheelEvent *event)
+{
+   QPoint delta = event->angleDelta();
+   double steps = (delta.y() ? delta.y() : delta.x()) / 120.0;
+
+   if (!raster)
+      return;
+   if (event->modifiers() & Qt::ControlModifier)
+      zoom(pow(1.25,steps),event->pos().x());
+   else if (event->modifiers() & Qt::ShiftModifier)
+      moveTime(-steps * plotRect().width() / 10 * ticksPerPixel);
+   else
+      scrollRows(static_cast<int>(-steps * 3));
+   event->accept();
+}
+
+void RasterView::mousePressEvent(QMouseEvent *event)
+{
+   if (event->button() != Qt::LeftButton)
+      return QWidget::mousePressEvent(event);
+   pressAt = event->pos();
+   pressTime = fromTime;
+   pressRow = topRow;
+   dragging = false;
+}
+
+void RasterView::mouseMoveEvent(QMouseEvent *event)
+{
+   if (!raster || !(event->buttons() & Qt::LeftButton))
+      return;
+   QPoint moved = event->pos() - pressAt;
+   if (!dragging && moved.manhattanLength() < QApplication::startDragDistance())
+      return;
+   dragging = true;
+   fromTime = pressTime - moved.x() * ticksPerPixel;
+   topRow = pressRow - moved.y() / rowHeight();
+   fitted = false;
+   limitView();
+   update();
+}
+
+// A click that wasn't a drag picks the row's channel.
+void RasterView::mouseReleaseEvent(QMouseEvent *event)
+{
+   if (event->button() != Qt::LeftButton || dragging)
+      return;
+   int row = rowAt(event->pos().y());
+   if (row >= 0)
+      emit chanClicked(raster->chan(row));
+}
+
+void RasterView::keyPressEvent(QKeyEvent *event)
+{
+   int mid = plotRect().center().x();
+   int rows_fit = max(plotRect().height() / rowHeight(),1);
+
+   if (!raster)
+      return QWidget::keyPressEvent(event);
+   switch (event->key())
+   {
+      case Qt::Key_Plus:
+      case Qt::Key_Equal:
+         zoom(2,mid);
+         break;
+      case Qt::Key_Minus:
+         zoom(0.5,mid);
+         break;
+      case Qt::Key_Left:
+         moveTime(-plotRect().width() / 4 * ticksPerPixel);
+         break;
+      case Qt::Key_Right:
+         moveTime(plotRect().width() / 4 * ticksPerPixel);
+         break;
+      case Qt::Key_Up:
+         scrollRows(-1);
+         break;
+      case Qt::Key_Down:
+         scrollRows(1);
+         break;
+      case Qt::Key_PageUp:
+         scrollRows(-rows_fit);
+         break;
+      case Qt::Key_PageDown:
+         scrollRows(rows_fit);
+         break;
+      case Qt::Key_Home:
+         fit();
+         update();
+         break;
+      default:
+         QWidget::keyPressEvent(event);
+         break;
+   }
+}
@@ -0,0 +1,117 @@
+#ifndef RASTER_VIEW_H
+#define RASTER_VIEW_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// A raster of all of the neuron channels in a .gdt file, one row per
+// channel, drawn from a RasterPyramid so it pans and zooms the same with
+// a thousand spikes or a hundred million. The pyramid is built on a
+// thread of its own. The plot is cut into tiles of bins and rows, each
+// drawn into an image on the thread pool and kept, so a repaint is only
+// a few image copies. A tile that isn't ready yet is filled in from the
+// level above until it is. The analog channels, from the .ana file, are
+// drawn in strips under the rows on the same time scale, from their
+// min/max pyramids. Clicking a row sends chanClicked().
+//   wheel             scroll the rows
+//   ctrl+wheel, +, -  zoom in time around the mouse
+//   shift+wheel       move in time
+//   drag              move in time and rows
+//   Home              the whole file
+
+#include <QWidget>
+#include <QHash>
+#include <QSet>
+#include <QImage>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+#include "gdt_cache.h"
+#include "chan_select.h"
+#include "analog_trace.h"
+
+const int RASTER_TILE_BINS = 256;
+const int RASTER_TILE_ROWS = 32;
+const int RASTER_MAX_TILES = 1024;   // kept images, about 32 MB
+const int RASTER_ANALOG_ROWS = 3;    // rows high for each analog strip
+
+class RasterView : public QWidget
+{
+   Q_OBJECT
+
+   public:
+      explicit RasterView(QWidget *parent = nullptr);
+      ~RasterView();
+      void load(const QString &path, const GdtInfo &info);
+      void analogReady(const QString &path, const GdtInfo &info);
+      void clear();
+      void setSelection(const ChanSelection *chans) { selection = chans; update(); }
+
+   signals:
+      void chanClicked(int chan);
+
+   protected:
+      void paintEvent(QPaintEvent *event) override;
+      void resizeEvent(QResizeEvent *event) override;
+      void wheelEvent(QWheelEvent *event) override;
+      void mousePressEvent(QMouseEvent *event) override;
+      void mouseMoveEvent(QMouseEvent *event) override;
+      void mouseReleaseEvent(QMouseEvent *event) override;
+      void keyPressEvent(QKeyEvent *event) override;
+
+   private:
+      QRect plotRect() const;
+      QRect analogRect() const;
+      int rowHeight() const;
+      int rowAt(int y) const;       // -1 if no row there
+      void fit();
+      void zoom(double factor, int x);
+      void moveTime(double ticks);
+      void scrollRows(int rows);
+      void limitView();
+      QRectF tileRect(const QRect &plot, int level, int col, int tileRow) const;
+      void requestTile(quint64 key);
+      void dropTiles(const QSet<quint64> &keep);
+      void drawAxis(QPainter &painter, const QRect &plot);
+      void drawAnalog(QPainter &painter, const QRect &strip, const AnalogTrace &trace);
+
+      std::shared_ptr<const RasterPyramid> raster;
+      std::shared_ptr<const std::vector<AnalogTrace>> analog;
+      const ChanSelection *selection = nullptr;
+      QString status;               // shown when there is no raster
+      QString shownPath;
+      GdtStamp shownStamp;
+      double fromTime = 0;          // ticks at the left edge of the plot
+      double ticksPerPixel = 1;
+      int topRow = 0;
+      bool fitted = true;           // whole file shown, keep it that way on a resize
+
+      QHash<quint64,QImage> tiles;
+      QSet<quint64> pending;
+      std::atomic<int> generation;  // bumped to drop old builds and tiles
+      QThreadPool buildPool;
+      QThreadPool tilePool;
+
+      QPoint pressAt;
+      double pressTime = 0;
+      int pressRow = 0;
+      bool dragging = false;
+};
+
+#endif
@@ -0,0 +1,276 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Run directories and the versioned results tree, see run_dir.h.
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QObject>
+#include <QSet>
+#include <QPair>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "run_dir.h"
+
+// A hard link if we can, it does not care if the source is moved or
+// replaced later. Across file systems it has to be a symbolic link.
+static bool linkFile(const QString &from, const QString &to, QString &why)
+{
+   QByteArray src = QFile::encodeName(from);
+   QByteArray dst = QFile::encodeName(to);
+
+   if (linkat(AT_FDCWD,src.constData(),AT_FDCWD,dst.constData(),AT_SYMLINK_FOLLOW) == 0)
+      return true;
+   if (errno != EXDEV && errno != EPERM)
+   {
+      why = strerror(errno);
+      return false;
+   }
+   if (symlink(QFile::encodeName(QFileInfo(from).canonicalFilePath()).constData(),dst.constData()) == 0)
+      return true;
+   why = strerror(errno);
+   return false;
+}
+
+// Put a link to from at to, in one step, even if to exists.
+static bool replaceWithLink(const QString &from, const QString &to, QString &why)
+{
+   QString temp = QFileInfo(to).absolutePath() + "/." + QFileInfo(to).fileName() + ".new";
+   QFile::remove(temp);
+   if (!linkFile(from,temp,why))
+      return false;
+   if (rename(QFile::encodeName(temp).constData(),QFile::encodeName(to).constData()) == 0)
+      return true;
+   why = strerror(errno);
+   QFile::remove(temp);
+   return false;
+}
+
+// The files in the results tree, by device and inode.
+static QSet<QPair<quint64,quint64>> resultFiles(const QString &results)
+{
+   QSet<QPair<quint64,quint64>> found;
+   QDirIterator iter(results,QDir::Files | QDir::Hidden,QDirIterator::Subdirectories);
+   while (iter.hasNext())
+   {
+      struct stat info;
+      if (lstat(QFile::encodeName(iter.next()).constData(),&info) == 0 && S_ISREG(info.st_mode))
+         found.insert(qMakePair(quint64(info.st_dev),quint64(info.st_ino)));
+   }
+   return found;
+}
+
+// A session file that is not one of the files in a version. Links we make
+// back to a version are hard links, the same file, or symbolic links.
+static bool unversioned(const QString &fName, const QSet<QPair<quint64,quint64>> &versioned)
+{
+   struct stat info;
+   return lstat(QFile::encodeName(fName).constData(),&info) == 0 && S_ISREG(info.st_mode) &&
+          !versioned.contains(qMakePair(quint64(info.st_dev),quint64(info.st_ino)));
+}
+
+bool RunDir::make(const QString &session, const QString &program, QString &err)
+{
+   QDir dir(session);
+   if (!dir.mkpath(RUNS_DIR))
+   {
+      QTextStream(&err) << QObject::tr("Could not make the directory ") << dir.filePath(RUNS_DIR) << endl;
+      return false;
+   }
+   QTemporaryDir run(dir.absoluteFilePath(QString(RUNS_DIR) + "/" + program + "-XXXXXX"));
+   if (!run.isValid())
+   {
+      QTextStream(&err) << QObject::tr("Could not make a run directory in ") << dir.filePath(RUNS_DIR) << endl;
+      return false;
+   }
+   run.setAutoRemove(false);
+   sessionPath = dir.absolutePath();
+   runPath = run.path();
+   inputs.clear();
+   records.clear();
+   return true;
+}
+
+bool RunDir::linkInput(const QString &name, QString &err)
+{
+   QString why;
+   if (!linkFile(sessionPath + "/" + name,runPath + "/" + name,why))
+   {
+      QTextStream(&err) << QObject::tr("Could not link ") << name << QObject::tr(" into ") << runPath << endl
+                        << QObject::tr("Error is:               ") << why << endl;
+      return false;
+   }
+   inputs.append(name);
+   return true;
+}
+
+// The session files matching the patterns, less any matching skip.
+// Returns how many, or -1.
+int RunDir::linkInputs(const QStringList &patterns, const QStringList &skip, QString &err)
+{
+   QDir session(sessionPath);
+   QStringList names = session.entryList(patterns,QDir::Files);
+   int count = 0;
+   for (const QString &name : names)
+   {
+      if (QDir::match(skip,name) || inputs.contains(name))
+         continue;
+      if (!linkInput(name,err))
+         return -1;
+      ++count;
+   }
+   return count;
+}
+
+// Made for the run, so it is not an input. It goes to the results with
+// what the run makes, and the session gets a link to it.
+bool RunDir::writeFile(const QString &name, const QByteArray &data, QString &err)
+{
+   QFile file(runPath + "/" + name);
+   if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size())
+   {
+      QTextStream(&err) << QObject::tr("Error writing file ") << file.fileName() << endl
+                        << QObject::tr("Error is:               ") << file.errorString() << endl;
+      return false;
+   }
+   return true;
+}
+
+// An offsets.gnew with no offset for each pair of chans channels, for
+// gbatch. The gui and the pipeline both make it this way.
+bool RunDir::writeOffsets(int chans, QString &err)
+{
+   QByteArray offsets;
+   QTextStream text(&offsets);
+   for (int pair1 = 2; pair1 <= chans; ++pair1)
+      for (int pair2 = 1; pair2 < pair1; ++pair2)
+         text << pair1 << ", " << pair2 << ", " << "0" << endl;
+   text.flush();
+   return writeFile("offsets.gnew",offsets,err);
+}
+
+// The offsets gbatch used, if there are any, and the surrogates, less
+// what gsig made from them last time.
+bool RunDir::linkGsigInputs(QString &err)
+{
+   return (!QFileInfo::exists(sessionPath + "/offsets.gnew") || linkInput("offsets.gnew",err)) &&
+          linkInputs({"sh*"},{"sh*.gout","sh*.pos","sh*.dir"},err) >= 0;
+}
+
+// The spike pattern programs read the .out files.
+bool RunDir::linkSpkPatInputs(QString &err)
+{
+   return linkInputs({"*.out"},{},err) >= 0;
+}
+
+// The next v<N> under dir. mkdir fails if it is there, so two runs
+// finishing together can't get the same one.
+bool RunDir::newVersion(const QString &dir, QString &version, QString &err)
+{
+   QDir results(dir);
+   int next = 1;
+   for (const QString &name : results.entryList(QStringList("v*"),QDir::Dirs | QDir::NoDotAndDotDot))
+      next = qMax(next,name.mid(1).toInt() + 1);
+   for (int tries = 0; tries < 1000; ++tries, ++next)
+   {
+      version = dir + "/v" + QString::number(next);
+      if (results.mkdir(version))
+         return true;
+   }
+   QTextStream(&err) << QObject::tr("Could not make a version directory in ") << dir << endl;
+   return false;
+}
+
+// Move what the run made to a new version of result, a path under
+// results/, and link the session directory to it. The run directory is
+// removed if it all worked, else it is left for a look.
+bool RunDir::promote(const QString &result, QString &version, QStringList &files, QString &err)
+{
+   QDir run(runPath);
+   QString dir = sessionPath + "/" + RESULTS_DIR + "/" + result;
+
+   files.clear();
+   for (const QString &name : run.entryList(QDir::Files | QDir::Hidden))
+      if (!inputs.contains(name))
+         files.append(name);
+   if (!QDir().mkpath(dir))
+   {
+      QTextStream(&err) << QObject::tr("Could not make the directory ") << dir << endl;
+      return false;
+   }
+
+   QStringList older;
+   QSet<QPair<quint64,quint64>> versioned = resultFiles(sessionPath + "/" + RESULTS_DIR);
+   for (const QString &name : files)
+      if (unversioned(sessionPath + "/" + name,versioned))
+         older.append(name);
+   if (!older.isEmpty())
+   {
+      QString keep;
+      if (!newVersion(dir,keep,err))
+         return false;
+      for (const QString &name : older)
+         if (!QFile::rename(sessionPath + "/" + name,keep + "/" + name))
+         {
+            QTextStream(&err) << QObject::tr("Could not move ") << name << QObject::tr(" to ") << keep << endl;
+            return false;
+         }
+   }
+
+   if (!newVersion(dir,version,err))
+      return false;
+   QString why;
+   for (const QString &name : files)
+   {
+      if (!QFile::rename(runPath + "/" + name,version + "/" + name))
+      {
+         QTextStream(&err) << QObject::tr("Could not move ") << name << QObject::tr(" to ") << version << endl;
+         return false;
+      }
+      if (!replaceWithLink(version + "/" + name,sessionPath + "/" + name,why))
+      {
+         QTextStream(&err) << QObject::tr("Could not link ") << name << QObject::tr(" into ") << sessionPath << endl
+                           << QObject::tr("Error is:               ") << why << endl;
+         return false;
+      }
+   }
+   for (auto iter = records.constBegin(); iter != records.constEnd(); ++iter)
+   {
+      QFile file(version + "/" + iter.key());
+      if (file.open(QIODevice::WriteOnly))
+         file.write(iter.value());
+   }
+   remove();
+   return true;
+}
+
+void RunDir::remove()
+{
+   if (!runPath.isEmpty())
+      QDir(runPath).removeRecursively();
+   runPath.clear();
+}
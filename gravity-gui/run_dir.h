@@ -0,0 +1,67 @@
+#ifndef RUN_DIR_H
+#define RUN_DIR_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// A directory of its own for one run of gbatch, gsig, or a spkpat
+// program. These crash if their output files already exist, and two of
+// them in the session directory at once would write over each other. So
+// each runs in runs/<program>-XXXXXX, with links to the files it reads.
+// When it is done, the files it made are moved to
+//    results/<base>/<program>/v<N>
+// and the session directory gets links to them, where the programs that
+// read them look. A file there that is in no version yet, say from before
+// there were run directories, is moved into a version of its own first,
+// so no result is ever lost.
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QMap>
+
+const char RUNS_DIR[] = "runs";
+const char RESULTS_DIR[] = "results";
+
+class RunDir
+{
+   public:
+      bool make(const QString &session, const QString &program, QString &err);
+      bool linkInput(const QString &name, QString &err);     // a file in the session directory
+      int linkInputs(const QStringList &patterns, const QStringList &skip, QString &err);
+      bool writeFile(const QString &name, const QByteArray &data, QString &err);   // promoted with the output
+      bool writeOffsets(int chans, QString &err);      // a default offsets.gnew
+      bool linkGsigInputs(QString &err);
+      bool linkSpkPatInputs(QString &err);
+      void keepRecord(const QString &name, const QByteArray &data) { records[name] = data; }
+      bool promote(const QString &result, QString &version, QStringList &files, QString &err);
+      void remove();
+      QString path() const { return runPath; }
+      bool isMade() const { return !runPath.isEmpty(); }
+
+   private:
+      bool newVersion(const QString &dir, QString &version, QString &err);
+
+      QString sessionPath;
+      QString runPath;
+      QStringList inputs;                  // names linked in, not output
+      QMap<QString,QByteArray> records;    // go in the version, not the session
+};
+
+#endif
@@ -0,0 +1,367 @@
+#ifndef SPIKE_DECODE_H
+#define SPIKE_DECODE_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Decoder for the fixed width spike records. Every record is a channel
+// and a time, right justified in columns:
+//    .adt  I2 I8
+//    .bdt  I5 I8  (and .gdt)
+//    .edt  I5 I10
+// The widths are template parameters, so each format gets its own decoder
+// with the column positions built in. Lines that are exactly the record
+// width are decoded 16 bytes at a time with SSE4.1, or two records at a time
+// with AVX2 if the cpu has it. Anything else (short lines, signs, extra
+// columns) goes through the scalar code, which follows QString::toInt().
+//
+// This is plain C++, no Qt, so the microbenchmark can use it as is.
+
+#include <string.h>
+#include <limits.h>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SPIKE_DECODE_X86 1
+#endif
+
+// Bytes past the end of the data the SIMD code may read. Buffers that are
+// handed to forEachRecord with limit == end must have this much slack.
+const int DECODE_PAD = 32;
+
+template <int ChanW, int TimeW>
+struct RecordFormat
+{
+   static_assert(ChanW > 0 && ChanW <= 8 && TimeW > 0 && TimeW <= 16, "unsupported record widths");
+   enum { CHAN_W = ChanW, TIME_W = TimeW, REC_W = ChanW + TimeW };
+};
+
+using AdtFormat = RecordFormat<2,8>;
+using BdtFormat = RecordFormat<5,8>;
+using EdtFormat = RecordFormat<5,10>;
+
+static inline bool decodeIsWs(char c)
+{
+   return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+// Same rules as QString::toInt(), leading and trailing white space is
+// ignored, anything else that is not a number returns 0.
+inline int fieldToInt(const char *field, int len)
+{
+   const char *p = field;
+   const char *end = field + len;
+   bool neg = false;
+   long long val = 0;
+
+   while (p < end && decodeIsWs(*p))
+      ++p;
+   while (end > p && decodeIsWs(*(end-1)))
+      --end;
+   if (p < end && (*p == '-' || *p == '+'))
+      neg = *p++ == '-';
+   if (p == end)
+      return 0;
+   for ( ; p < end; ++p)
+   {
+      if (*p < '0' || *p > '9')
+         return 0;
+      val = val * 10 + (*p - '0');
+      if (val > (long long)INT_MAX + 1)
+         return 0;
+   }
+   if (neg)
+      val = -val;
+   if (val > INT_MAX || val < INT_MIN)
+      return 0;
+   return static_cast<int>(val);
+}
+
+// The channel is the first chan_len chars of a record, the time is the rest.
+inline int recChan(const char *line, int len, int chan_len)
+{
+   return fieldToInt(line, len < chan_len ? len : chan_len);
+}
+
+inline int recTime(const char *line, int len, int chan_len)
+{
+   return len > chan_len ? fieldToInt(line+chan_len,len-chan_len) : 0;
+}
+
+// Scalar decode of any one line.
+template <class Fmt>
+inline void decodeScalar(const char *line, int len, int &chan, int &time)
+{
+   chan = recChan(line,len,Fmt::CHAN_W);
+   time = recTime(line,len,Fmt::CHAN_W);
+}
+
+#ifdef SPIKE_DECODE_X86
+
+// Shuffle that lines the fields up for the digit math: the channel right
+// justified in bytes 0-7, the low 8 digits of the time right justified in
+// bytes 8-15. 0x80 zeroes the byte.
+template <class Fmt>
+struct DecodeTables
+{
+   char shuffle[16];
+   char weights10[16];
+   short weights100[8];
+   short weights10000[8];
+
+   DecodeTables()
+   {
+      int timeLow = Fmt::TIME_W < 8 ? Fmt::TIME_W : 8;
+      int timeSkip = Fmt::TIME_W - timeLow;   // high time digits done by hand
+      for (int j = 0; j < 8; ++j)
+      {
+         shuffle[j] = j >= 8 - Fmt::CHAN_W ? j - (8 - Fmt::CHAN_W) : 0x80;
+         shuffle[j+8] = j >= 8 - timeLow ? Fmt::CHAN_W + timeSkip + j - (8 - timeLow) : 0x80;
+      }
+      for (int j = 0; j < 16; ++j)
+         weights10[j] = j % 2 ? 1 : 10;
+      for (int j = 0; j < 8; ++j)
+      {
+         weights100[j] = j % 2 ? 1 : 100;
+         weights10000[j] = j % 2 ? 1 : 10000;
+      }
+   }
+};
+
+template <class Fmt>
+inline const DecodeTables<Fmt> &decodeTables()
+{
+   static const DecodeTables<Fmt> tables;
+   return tables;
+}
+
+// A field's spaces have to be leading spaces, "1 2" is not a number.
+inline bool spacesLead(unsigned spaces, int start, int width)
+{
+   unsigned f = (spaces >> start) & ((1u << width) - 1);
+   return (f & (f + 1)) == 0;
+}
+
+template <class Fmt>
+inline bool fieldsOk(unsigned good, unsigned spaces)
+{
+   const unsigned recMask = (1u << Fmt::REC_W) - 1;
+   return (good & recMask) == recMask &&
+          spacesLead(spaces,0,Fmt::CHAN_W) &&
+          spacesLead(spaces,Fmt::CHAN_W,Fmt::TIME_W);
+}
+
+// Digits above the low 8 of a wide time field.
+template <class Fmt>
+inline bool addHighDigits(const char *line, int low, int &time)
+{
+   long long val = 0;
+   for (int d = 0; d < Fmt::TIME_W - 8; ++d)
+   {
+      char c = line[Fmt::CHAN_W + d];
+      val = val * 10 + (c == ' ' ? 0 : c - '0');
+   }
+   for (int d = 0; d < 8; ++d)
+      val *= 10;
+   val += low;
+   if (val > INT_MAX)
+      return false;
+   time = static_cast<int>(val);
+   return true;
+}
+
+// One record in the low 16 bytes. line must have 16 readable bytes.
+template <class Fmt>
+__attribute__((target("sse4.1")))
+inline bool decodeSse(const char *line, int &chan, int &time)
+{
+   const DecodeTables<Fmt> &tab = decodeTables<Fmt>();
+   __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(line));
+   __m128i dig = _mm_sub_epi8(raw,_mm_set1_epi8('0'));
+   __m128i isDig = _mm_cmpeq_epi8(_mm_min_epu8(dig,_mm_set1_epi8(9)),dig);
+   __m128i isSpace = _mm_cmpeq_epi8(raw,_mm_set1_epi8(' '));
+   unsigned good = _mm_movemask_epi8(_mm_or_si128(isDig,isSpace));
+   unsigned spaces = _mm_movemask_epi8(isSpace);
+   if (!fieldsOk<Fmt>(good,spaces))
+      return false;
+   dig = _mm_and_si128(dig,isDig);
+   dig = _mm_shuffle_epi8(dig,_mm_loadu_si128(reinterpret_cast<const __m128i *>(tab.shuffle)));
+   __m128i v = _mm_maddubs_epi16(dig,_mm_loadu_si128(reinterpret_cast<const __m128i *>(tab.weights10)));
+   v = _mm_madd_epi16(v,_mm_loadu_si128(reinterpret_cast<const __m128i *>(tab.weights100)));
+   v = _mm_packus_epi32(v,v);
+   v = _mm_madd_epi16(v,_mm_loadu_si128(reinterpret_cast<const __m128i *>(tab.weights10000)));
+   chan = _mm_cvtsi128_si32(v);
+   time = _mm_extract_epi32(v,1);
+   if (Fmt::TIME_W > 8)
+      return addHighDigits<Fmt>(line,time,time);
+   return true;
+}
+
+// Two records back to back, second one starts at line + REC_W + 1.
+// Needs 16 readable bytes after the start of the second one.
+template <class Fmt>
+__attribute__((target("avx2")))
+inline bool decodeAvx2(const char *line, int *chans, int *times)
+{
+   const DecodeTables<Fmt> &tab = decodeTables<Fmt>();
+   const char *line2 = line + Fmt::REC_W + 1;
+   __m256i raw = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(line))),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(line2)),1);
+   __m256i dig = _mm256_sub_epi8(raw,_mm256_set1_epi8('0'));
+   __m256i isDig = _mm256_cmpeq_epi8(_mm256_min_epu8(dig,_mm256_set1_epi8(9)),dig);
+   __m256i isSpace = _mm256_cmpeq_epi8(raw,_mm256_set1_epi8(' '));
+   unsigned good = _mm256_movemask_epi8(_mm256_or_si256(isDig,isSpace));
+   unsigned spaces = _mm256_movemask_epi8(isSpace);
+   if (!fieldsOk<Fmt>(good,spaces) || !fieldsOk<Fmt>(good >> 16,spaces >> 16))
+      return false;
+   dig = _mm256_and_si256(dig,isDig);
+   dig = _mm256_shuffle_epi8(dig,_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(tab.shuffle))));
+   __m256i v = _mm256_maddubs_epi16(dig,_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(tab.weights10))));
+   v = _mm256_madd_epi16(v,_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(tab.weights100))));
+   v = _mm256_packus_epi32(v,v);
+   v = _mm256_madd_epi16(v,_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(tab.weights10000))));
+   chans[0] = _mm256_extract_epi32(v,0);
+   times[0] = _mm256_extract_epi32(v,1);
+   chans[1] = _mm256_extract_epi32(v,4);
+   times[1] = _mm256_extract_epi32(v,5);
+   if (Fmt::TIME_W > 8)
+      return addHighDigits<Fmt>(line,times[0],times[0]) && addHighDigits<Fmt>(line2,times[1],times[1]);
+   return true;
+}
+
+#endif
+
+// Which decoder the cpu can run, checked once.
+enum DecodeLevel {DECODE_SCALAR, DECODE_SSE41, DECODE_AVX2};
+
+inline DecodeLevel decodeLevel()
+{
+#ifdef SPIKE_DECODE_X86
+   static const DecodeLevel level = __builtin_cpu_supports("avx2") ? DECODE_AVX2 :
+                                    __builtin_cpu_supports("sse4.1") ? DECODE_SSE41 : DECODE_SCALAR;
+   return level;
+#else
+   return DECODE_SCALAR;
+#endif
+}
+
+// Is this line exactly one record, give or take a \r?
+template <class Fmt>
+inline bool exactRecord(const char *line, int len)
+{
+   return len == Fmt::REC_W || (len == Fmt::REC_W + 1 && line[Fmt::REC_W] == '\r');
+}
+
+// The loop body shared by each decoder level. fn(line,len,chan,time) is
+// called for every line in [begin,end), blank ones too, and returns false
+// to stop early. Returns where it stopped. Everything up to limit can be
+// read, which has to be at least end.
+template <class Fmt, DecodeLevel Level, class Fn>
+__attribute__((always_inline))
+inline const char *recordLoop(const char *begin, const char *end, const char *limit, Fn &fn)
+{
+   const char *line = begin;
+   int chan, time;
+
+   while (line < end)
+   {
+      const char *nl;
+#ifdef SPIKE_DECODE_X86
+      if (Level == DECODE_AVX2 && line + 2*(Fmt::REC_W+1) + 16 <= limit &&
+          line[Fmt::REC_W] == '\n' && line[2*Fmt::REC_W+1] == '\n' && line + 2*(Fmt::REC_W+1) <= end)
+      {
+         int chans[2], times[2];
+         if (decodeAvx2<Fmt>(line,chans,times))
+         {
+            if (!fn(line,Fmt::REC_W,chans[0],times[0]))
+               return line + Fmt::REC_W + 1;
+            line += Fmt::REC_W + 1;
+            if (!fn(line,Fmt::REC_W,chans[1],times[1]))
+               return line + Fmt::REC_W + 1;
+            line += Fmt::REC_W + 1;
+            continue;
+         }
+      }
+#endif
+      nl = static_cast<const char *>(memchr(line,'\n',end-line));
+      if (!nl)
+         nl = end;
+      int len = nl - line;
+#ifdef SPIKE_DECODE_X86
+      if (Level != DECODE_SCALAR && line + 16 <= limit && exactRecord<Fmt>(line,len) &&
+          decodeSse<Fmt>(line,chan,time))
+         ;
+      else
+#endif
+         decodeScalar<Fmt>(line,len,chan,time);
+      if (!fn(line,len,chan,time))
+         return nl < end ? nl + 1 : end;
+      line = nl + 1;
+   }
+   return end;
+}
+
+#ifdef SPIKE_DECODE_X86
+template <class Fmt, class Fn>
+__attribute__((target("avx2")))
+const char *recordLoopAvx2(const char *begin, const char *end, const char *limit, Fn &fn)
+{
+   return recordLoop<Fmt,DECODE_AVX2>(begin,end,limit,fn);
+}
+
+template <class Fmt, class Fn>
+__attribute__((target("sse4.1")))
+const char *recordLoopSse41(const char *begin, const char *end, const char *limit, Fn &fn)
+{
+   return recordLoop<Fmt,DECODE_SSE41>(begin,end,limit,fn);
+}
+#endif
+
+template <class Fmt, class Fn>
+inline const char *forEachRecord(const char *begin, const char *end, const char *limit, Fn fn, DecodeLevel level = decodeLevel())
+{
+#ifdef SPIKE_DECODE_X86
+   if (level == DECODE_AVX2)
+      return recordLoopAvx2<Fmt>(begin,end,limit,fn);
+   if (level == DECODE_SSE41)
+      return recordLoopSse41<Fmt>(begin,end,limit,fn);
+#endif
+   return recordLoop<Fmt,DECODE_SCALAR>(begin,end,limit,fn);
+}
+
+// Decode a block of records into parallel channel and time arrays.
+// Blank lines are skipped. Returns the number of records added.
+template <class Fmt>
+size_t decodeRecords(const char *begin, const char *end, const char *limit,
+                     std::vector<int> &chans, std::vector<int> &times, DecodeLevel level = decodeLevel())
+{
+   size_t before = chans.size();
+   forEachRecord<Fmt>(begin,end,limit,[&](const char *, int len, int chan, int time) {
+      if (len)
+      {
+         chans.push_back(chan);
+         times.push_back(time);
+      }
+      return true;
+   },level);
+   return chans.size() - before;
+}
+
+#endif
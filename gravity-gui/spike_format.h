@@ -0,0 +1,68 @@
+#ifndef SPIKE_FORMAT_H
+#define SPIKE_FORMAT_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Writes spike records, the other way from spike_decode.h. The numbers
+// are put right into the caller's buffer, there is no string or stream in
+// between. The output is the same as QString::arg() with a field width:
+// right justified, space filled, and a number too wide for its field is
+// written whole. No Qt in here.
+
+#include <string.h>
+
+const int MAX_FIELD_TEXT = 11;     // -2147483648
+const int MAX_RECORD_TEXT = 2 * MAX_FIELD_TEXT + 1;  // for fields up to 11 wide
+
+// Returns the end of what was written.
+inline char *formatField(char *out, int val, int width)
+{
+   char digits[MAX_FIELD_TEXT];
+   char *end = digits + sizeof(digits);
+   char *pos = end;
+   unsigned int mag = val < 0 ? 0u - static_cast<unsigned int>(val) : val;
+
+   do
+   {
+      *--pos = '0' + mag % 10;
+      mag /= 10;
+   } while (mag);
+   if (val < 0)
+      *--pos = '-';
+   int len = end - pos;
+   if (len < width)
+   {
+      memset(out,' ',width-len);
+      out += width - len;
+   }
+   memcpy(out,pos,len);
+   return out + len;
+}
+
+// Channel, time, and the newline.
+inline char *formatRecord(char *out, int chan, int chanW, int time, int timeW)
+{
+   out = formatField(out,chan,chanW);
+   out = formatField(out,time,timeW);
+   *out++ = '\n';
+   return out;
+}
+
+#endif
@@ -0,0 +1,231 @@
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <limits.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include <QTextStream>
+#include "spike_input.h"
+#include "gdt_io.h"
+
+using namespace std;
+
+Compression compressionOf(const QString &fName)
+{
+   if (fName.endsWith(".gz"))
+      return Compression::GZIP;
+   if (fName.endsWith(".zst"))
+      return Compression::ZSTD;
+   return Compression::NONE;
+}
+
+// name.bdt.gz -> name.bdt
+QString uncompressedName(const QString &fName)
+{
+   switch (compressionOf(fName))
+   {
+      case Compression::GZIP:
+         return fName.left(fName.length()-3);
+      case Compression::ZSTD:
+         return fName.left(fName.length()-4);
+      default:
+         return fName;
+   }
+}
+
+
+InflateDevice::InflateDevice(QIODevice *src, Compression how) : source(src), kind(how)
+{
+   inBuf.resize(IO_BLOCK);
+}
+
+InflateDevice::~InflateDevice()
+{
+   endStream();
+}
+
+void InflateDevice::endStream()
+{
+   if (!stream)
+      return;
+   if (kind == Compression::GZIP)
+   {
+      inflateEnd(static_cast<z_stream *>(stream));
+      delete static_cast<z_stream *>(stream);
+   }
+#ifdef HAVE_ZSTD
+   else
+      ZSTD_freeDStream(static_cast<ZSTD_DStream *>(stream));
+#endif
+   stream = nullptr;
+}
+
+bool InflateDevice::open(OpenMode mode)
+{
+   if (mode & WriteOnly)
+   {
+      setErrorString(tr("Compressed files are read only."));
+      return false;
+   }
+   endStream();
+   if (kind == Compression::GZIP)
+   {
+      z_stream *zs = new z_stream();
+      if (inflateInit2(zs,15+32) != Z_OK)   // +32 for a gzip or zlib header
+      {
+         delete zs;
+         setErrorString(tr("Can't start gzip."));
+         return false;
+      }
+      stream = zs;
+   }
+   else
+   {
+#ifdef HAVE_ZSTD
+      stream = ZSTD_createDStream();
+      if (!stream || ZSTD_isError(ZSTD_initDStream(static_cast<ZSTD_DStream *>(stream))))
+      {
+         setErrorString(tr("Can't start zstd."));
+         return false;
+      }
+#else
+      setErrorString(tr("This program was built without zstd, it can't read .zst files."));
+      return false;
+#endif
+   }
+   inPos = nullptr;
+   inLeft = 0;
+   srcEof = midStream = finished = false;
+   return QIODevice::open(mode | Unbuffered);
+}
+
+void InflateDevice::close()
+{
+   endStream();
+   QIODevice::close();
+}
+
+// Uncompress what we can from the input we have. Returns the bytes made.
+qint64 InflateDevice::step(char *data, qint64 maxSize)
+{
+   qint64 out_len = qMin<qint64>(maxSize,UINT_MAX);
+   qint64 used, made;
+
+   if (kind == Compression::GZIP)
+   {
+      z_stream *zs = static_cast<z_stream *>(stream);
+      zs->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(inPos));
+      zs->avail_in = inLeft;
+      zs->next_out = reinterpret_cast<Bytef *>(data);
+      zs->avail_out = out_len;
+      int ret = inflate(zs,Z_NO_FLUSH);
+      used = inLeft - zs->avail_in;
+      made = out_len - zs->avail_out;
+      if (ret == Z_STREAM_END)      // there may be another member after this
+      {
+         inflateReset(zs);
+         midStream = false;
+      }
+      else if (ret != Z_OK && ret != Z_BUF_ERROR)
+      {
+         setErrorString(tr("Bad gzip data: ") + (zs->msg ? zs->msg : ""));
+         return -1;
+      }
+      else if (used || made)
+         midStream = true;
+   }
+   else
+   {
+#ifdef HAVE_ZSTD
+      ZSTD_inBuffer in = {inPos, static_cast<size_t>(inLeft), 0};
+      ZSTD_outBuffer out = {data, static_cast<size_t>(out_len), 0};
+      size_t ret = ZSTD_decompressStream(static_cast<ZSTD_DStream *>(stream),&out,&in);
+      if (ZSTD_isError(ret))
+      {
+         setErrorString(tr("Bad zstd data: ") + ZSTD_getErrorName(ret));
+         return -1;
+      }
+      used = in.pos;
+      made = out.pos;
+      if (used || made)
+         midStream = ret != 0;     // 0 is the end of a frame
+#else
+      return -1;
+#endif
+   }
+   inPos += used;
+   inLeft -= used;
+   return made;
+}
+
+qint64 InflateDevice::readData(char *data, qint64 maxSize)
+{
+   qint64 got = 0;
+
+   while (got == 0 && !finished && maxSize > 0)
+   {
+      if (inLeft == 0 && !srcEof)
+      {
+         qint64 n = source->read(inBuf.data(),inBuf.size());
+         if (n < 0)
+         {
+            setErrorString(source->errorString());
+            return -1;
+         }
+         srcEof = n == 0;
+         inPos = inBuf.constData();
+         inLeft = n;
+      }
+      got = step(data,maxSize);
+      if (got < 0)
+         return -1;
+      if (got == 0 && inLeft == 0 && srcEof)
+      {
+         if (midStream)
+         {
+            setErrorString(tr("The compressed file ends too soon."));
+            return -1;
+         }
+         finished = true;
+      }
+   }
+   return got;
+}
+
+
+SpikeInput::SpikeInput(const QString &fName) : file(fName)
+{
+   Compression how = compressionOf(fName);
+   if (how != Compression::NONE)
+      inflater = make_unique<InflateDevice>(&file,how);
+}
+
+bool SpikeInput::open(QString &err)
+{
+   bool opened = file.open(QIODevice::ReadOnly);
+   if (!opened || (inflater && !inflater->open(QIODevice::ReadOnly)))
+   {
+      QTextStream(&err) << QObject::tr("Error opening file ") << file.fileName() << endl << QObject::tr("Error is:               ") << (opened ? inflater->errorString() : file.errorString()) << endl;
+      return false;
+   }
+   return true;
+}
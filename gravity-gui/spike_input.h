@@ -0,0 +1,86 @@
+#ifndef SPIKE_INPUT_H
+#define SPIKE_INPUT_H
+
+/*
+Copyright 2005-2020 Kendall F. Morris
+
+This file is part of the USF Gravity Gui software suite.
+
+    The Gravity Gui suite is free software: you can redistribute
+    it and/or modify it under the terms of the GNU General Public
+    License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    The suite is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the suite.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Spike files can be gzip or zstd compressed, name.edt.gz, name.bdt.zst,
+// and so on. They are uncompressed as they are read, never to disk.
+// zstd is only there if we were built with HAVE_ZSTD.
+
+#include <QFile>
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+#include <memory>
+
+enum class Compression {NONE, GZIP, ZSTD};
+
+Compression compressionOf(const QString &fName);
+QString uncompressedName(const QString &fName);
+
+// Reads the compressed bytes from another device and hands back the
+// uncompressed bytes. Read only, no seeking.
+class InflateDevice : public QIODevice
+{
+   public:
+      InflateDevice(QIODevice *src, Compression how);
+      ~InflateDevice();
+      bool open(OpenMode mode) override;
+      void close() override;
+      bool isSequential() const override { return true; }
+
+   protected:
+      qint64 readData(char *data, qint64 maxSize) override;
+      qint64 writeData(const char *, qint64) override { return -1; }
+
+   private:
+      qint64 step(char *data, qint64 maxSize);
+      void endStream();
+
+      QIODevice *source;
+      Compression kind;
+      QByteArray inBuf;
+      const char *inPos = nullptr;
+      qint64 inLeft = 0;
+      bool srcEof = false;
+      bool midStream = false;   // part way through a gzip member or zstd frame
+      bool finished = false;
+      void *stream = nullptr;   // z_stream or ZSTD_DStream
+};
+
+// A spike file opened for reading, compressed or not.
+class SpikeInput
+{
+   public:
+      explicit SpikeInput(const QString &fName);
+      bool open(QString &err);
+      QIODevice *device() { return inflater ? static_cast<QIODevice *>(inflater.get()) : &file; }
+      qint64 size() const { return file.size(); }    // on disk
+      qint64 pos() const { return file.pos(); }      // on disk
+      bool compressed() const { return inflater != nullptr; }
+      QString fileName() const { return file.fileName(); }
+      QString errorString() const { return inflater ? inflater->errorString() : file.errorString(); }
+
+   private:
+      QFile file;
+      std::unique_ptr<InflateDevice> inflater;
+};
+
+#endif